@@ -517,6 +517,16 @@ void Bootloader::process()
     }
 }
 
+/**
+ * @brief Moves the firmware updater with the bootloader, it subscribes to the program object
+ */
+void Bootloader::setSubscriberThread(QThread *thread)
+{
+    NodeOdSubscriber::setSubscriberThread(thread);
+    _ufwUpdate->moveToThread(thread);
+    _ufwUpdate->setSubscriberThread(thread);
+}
+
 void Bootloader::odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
 {
     if (objId.index() == 0x1000)
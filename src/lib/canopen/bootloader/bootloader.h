@@ -154,6 +154,9 @@ private:
     QByteArray capString(const QString &str, int size);
 
     // NodeOdSubscriber interface
+public:
+    void setSubscriberThread(QThread *thread) override;
+
 protected:
     void odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags) override;
 };
@@ -0,0 +1,346 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "canbusdevicefarm.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+#include <iterator>
+
+CanBusDeviceFarm::CanBusDeviceFarm(const QString &adress)
+    : CanBusDriver(adress)
+{
+    _latencyUs = 0;
+    _jitterUs = 0;
+    _frameDropRate = 0.0;
+    _sdoAbortRate = 0.0;
+    _random.seed(1);
+    _droppedCount = 0;
+    _clockEpochNs = 0;
+    std::fill(std::begin(_lastDeliveryNs), std::end(_lastDeliveryNs), 0);
+
+    _deliverTimer = new QTimer(this);
+    _deliverTimer->setSingleShot(true);
+    _deliverTimer->setTimerType(Qt::PreciseTimer);
+    connect(_deliverTimer, &QTimer::timeout, this, &CanBusDeviceFarm::deliverFrames);
+
+    _tickTimer = new QTimer(this);
+    _tickTimer->setInterval(TICK_MS);
+    _tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(_tickTimer, &QTimer::timeout, this, &CanBusDeviceFarm::processTime);
+}
+
+CanBusDeviceFarm::~CanBusDeviceFarm()
+{
+    disconnectDevice();
+    clearNodes();
+}
+
+/**
+ * @brief Adds a simulated node built from an EDS file, replacing any node with the same id
+ */
+bool CanBusDeviceFarm::addNode(quint8 nodeId, const QString &edsFileName)
+{
+    if (nodeId == 0 || nodeId > 127)
+    {
+        return false;
+    }
+
+    CanSimulatedNode *node = new CanSimulatedNode(nodeId);
+    if (!node->loadEds(edsFileName))
+    {
+        delete node;
+        return false;
+    }
+    removeNode(nodeId);
+    _nodes.insert(nodeId, node);
+
+    if (state() == CONNECTED)
+    {
+        node->bootUp(_clock.elapsed(), _responses);
+        scheduleResponses();
+    }
+    return true;
+}
+
+/**
+ * @brief Adds count nodes sharing the same EDS from firstNodeId, returns the number of nodes added
+ */
+int CanBusDeviceFarm::addNodes(quint8 firstNodeId, int count, const QString &edsFileName)
+{
+    int added = 0;
+    for (int nodeId = firstNodeId; nodeId < firstNodeId + count && nodeId <= 127; nodeId++)
+    {
+        if (addNode(static_cast<quint8>(nodeId), edsFileName))
+        {
+            added++;
+        }
+    }
+    return added;
+}
+
+void CanBusDeviceFarm::removeNode(quint8 nodeId)
+{
+    delete _nodes.take(nodeId);
+}
+
+void CanBusDeviceFarm::clearNodes()
+{
+    qDeleteAll(_nodes);
+    _nodes.clear();
+}
+
+CanSimulatedNode *CanBusDeviceFarm::node(quint8 nodeId) const
+{
+    return _nodes.value(nodeId, nullptr);
+}
+
+QList<quint8> CanBusDeviceFarm::nodeIds() const
+{
+    return _nodes.keys();
+}
+
+int CanBusDeviceFarm::latencyUs() const
+{
+    return _latencyUs;
+}
+
+/**
+ * @brief Sets the fixed delay between a request and the answers of the nodes
+ */
+void CanBusDeviceFarm::setLatencyUs(int latencyUs)
+{
+    _latencyUs = qMax(0, latencyUs);
+}
+
+int CanBusDeviceFarm::jitterUs() const
+{
+    return _jitterUs;
+}
+
+/**
+ * @brief Sets the maximum random delay added to the latency of each answer
+ */
+void CanBusDeviceFarm::setJitterUs(int jitterUs)
+{
+    _jitterUs = qMax(0, jitterUs);
+}
+
+double CanBusDeviceFarm::frameDropRate() const
+{
+    return _frameDropRate;
+}
+
+/**
+ * @brief Sets the probability, from 0 to 1, that a frame produced by a node is lost
+ */
+void CanBusDeviceFarm::setFrameDropRate(double frameDropRate)
+{
+    _frameDropRate = qBound(0.0, frameDropRate, 1.0);
+}
+
+double CanBusDeviceFarm::sdoAbortRate() const
+{
+    return _sdoAbortRate;
+}
+
+/**
+ * @brief Sets the probability, from 0 to 1, that a node answers an SDO request with an abort
+ */
+void CanBusDeviceFarm::setSdoAbortRate(double sdoAbortRate)
+{
+    _sdoAbortRate = qBound(0.0, sdoAbortRate, 1.0);
+}
+
+/**
+ * @brief Seeds the generator used for jitter and error injection, for reproducible runs
+ */
+void CanBusDeviceFarm::setSeed(quint32 seed)
+{
+    _random.seed(seed);
+}
+
+bool CanBusDeviceFarm::connectDevice()
+{
+    _clock.start();
+    _clockEpochNs = QDateTime::currentMSecsSinceEpoch() * 1000000;
+    std::fill(std::begin(_lastDeliveryNs), std::end(_lastDeliveryNs), 0);
+    _rxQueue.clear();
+    _pendingFrames.clear();
+    _droppedCount = 0;
+    setState(CONNECTED);
+
+    for (CanSimulatedNode *node : qAsConst(_nodes))
+    {
+        node->bootUp(_clock.elapsed(), _responses);
+    }
+    scheduleResponses();
+    _tickTimer->start();
+    return true;
+}
+
+void CanBusDeviceFarm::disconnectDevice()
+{
+    _tickTimer->stop();
+    _deliverTimer->stop();
+    _pendingFrames.clear();
+    _responses.clear();
+    setState(DISCONNECTED);
+}
+
+QCanBusFrame CanBusDeviceFarm::readFrame()
+{
+    if (_rxQueue.isEmpty())
+    {
+        return QCanBusFrame(QCanBusFrame::InvalidFrame);
+    }
+    return _rxQueue.dequeue();
+}
+
+bool CanBusDeviceFarm::writeFrame(const QCanBusFrame &qtframe)
+{
+    if (state() != CONNECTED)
+    {
+        return false;
+    }
+    processFrame(qtframe);
+    scheduleResponses();
+    return true;
+}
+
+int CanBusDeviceFarm::writeFrames(const QCanBusFrame *qtframes, int count)
+{
+    if (state() != CONNECTED)
+    {
+        return 0;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        processFrame(qtframes[i]);
+    }
+    scheduleResponses();
+    return count;
+}
+
+quint32 CanBusDeviceFarm::droppedFrameCount() const
+{
+    return _droppedCount;
+}
+
+void CanBusDeviceFarm::processFrame(const QCanBusFrame &frame)
+{
+    qint64 nowMs = _clock.elapsed();
+    quint32 cobId = frame.frameId();
+
+    // SDO requests only concern one node, other frames are seen by all of them
+    if (cobId > 0x600 && cobId < 0x680 && !frame.hasExtendedFrameFormat())
+    {
+        CanSimulatedNode *node = _nodes.value(static_cast<quint8>(cobId - 0x600), nullptr);
+        if (node == nullptr)
+        {
+            return;
+        }
+        if (_sdoAbortRate > 0.0 && node->state() != CanSimulatedNode::StateStopped && _random.generateDouble() < _sdoAbortRate)
+        {
+            node->abortSdo(frame, 0x08000000, _responses);  // general error
+            return;
+        }
+        node->processFrame(frame, nowMs, _responses);
+        return;
+    }
+
+    for (CanSimulatedNode *node : qAsConst(_nodes))
+    {
+        node->processFrame(frame, nowMs, _responses);
+    }
+}
+
+void CanBusDeviceFarm::processTime()
+{
+    qint64 nowMs = _clock.elapsed();
+    for (CanSimulatedNode *node : qAsConst(_nodes))
+    {
+        node->processTime(nowMs, _responses);
+    }
+    scheduleResponses();
+}
+
+// moves the frames produced by the nodes to the delivery queue, applying latency, jitter and losses
+void CanBusDeviceFarm::scheduleResponses()
+{
+    if (_responses.isEmpty())
+    {
+        return;
+    }
+
+    // one jitter draw per batch, the answers of a node keep their order (SDO segments and
+    // sub-blocks, TPDO sequences)
+    qint64 delayUs = _latencyUs;
+    if (_jitterUs > 0)
+    {
+        delayUs += _random.bounded(_jitterUs + 1);
+    }
+    qint64 deliveryNs = _clock.nsecsElapsed() + delayUs * 1000;
+    for (const QCanBusFrame &frame : qAsConst(_responses))
+    {
+        if (_frameDropRate > 0.0 && _random.generateDouble() < _frameDropRate)
+        {
+            _droppedCount++;
+            continue;
+        }
+        qint64 &lastDeliveryNs = _lastDeliveryNs[frame.frameId() & 0x7FU];
+        lastDeliveryNs = qMax(deliveryNs, lastDeliveryNs + 1);  // QMultiMap iterates equal keys newest first
+        _pendingFrames.insert(lastDeliveryNs, frame);
+    }
+    _responses.clear();
+    scheduleDelivery();
+}
+
+void CanBusDeviceFarm::scheduleDelivery()
+{
+    if (_pendingFrames.isEmpty())
+    {
+        return;
+    }
+    qint64 waitNs = _pendingFrames.firstKey() - _clock.nsecsElapsed();
+    int waitMs = static_cast<int>(qBound<qint64>(0, waitNs / 1000000, 1000));
+    if (!_deliverTimer->isActive() || _deliverTimer->remainingTime() > waitMs)
+    {
+        _deliverTimer->start(waitMs);
+    }
+}
+
+void CanBusDeviceFarm::deliverFrames()
+{
+    qint64 nowNs = _clock.nsecsElapsed();
+    while (!_pendingFrames.isEmpty() && _pendingFrames.firstKey() <= nowNs)
+    {
+        QMultiMap<qint64, QCanBusFrame>::iterator it = _pendingFrames.begin();
+        QCanBusFrame frame = it.value();
+        frame.setTimeStamp(QCanBusFrame::TimeStamp::fromNanoSeconds(_clockEpochNs + it.key()));
+        _rxQueue.enqueue(frame);
+        _pendingFrames.erase(it);
+    }
+
+    scheduleDelivery();
+    if (!_rxQueue.isEmpty())
+    {
+        emit framesReceived();
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANBUSDEVICEFARM_H
+#define CANBUSDEVICEFARM_H
+
+#include "canopen_global.h"
+
+#include "canbusdriver.h"
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMultiMap>
+#include <QQueue>
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include "busdriver/cansimulatednode.h"
+
+/**
+ * @brief Driver hosting simulated CANopen nodes in-process, as a reproducible load source
+ *
+ * Each node is built from an EDS. Frames written by the master are processed by the nodes and their
+ * answers are received after a configurable latency and jitter. Frames can be dropped and SDO
+ * requests aborted at random to inject errors, with a seedable generator.
+ */
+class CANOPEN_EXPORT CanBusDeviceFarm : public CanBusDriver
+{
+    Q_OBJECT
+public:
+    CanBusDeviceFarm(const QString &adress);
+    ~CanBusDeviceFarm() override;
+
+    bool addNode(quint8 nodeId, const QString &edsFileName);
+    int addNodes(quint8 firstNodeId, int count, const QString &edsFileName);
+    void removeNode(quint8 nodeId);
+    void clearNodes();
+    CanSimulatedNode *node(quint8 nodeId) const;
+    QList<quint8> nodeIds() const;
+
+    // link simulation
+    int latencyUs() const;
+    void setLatencyUs(int latencyUs);
+
+    int jitterUs() const;
+    void setJitterUs(int jitterUs);
+
+    double frameDropRate() const;
+    void setFrameDropRate(double frameDropRate);
+
+    double sdoAbortRate() const;
+    void setSdoAbortRate(double sdoAbortRate);
+
+    void setSeed(quint32 seed);
+
+    // CanBusDriver interface
+public:
+    bool connectDevice() override;
+    void disconnectDevice() override;
+    QCanBusFrame readFrame() override;
+    bool writeFrame(const QCanBusFrame &qtframe) override;
+    int writeFrames(const QCanBusFrame *qtframes, int count) override;
+    quint32 droppedFrameCount() const override;
+
+protected slots:
+    void deliverFrames();
+    void processTime();
+
+private:
+    enum
+    {
+        TICK_MS = 5
+    };
+
+    QMap<quint8, CanSimulatedNode *> _nodes;
+
+    int _latencyUs;
+    int _jitterUs;
+    double _frameDropRate;
+    double _sdoAbortRate;
+    QRandomGenerator _random;
+    quint32 _droppedCount;
+
+    QElapsedTimer _clock;
+    qint64 _clockEpochNs;          // epoch time of the _clock start, frames are stamped in the bus timebase
+    qint64 _lastDeliveryNs[0x80];  // by node id, frames of a node are never reordered
+    QTimer *_deliverTimer;
+    QTimer *_tickTimer;
+    QMultiMap<qint64, QCanBusFrame> _pendingFrames;  // by delivery time in ns
+    QQueue<QCanBusFrame> _rxQueue;
+    QVector<QCanBusFrame> _responses;
+
+    void processFrame(const QCanBusFrame &frame);
+    void scheduleResponses();
+    void scheduleDelivery();
+};
+
+#endif  // CANBUSDEVICEFARM_H
@@ -18,8 +18,15 @@
 
 #include "canbusdriver.h"
 
+#include <QDateTime>
+
+#include <algorithm>
 #include <utility>
 
+#ifdef Q_OS_LINUX
+#    include <time.h>
+#endif
+
 CanBusDriver::CanBusDriver(QString adress)
     : _adress(std::move(adress))
 {
@@ -45,12 +52,187 @@ QCanBusFrame CanBusDriver::readFrame()
     return QCanBusFrame();
 }
 
+/**
+ * @brief Appends up to maxCount received frames to frames
+ * @return number of frames appended, 0 if no more frame is available
+ * Default implementation loops on readFrame(), drivers with a batched reception path should override it.
+ */
+int CanBusDriver::readFrames(QVector<QCanBusFrame> &frames, int maxCount)
+{
+    int count = 0;
+    while (count < maxCount)
+    {
+        QCanBusFrame frame = readFrame();
+        if (!frame.isValid())
+        {
+            break;
+        }
+        frames.append(frame);
+        count++;
+    }
+    return count;
+}
+
 bool CanBusDriver::writeFrame(const QCanBusFrame &qtframe)
 {
     Q_UNUSED(qtframe);
     return false;
 }
 
+/**
+ * @brief Writes count frames in one call
+ * @return number of frames consumed, written or rejected. Less than count means the driver
+ * transmit queue is full, the remaining frames should be retried later.
+ */
+int CanBusDriver::writeFrames(const QCanBusFrame *qtframes, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        writeFrame(qtframes[i]);
+    }
+    return count;
+}
+
+/**
+ * @brief Number of received frames lost by the driver because the consumer was too slow
+ */
+quint32 CanBusDriver::droppedFrameCount() const
+{
+    return 0;
+}
+
+/**
+ * @brief True if writeFrame() can be called from another thread than the driver one,
+ * used by the SYNC producer thread to send the SYNC without going through the event loop
+ */
+bool CanBusDriver::canWriteFromAnyThread() const
+{
+    return false;
+}
+
+/**
+ * @brief Current time of the clock used to stamp received frames, for the frames sent locally
+ */
+QCanBusFrame::TimeStamp CanBusDriver::currentTimeStamp()
+{
+#ifdef Q_OS_LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return QCanBusFrame::TimeStamp::fromNanoSeconds(ts.tv_sec, ts.tv_nsec);
+#else
+    return QCanBusFrame::TimeStamp::fromMicroSeconds(QDateTime::currentMSecsSinceEpoch() * 1000);
+#endif
+}
+
+/**
+ * @brief Restricts the frames received to the ones matching one of filters, an empty list
+ * removes all the filters
+ * @return false if the driver does not support filtering, all frames are then received
+ */
+bool CanBusDriver::setFilters(const QVector<Filter> &filters)
+{
+    Q_UNUSED(filters);
+    return false;
+}
+
+static quint32 filterBlockSize(const CanBusDriver::Filter &filter)
+{
+    return (~filter.mask & 0x7FFU) + 1U;
+}
+
+// ids sorted without duplicates, true if the size identifiers from ids[index] form an aligned block
+static bool isFullBlock(const QVector<quint32> &ids, int index, quint32 size)
+{
+    quint32 id = ids.at(index);
+    int last = index + static_cast<int>(size) - 1;
+    if ((id & (size - 1)) != 0 || id + size - 1 > 0x7FFU || last >= ids.count())
+    {
+        return false;
+    }
+    return ids.at(last) == id + size - 1;
+}
+
+/**
+ * @brief Computes a list of id/mask filters accepting all the cobIds
+ *
+ * Consecutive 11 bits identifiers are grouped into exact aligned power of two blocks. If more than
+ * maxFilters are needed, neighbour blocks are merged into the smallest aligned block covering both
+ * until the list fits, those filters accept some extra identifiers. 29 bits identifiers get exact
+ * filters.
+ * @return filters list, empty if the identifiers could not be covered with maxFilters filters
+ */
+QVector<CanBusDriver::Filter> CanBusDriver::compressFilters(const QList<quint32> &cobIds, int maxFilters)
+{
+    QVector<quint32> ids = cobIds.toVector();
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    QVector<Filter> filters;
+    int i = 0;
+    while (i < ids.count())
+    {
+        quint32 id = ids.at(i);
+        if (id > 0x7FFU)
+        {
+            filters.append(Filter{id, 0x1FFFFFFFU, true});
+            i++;
+            continue;
+        }
+
+        // biggest aligned block starting at id with all its identifiers in the set
+        quint32 size = 1;
+        while (isFullBlock(ids, i, size * 2))
+        {
+            size *= 2;
+        }
+        filters.append(Filter{id, ~(size - 1) & 0x7FFU, false});
+        i += static_cast<int>(size);
+    }
+
+    // lossy merge of the closest standard blocks
+    while (filters.count() > maxFilters)
+    {
+        int best = -1;
+        Filter bestFilter = {0, 0, false};
+        for (int j = 0; j + 1 < filters.count(); j++)
+        {
+            const Filter &first = filters.at(j);
+            const Filter &second = filters.at(j + 1);
+            if (first.extended || second.extended)
+            {
+                continue;
+            }
+            quint32 size = qMax(filterBlockSize(first), filterBlockSize(second));
+            while ((first.id & ~(size - 1)) != (second.id & ~(size - 1)))
+            {
+                size <<= 1;
+            }
+            Filter merged = {first.id & ~(size - 1) & 0x7FFU, ~(size - 1) & 0x7FFU, false};
+            if (best == -1 || filterBlockSize(merged) < filterBlockSize(bestFilter))
+            {
+                best = j;
+                bestFilter = merged;
+            }
+        }
+        if (best == -1)
+        {
+            return QVector<Filter>();
+        }
+
+        filters[best] = bestFilter;
+        for (int j = filters.count() - 1; j >= 0; j--)
+        {
+            const Filter &filter = filters.at(j);
+            if (j != best && !filter.extended && (filter.id & bestFilter.mask) == bestFilter.id)
+            {
+                filters.remove(j);
+            }
+        }
+    }
+
+    return filters;
+}
+
 void CanBusDriver::setState(State state)
 {
     bool stateChange = (_state != state);
@@ -22,6 +22,7 @@
 #include "canopen_global.h"
 
 #include <QObject>
+#include <QVector>
 
 #include "busdriver/qcanbusframe.h"
 
@@ -44,7 +45,25 @@ public:
     virtual void disconnectDevice();
 
     virtual QCanBusFrame readFrame();
+    virtual int readFrames(QVector<QCanBusFrame> &frames, int maxCount);
     virtual bool writeFrame(const QCanBusFrame &qtframe);
+    virtual int writeFrames(const QCanBusFrame *qtframes, int count);
+
+    virtual quint32 droppedFrameCount() const;
+    virtual bool canWriteFromAnyThread() const;
+
+    // time stamp of the RX frames clock, nanoseconds since the epoch
+    static QCanBusFrame::TimeStamp currentTimeStamp();
+
+    // reception filters
+    struct Filter
+    {
+        quint32 id;
+        quint32 mask;
+        bool extended;
+    };
+    virtual bool setFilters(const QVector<Filter> &filters);
+    static QVector<Filter> compressFilters(const QList<quint32> &cobIds, int maxFilters);
 
 signals:
     void framesReceived();
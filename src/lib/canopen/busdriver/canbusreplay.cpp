@@ -0,0 +1,176 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "canbusreplay.h"
+
+CanBusReplay::CanBusReplay(const QString &adress)
+    : CanBusDriver(adress)
+{
+    _speed = 1.0;
+    _startStamp = 0;
+    _position = 0;
+    _hasNextFrame = false;
+
+    _replayTimer = new QTimer(this);
+    _replayTimer->setSingleShot(true);
+    _replayTimer->setTimerType(Qt::PreciseTimer);
+    connect(_replayTimer, &QTimer::timeout, this, &CanBusReplay::replayNext);
+}
+
+CanBusReplay::~CanBusReplay()
+{
+    disconnectDevice();
+}
+
+double CanBusReplay::speed() const
+{
+    return _speed;
+}
+
+/**
+ * @brief Sets the replay speed factor, 1.0 for the original timing, 0 for as fast as possible
+ */
+void CanBusReplay::setSpeed(double speed)
+{
+    // time reference moved to the current replay position, the next frame one after a fast replay
+    if (_elapsedTimer.isValid())
+    {
+        if (_speed <= 0.0)
+        {
+            _startStamp = _hasNextFrame ? _nextFrame.timeStamp().toNanoSeconds() : 0;
+        }
+        else
+        {
+            _startStamp = replayStamp();
+        }
+        _elapsedTimer.restart();
+    }
+    _speed = qMax(0.0, speed);
+
+    if (state() == CONNECTED && _hasNextFrame)
+    {
+        _replayTimer->start(0);
+    }
+}
+
+qint64 CanBusReplay::position() const
+{
+    return _position;
+}
+
+qint64 CanBusReplay::frameCount() const
+{
+    return _reader.frameCount();
+}
+
+bool CanBusReplay::connectDevice()
+{
+    if (!_reader.open(_adress))
+    {
+        setState(ERROR);
+        return false;
+    }
+
+    _queue.clear();
+    _position = 0;
+    _hasNextFrame = _reader.readNext(_nextFrame);
+    _startStamp = _hasNextFrame ? _nextFrame.timeStamp().toNanoSeconds() : 0;
+    _elapsedTimer.start();
+
+    setState(CONNECTED);
+    _replayTimer->start(0);
+    return true;
+}
+
+void CanBusReplay::disconnectDevice()
+{
+    _replayTimer->stop();
+    _elapsedTimer.invalidate();
+    _reader.close();
+    _hasNextFrame = false;
+    setState(DISCONNECTED);
+}
+
+QCanBusFrame CanBusReplay::readFrame()
+{
+    if (_queue.isEmpty())
+    {
+        return QCanBusFrame(QCanBusFrame::InvalidFrame);
+    }
+    return _queue.dequeue();
+}
+
+bool CanBusReplay::writeFrame(const QCanBusFrame &qtframe)
+{
+    Q_UNUSED(qtframe);
+    return true;
+}
+
+// capture time stamp corresponding to now
+qint64 CanBusReplay::replayStamp() const
+{
+    return _startStamp + static_cast<qint64>(static_cast<double>(_elapsedTimer.nsecsElapsed()) * _speed);
+}
+
+void CanBusReplay::replayNext()
+{
+    if (_speed <= 0.0)
+    {
+        // as fast as possible, by batches to let the event loop run
+        for (int i = 0; i < FAST_REPLAY_BATCH && _hasNextFrame; i++)
+        {
+            _queue.enqueue(_nextFrame);
+            _position++;
+            _hasNextFrame = _reader.readNext(_nextFrame);
+        }
+        if (!_queue.isEmpty())
+        {
+            emit framesReceived();
+        }
+        if (_hasNextFrame)
+        {
+            _replayTimer->start(0);
+        }
+        else
+        {
+            emit replayFinished();
+        }
+        return;
+    }
+
+    qint64 now = replayStamp();
+    while (_hasNextFrame && _nextFrame.timeStamp().toNanoSeconds() <= now)
+    {
+        _queue.enqueue(_nextFrame);
+        _position++;
+        _hasNextFrame = _reader.readNext(_nextFrame);
+    }
+    if (!_queue.isEmpty())
+    {
+        emit framesReceived();
+    }
+
+    if (!_hasNextFrame)
+    {
+        emit replayFinished();
+        return;
+    }
+
+    qint64 waitNs = static_cast<qint64>(static_cast<double>(_nextFrame.timeStamp().toNanoSeconds() - now) / _speed);
+    _replayTimer->start(static_cast<int>(qBound<qint64>(0, waitNs / 1000000, 1000)));
+}
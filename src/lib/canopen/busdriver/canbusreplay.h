@@ -0,0 +1,84 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANBUSREPLAY_H
+#define CANBUSREPLAY_H
+
+#include "canopen_global.h"
+
+#include "canbusdriver.h"
+
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QTimer>
+
+#include "busdriver/cancapturereader.h"
+
+/**
+ * @brief Driver replaying a capture file as received frames
+ *
+ * The adress is the capture file name. Frames are replayed at their original timing, scaled by
+ * speed, or as fast as possible with a speed of 0. Frames sent during the capture keep their
+ * local echo flag, the bus only logs them. Written frames are discarded.
+ */
+class CANOPEN_EXPORT CanBusReplay : public CanBusDriver
+{
+    Q_OBJECT
+public:
+    CanBusReplay(const QString &adress);
+    ~CanBusReplay() override;
+
+    double speed() const;
+    void setSpeed(double speed);
+
+    qint64 position() const;
+    qint64 frameCount() const;
+
+    // CanBusDriver interface
+public:
+    bool connectDevice() override;
+    void disconnectDevice() override;
+    QCanBusFrame readFrame() override;
+    bool writeFrame(const QCanBusFrame &qtframe) override;
+
+signals:
+    void replayFinished();
+
+protected slots:
+    void replayNext();
+
+private:
+    enum
+    {
+        FAST_REPLAY_BATCH = 256
+    };
+
+    CanCaptureReader _reader;
+    double _speed;
+    QTimer *_replayTimer;
+    QElapsedTimer _elapsedTimer;
+    qint64 _startStamp;
+    qint64 _position;
+    QQueue<QCanBusFrame> _queue;
+
+    QCanBusFrame _nextFrame;
+    bool _hasNextFrame;
+    qint64 replayStamp() const;
+};
+
+#endif  // CANBUSREPLAY_H
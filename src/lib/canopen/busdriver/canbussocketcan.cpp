@@ -18,21 +18,27 @@
 
 #include "canbussocketcan.h"
 
+#include <cerrno>
 #include <cstdio>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <sys/types.h>
 
 #include <cstring>
 #include <iostream>
 using namespace std;
 
-int createSocketCan(const QString &adress)
+int createSocketCan(const QString &adress, CanBusSocketCAN::TimestampMode timestampMode)
 {
     struct ifreq ifr;
     struct sockaddr_can addr;
@@ -58,6 +64,31 @@ int createSocketCan(const QString &adress)
 
     fcntl(can_socket, F_SETFL, O_NONBLOCK);
 
+    // reception time stamp given as ancillary data, avoid an ioctl per frame
+    switch (timestampMode)
+    {
+        case CanBusSocketCAN::TimestampNone:
+            break;
+
+        case CanBusSocketCAN::TimestampSoftware:
+        {
+            int enable = 1;
+            setsockopt(can_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+            break;
+        }
+
+        case CanBusSocketCAN::TimestampHardware:
+        {
+            int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+            if (setsockopt(can_socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+            {
+                int enable = 1;
+                setsockopt(can_socket, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+            }
+            break;
+        }
+    }
+
 #ifndef Q_OS_ANDROID
     // TODO find a way to do that...
     if (bind(can_socket, (struct sockaddr *)&addr, sizeof(addr)) < 0)
@@ -74,8 +105,10 @@ CanBusSocketCAN::CanBusSocketCAN(const QString &adress)
     : CanBusDriver(adress)
 {
     _can_socket = -1;
+    _timestampMode = TimestampSoftware;
     _readNotifier = nullptr;
     _errorNotifier = nullptr;
+    _readNotifyPending.storeRelease(0);
 }
 
 CanBusSocketCAN::~CanBusSocketCAN()
@@ -87,12 +120,16 @@ bool CanBusSocketCAN::connectDevice()
 {
     QMutexLocker socketLocker(&_socketMutex);
 
-    _can_socket = createSocketCan(_adress);
+    _can_socket = createSocketCan(_adress, _timestampMode);
     if (_can_socket < 0)
     {
         return false;
     }
 
+    applyFilters();
+
+    _rxRing.clear();
+    _readNotifyPending.storeRelease(0);
     _readNotifier = new CanBusSocketCANNotifierThead(this);
     _readNotifier->start();
 
@@ -111,7 +148,8 @@ void CanBusSocketCAN::disconnectDevice()
         return;
     }
 
-    _readNotifier->terminate();
+    _readNotifier->requestInterruption();
+    _readNotifier->wait();
     _errorNotifier->setEnabled(false);
     close(_can_socket);
     _can_socket = -1;
@@ -122,38 +160,117 @@ void CanBusSocketCAN::disconnectDevice()
 
 QCanBusFrame CanBusSocketCAN::readFrame()
 {
-    QMutexLocker socketLocker(&_socketMutex);
     QCanBusFrame qtFrame;
+    if (_rxRing.pop(qtFrame))
+    {
+        return qtFrame;
+    }
 
-    struct can_frame frame;
-
-    int recvbytes = read(_can_socket, &frame, sizeof(struct can_frame));
-    if (recvbytes < 0)
+    // ring seen empty, re-arm the notification then check again to not miss a frame pushed in between
+    _readNotifyPending.storeRelease(0);
+    if (_rxRing.pop(qtFrame))
     {
-        qtFrame.setFrameType(QCanBusFrame::InvalidFrame);
         return qtFrame;
     }
 
-    struct timeval tv;
-    ioctl(_can_socket, SIOCGSTAMP_OLD, &tv);
-    qtFrame.setTimeStamp(QCanBusFrame::TimeStamp(tv.tv_sec, tv.tv_usec));
+    qtFrame.setFrameType(QCanBusFrame::InvalidFrame);
+    return qtFrame;
+}
 
-    qtFrame.setFrameId(frame.can_id & 0x1FFFFFFF);
+int CanBusSocketCAN::readFrames(QVector<QCanBusFrame> &frames, int maxCount)
+{
+    // re-armed before draining, a frame pushed during the drain will trigger a new notification
+    _readNotifyPending.storeRelease(0);
+
+    int first = frames.size();
+    frames.resize(first + maxCount);
+    int count = _rxRing.pop(frames.data() + first, maxCount);
+    frames.resize(first + count);
+    return count;
+}
 
-    QByteArray payLoad;
-    for (int i = 0; i < frame.can_dlc; i++)
+quint32 CanBusSocketCAN::droppedFrameCount() const
+{
+    return _rxRing.droppedCount();
+}
+
+// socket writes are protected by _socketMutex
+bool CanBusSocketCAN::canWriteFromAnyThread() const
+{
+    return true;
+}
+
+bool CanBusSocketCAN::setFilters(const QVector<Filter> &filters)
+{
+    QMutexLocker socketLocker(&_socketMutex);
+    _filters = filters;
+    if (_can_socket == -1)
     {
-        payLoad.append(frame.data[i]);
+        return true;
     }
-    qtFrame.setPayload(payLoad);
+    return applyFilters();
+}
 
-    qtFrame.setFrameType(QCanBusFrame::DataFrame);
-    if ((frame.can_id & CAN_RTR_FLAG) != 0)
+bool CanBusSocketCAN::applyFilters()
+{
+    QVector<struct can_filter> canFilters;
+    if (_filters.isEmpty())
     {
-        qtFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+        // accept all
+        canFilters.append(can_filter{0, 0});
+    }
+    for (const Filter &filter : qAsConst(_filters))
+    {
+        struct can_filter canFilter;
+        if (filter.extended)
+        {
+            canFilter.can_id = (filter.id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+            canFilter.can_mask = (filter.mask & CAN_EFF_MASK) | CAN_EFF_FLAG;
+        }
+        else
+        {
+            canFilter.can_id = filter.id & CAN_SFF_MASK;
+            canFilter.can_mask = (filter.mask & CAN_SFF_MASK) | CAN_EFF_FLAG;
+        }
+        canFilters.append(canFilter);
     }
 
-    return qtFrame;
+    int ret = setsockopt(_can_socket,
+                         SOL_CAN_RAW,
+                         CAN_RAW_FILTER,
+                         canFilters.constData(),
+                         static_cast<socklen_t>(static_cast<size_t>(canFilters.count()) * sizeof(struct can_filter)));
+    return (ret == 0);
+}
+
+CanBusSocketCAN::TimestampMode CanBusSocketCAN::timestampMode() const
+{
+    return _timestampMode;
+}
+
+/**
+ * @brief Sets the RX time stamp source, applied at the next connectDevice()
+ */
+void CanBusSocketCAN::setTimestampMode(TimestampMode timestampMode)
+{
+    _timestampMode = timestampMode;
+}
+
+static void toCanFrame(struct can_frame *frame, const QCanBusFrame &qtframe)
+{
+    memset(frame, 0, sizeof(struct can_frame));
+    frame->can_id = qtframe.frameId();
+    if (qtframe.hasExtendedFrameFormat())
+    {
+        frame->can_id |= CAN_EFF_FLAG;
+    }
+    if (qtframe.frameType() == QCanBusFrame::RemoteRequestFrame)
+    {
+        frame->can_id |= CAN_RTR_FLAG;
+    }
+
+    frame->can_dlc = static_cast<__u8>(qMin(qtframe.payloadSize(), CAN_MAX_DLEN));
+    memcpy(frame->data, qtframe.payloadData(), frame->can_dlc);
 }
 
 bool CanBusSocketCAN::writeFrame(const QCanBusFrame &qtframe)
@@ -162,26 +279,60 @@ bool CanBusSocketCAN::writeFrame(const QCanBusFrame &qtframe)
     int retval;
     struct can_frame frame;
 
-    frame.can_id = qtframe.frameId();
+    toCanFrame(&frame, qtframe);
 
-    if (qtframe.frameType() == QCanBusFrame::RemoteRequestFrame)
+    retval = write(_can_socket, &frame, sizeof(struct can_frame));
+    return (retval == sizeof(struct can_frame));
+}
+
+int CanBusSocketCAN::writeFrames(const QCanBusFrame *qtframes, int count)
+{
+    QMutexLocker socketLocker(&_socketMutex);
+    if (_can_socket == -1)
     {
-        frame.can_id += CAN_RTR_FLAG;
+        return 0;  // nothing written, frames are not echoed as sent
     }
 
-    frame.can_dlc = qtframe.payload().size();
-    for (int i = 0; i < qtframe.payload().size(); i++)
+    struct can_frame frames[WRITE_BATCH_SIZE];
+    struct iovec iovecs[WRITE_BATCH_SIZE];
+    struct mmsghdr msgs[WRITE_BATCH_SIZE];
+    memset(msgs, 0, sizeof(msgs));
+
+    int done = 0;
+    while (done < count)
     {
-        frame.data[i] = qtframe.payload()[i];
-    }
+        int batch = qMin(count - done, static_cast<int>(WRITE_BATCH_SIZE));
+        for (int i = 0; i < batch; i++)
+        {
+            toCanFrame(&frames[i], qtframes[done + i]);
+            iovecs[i].iov_base = &frames[i];
+            iovecs[i].iov_len = sizeof(struct can_frame);
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
 
-    retval = write(_can_socket, &frame, sizeof(struct can_frame));
-    return (retval == sizeof(struct can_frame));
+        int sent = sendmmsg(_can_socket, msgs, batch, MSG_DONTWAIT);
+        if (sent < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR)
+            {
+                break;  // controller queue full, backpressure to the caller
+            }
+            done++;  // frame rejected by the kernel, dropped
+            continue;
+        }
+        done += sent;
+    }
+    return done;
 }
 
 void CanBusSocketCAN::notifyRead()
 {
-    emit framesReceived();
+    // only one pending notification at a time, the consumer drains the whole ring
+    if (_readNotifyPending.testAndSetOrdered(0, 1))
+    {
+        emit framesReceived();
+    }
 }
 
 void CanBusSocketCAN::handleError()
@@ -193,35 +344,188 @@ CanBusSocketCANNotifierThead::CanBusSocketCANNotifierThead(CanBusSocketCAN *driv
     : QThread(driver)
 {
     _driver = driver;
+    _can_socket = driver->_can_socket;
+    _hardwareOffsetNs = 0;
+    _hardwareOffsetValid = false;
 }
 
 CanBusSocketCANNotifierThead::~CanBusSocketCANNotifierThead()
 {
-    terminate();
+    requestInterruption();
+    wait();
 }
 
-void CanBusSocketCANNotifierThead::run()
+/**
+ * @brief Converts a raw hardware time stamp of the controller clock to the system clock
+ *
+ * The offset between the two clocks is the smallest difference seen between the software and
+ * the hardware stamps of the same frames, the software one being late by the interrupt latency.
+ * It slowly follows the drift of the controller clock and is reset when this clock jumps.
+ */
+struct timespec CanBusSocketCANNotifierThead::hardwareToSystemTime(const struct timespec &hardwareTs, const struct timespec &systemTs)
 {
-    fd_set rdfs;
-    bool running = true;
+    qint64 hardwareNs = static_cast<qint64>(hardwareTs.tv_sec) * 1000000000 + hardwareTs.tv_nsec;
+    qint64 systemNs = static_cast<qint64>(systemTs.tv_sec) * 1000000000 + systemTs.tv_nsec;
+    qint64 offsetNs = systemNs - hardwareNs;
 
-    _can_socket = createSocketCan(_driver->_adress);
+    if (!_hardwareOffsetValid || qAbs(offsetNs - _hardwareOffsetNs) > HARDWARE_OFFSET_RESET_NS)
+    {
+        _hardwareOffsetNs = offsetNs;
+        _hardwareOffsetValid = true;
+    }
+    else if (offsetNs < _hardwareOffsetNs)
+    {
+        _hardwareOffsetNs = offsetNs;
+    }
+    else
+    {
+        _hardwareOffsetNs += (offsetNs - _hardwareOffsetNs) / HARDWARE_OFFSET_AGING;
+    }
 
-    while (running)
+    qint64 stampNs = hardwareNs + _hardwareOffsetNs;
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(stampNs / 1000000000);
+    ts.tv_nsec = static_cast<long>(stampNs % 1000000000);
+    return ts;
+}
+
+void CanBusSocketCANNotifierThead::run()
+{
+    struct can_frame frames[READ_BATCH_SIZE];
+    struct iovec iovecs[READ_BATCH_SIZE];
+    struct mmsghdr msgs[READ_BATCH_SIZE];
+    char controls[READ_BATCH_SIZE][CMSG_SPACE(sizeof(struct scm_timestamping))];
+
+    memset(msgs, 0, sizeof(msgs));
+    for (int i = 0; i < READ_BATCH_SIZE; i++)
     {
-        FD_ZERO(&rdfs);
-        FD_SET(_can_socket, &rdfs);
+        iovecs[i].iov_base = &frames[i];
+        iovecs[i].iov_len = sizeof(struct can_frame);
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = controls[i];
+    }
 
-        if (select(_can_socket + 1, &rdfs, nullptr, nullptr, nullptr) <= 0)
+    struct pollfd pollFd;
+    pollFd.fd = _can_socket;
+    pollFd.events = POLLIN;
+
+    while (!isInterruptionRequested())
+    {
+        int ret = poll(&pollFd, 1, POLL_TIMEOUT_MS);
+        if (ret < 0)
         {
-            terminate();
-            running = false;
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
         }
-        else
+        if (ret == 0)
+        {
+            continue;
+        }
+        if ((pollFd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+        {
+            break;
+        }
+
+        // drain the socket by batches, then notify once for the whole burst
+        int received;
+        do
+        {
+            for (int i = 0; i < READ_BATCH_SIZE; i++)
+            {
+                msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+                msgs[i].msg_hdr.msg_flags = 0;
+            }
+
+            received = recvmmsg(_can_socket, msgs, READ_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            for (int i = 0; i < received; i++)
+            {
+                if (msgs[i].msg_len != sizeof(struct can_frame))
+                {
+                    continue;
+                }
+
+                CanFrameRing::Frame *slot = _driver->_rxRing.reserve();
+                if (slot == nullptr)
+                {
+                    _driver->_rxRing.drop(static_cast<quint32>(received - i));
+                    break;
+                }
+
+                const struct can_frame &frame = frames[i];
+                slot->flags = 0;
+                if ((frame.can_id & CAN_EFF_FLAG) != 0)
+                {
+                    slot->flags |= CanFrameRing::FlagExtended;
+                    slot->canId = frame.can_id & CAN_EFF_MASK;
+                }
+                else
+                {
+                    slot->canId = frame.can_id & CAN_SFF_MASK;
+                }
+                if ((frame.can_id & CAN_RTR_FLAG) != 0)
+                {
+                    slot->flags |= CanFrameRing::FlagRemoteRequest;
+                }
+                if ((frame.can_id & CAN_ERR_FLAG) != 0)
+                {
+                    slot->flags |= CanFrameRing::FlagError;
+                    slot->canId = frame.can_id & CAN_ERR_MASK;
+                }
+                slot->dlc = qMin(frame.can_dlc, static_cast<__u8>(CAN_MAX_DLEN));
+                memcpy(slot->data, frame.data, slot->dlc);
+
+                struct timespec ts;
+                ts.tv_sec = 0;
+                ts.tv_nsec = 0;
+                struct timespec hardwareTs;
+                hardwareTs.tv_sec = 0;
+                hardwareTs.tv_nsec = 0;
+                for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+                {
+                    if (cmsg->cmsg_level != SOL_SOCKET)
+                    {
+                        continue;
+                    }
+                    if (cmsg->cmsg_type == SCM_TIMESTAMPNS)
+                    {
+                        memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    }
+                    else if (cmsg->cmsg_type == SCM_TIMESTAMPING)
+                    {
+                        // ts[0] is the software time stamp, ts[2] the raw hardware one
+                        struct scm_timestamping stamps;
+                        memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                        ts = stamps.ts[0];
+                        hardwareTs = stamps.ts[2];
+                    }
+                }
+                if (ts.tv_sec == 0 && ts.tv_nsec == 0)
+                {
+                    clock_gettime(CLOCK_REALTIME, &ts);
+                }
+                if (hardwareTs.tv_sec != 0 || hardwareTs.tv_nsec != 0)
+                {
+                    ts = hardwareToSystemTime(hardwareTs, ts);
+                }
+                slot->seconds = ts.tv_sec;
+                slot->nanoSeconds = ts.tv_nsec;
+
+                _driver->_rxRing.commit();
+            }
+        } while (received == READ_BATCH_SIZE);
+
+        if (!_driver->_rxRing.isEmpty())
         {
-            struct can_frame frame;
-            read(_can_socket, &frame, sizeof(struct can_frame));
             _driver->notifyRead();
         }
+
+        if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            break;
+        }
     }
 }
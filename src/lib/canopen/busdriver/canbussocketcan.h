@@ -22,11 +22,14 @@
 #include "canopen_global.h"
 
 #include "canbusdriver.h"
+#include "canframering.h"
 
 #include <QMutex>
 #include <QSocketNotifier>
 #include <QThread>
 
+#include <time.h>
+
 class CanBusSocketCANNotifierThead;
 
 class CANOPEN_EXPORT CanBusSocketCAN : public CanBusDriver
@@ -42,15 +45,40 @@ public:
     void disconnectDevice() override;
 
     QCanBusFrame readFrame() override;
+    int readFrames(QVector<QCanBusFrame> &frames, int maxCount) override;
     bool writeFrame(const QCanBusFrame &qtframe) override;
+    int writeFrames(const QCanBusFrame *qtframes, int count) override;
+
+    quint32 droppedFrameCount() const override;
+    bool canWriteFromAnyThread() const override;
+    bool setFilters(const QVector<Filter> &filters) override;
+
+    enum TimestampMode
+    {
+        TimestampNone,      // no kernel time stamp, frames are stamped by the reader thread
+        TimestampSoftware,  // kernel software RX time stamps (SO_TIMESTAMPNS)
+        TimestampHardware   // controller hardware RX time stamps (SO_TIMESTAMPING) converted to the system clock, software fallback
+    };
+    TimestampMode timestampMode() const;
+    void setTimestampMode(TimestampMode timestampMode);
 
 private:
     int _can_socket;
+    TimestampMode _timestampMode;
+    QVector<Filter> _filters;
+    bool applyFilters();
     QMutex _socketMutex;
     friend class CanBusSocketCANNotifierThead;
     CanBusSocketCANNotifierThead *_readNotifier;
     QSocketNotifier *_errorNotifier;
 
+    enum
+    {
+        WRITE_BATCH_SIZE = 32
+    };
+
+    CanFrameRing _rxRing;
+    QAtomicInt _readNotifyPending;
     void notifyRead();
 
 protected slots:
@@ -64,11 +92,27 @@ public:
     CanBusSocketCANNotifierThead(CanBusSocketCAN *driver);
     ~CanBusSocketCANNotifierThead();
 
+    enum
+    {
+        READ_BATCH_SIZE = 64,
+        POLL_TIMEOUT_MS = 50
+    };
+
     // QThread interface
 protected:
-    int _can_socket;
     void run() override;
     CanBusSocketCAN *_driver;
+    int _can_socket;
+
+    // offset from the controller clock to the system clock
+    enum : qint64
+    {
+        HARDWARE_OFFSET_RESET_NS = 1000000000,  // controller clock jump
+        HARDWARE_OFFSET_AGING = 1024            // frames to follow an increase of the offset
+    };
+    qint64 _hardwareOffsetNs;
+    bool _hardwareOffsetValid;
+    struct timespec hardwareToSystemTime(const struct timespec &hardwareTs, const struct timespec &systemTs);
 };
 
 #endif  // CANBUSSOCKETCAN_H
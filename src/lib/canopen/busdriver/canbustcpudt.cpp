@@ -18,12 +18,16 @@
 
 #include "canbustcpudt.h"
 
-#include <QDataStream>
 #include <QDebug>
+#include <QtEndian>
 
 CanBusTcpUDT::CanBusTcpUDT(const QString &adress)
     : CanBusDriver(adress)
 {
+    _lowDelay = true;
+    _rxBuffer.reserve(BUFFER_SIZE);
+    _txBuffer.reserve(BUFFER_SIZE);
+
     _sock = new QTcpSocket;
     QObject::connect(_sock, &QIODevice::readyRead, this, &CanBusTcpUDT::readTCP);
     QObject::connect(_sock, &QAbstractSocket::stateChanged, this, &CanBusTcpUDT::stateChanged);
@@ -31,6 +35,7 @@ CanBusTcpUDT::CanBusTcpUDT(const QString &adress)
 
 bool CanBusTcpUDT::connectDevice()
 {
+    _rxBuffer.resize(0);
     _sock->connectToHost(_adress, 5050);
     return true;
 }
@@ -52,104 +57,177 @@ QCanBusFrame CanBusTcpUDT::readFrame()
 
 bool CanBusTcpUDT::writeFrame(const QCanBusFrame &qtframe)
 {
-    quint8 flags;
-    quint8 dlc;
-    switch (qtframe.frameType())
-    {
-        case QCanBusFrame::UnknownFrame:
-        case QCanBusFrame::InvalidFrame:
-            return false;
-
-        case QCanBusFrame::DataFrame:
-            if (qtframe.hasExtendedFrameFormat())
-            {
-                flags = 2;
-            }
-            else
-            {
-                flags = 1;
-            }
-            break;
-
-        case QCanBusFrame::ErrorFrame:
-            flags = 3;
-            break;
+    return writeFrames(&qtframe, 1) == 1;
+}
 
-        case QCanBusFrame::RemoteRequestFrame:
-            flags = 4;
-            break;
+/**
+ * @brief Encodes all the frames in one buffer written with a single socket write
+ */
+int CanBusTcpUDT::writeFrames(const QCanBusFrame *qtframes, int count)
+{
+    _txBuffer.resize(0);
+    for (int i = 0; i < count; i++)
+    {
+        const QCanBusFrame &qtframe = qtframes[i];
+        quint8 flags;
+        switch (qtframe.frameType())
+        {
+            case QCanBusFrame::UnknownFrame:
+            case QCanBusFrame::InvalidFrame:
+                continue;
+
+            case QCanBusFrame::DataFrame:
+                if (qtframe.hasExtendedFrameFormat())
+                {
+                    flags = 2;
+                }
+                else
+                {
+                    flags = 1;
+                }
+                break;
+
+            case QCanBusFrame::ErrorFrame:
+                flags = 3;
+                break;
+
+            case QCanBusFrame::RemoteRequestFrame:
+                flags = 4;
+                break;
+        }
+
+        uchar header[PACKET_HEADER_SIZE];
+        header[0] = 'U';  // Magic id
+        header[1] = 0;    // bus id
+        header[2] = flags;
+        header[3] = static_cast<quint8>(qtframe.payloadSize());
+        qToLittleEndian<quint32>(qtframe.frameId(), header + 4);
+
+        _txBuffer.append(reinterpret_cast<const char *>(header), PACKET_HEADER_SIZE);
+        _txBuffer.append(qtframe.payloadData(), qtframe.payloadSize());
     }
 
-    QByteArray data;
-    QDataStream stream(&data, QIODevice::WriteOnly);
-    stream.setByteOrder(QDataStream::LittleEndian);
-    dlc = qtframe.payload().size();
-
-    stream << static_cast<quint8>('U');  // Magic id
-    stream << static_cast<quint8>(0);    // bus id
-    stream << flags;                     // flags
-    stream << dlc;                       // dlc
+    if (!_txBuffer.isEmpty() && _sock->write(_txBuffer) == -1)
+    {
+        return 0;
+    }
+    return count;
+}
 
-    stream << static_cast<quint32>(qtframe.frameId());  // frame id
-    data.append(qtframe.payload());
+bool CanBusTcpUDT::lowDelay() const
+{
+    return _lowDelay;
+}
 
-    return (_sock->write(data) != -1);
+/**
+ * @brief Enables TCP_NODELAY on the gateway connection, enabled by default as writes are already coalesced
+ */
+void CanBusTcpUDT::setLowDelay(bool lowDelay)
+{
+    _lowDelay = lowDelay;
+    if (_sock->state() == QAbstractSocket::ConnectedState)
+    {
+        _sock->setSocketOption(QAbstractSocket::LowDelayOption, _lowDelay ? 1 : 0);
+    }
 }
 
 void CanBusTcpUDT::readTCP()
 {
-    QByteArray data = _sock->readAll();
-    int id = 0;
-    int rec = 0;
+    // append the available bytes after the partial packet kept from the previous read
+    qint64 available = _sock->bytesAvailable();
+    if (available <= 0)
+    {
+        return;
+    }
+    int size = _rxBuffer.size();
+    _rxBuffer.resize(size + static_cast<int>(available));
+    qint64 read = _sock->read(_rxBuffer.data() + size, available);
+    _rxBuffer.resize(size + static_cast<int>(qMax<qint64>(0, read)));
+
+    // decode all the complete packets in place
+    const char *data = _rxBuffer.constData();
+    int offset = 0;
+    int frameCount = 0;
+    while (offset < _rxBuffer.size())
+    {
+        int packetSize = readPacket(data + offset, _rxBuffer.size() - offset);
+        if (packetSize == 0)
+        {
+            break;  // partial packet
+        }
+        if (packetSize > 0)
+        {
+            frameCount++;
+            offset += packetSize;
+        }
+        else
+        {
+            offset += -packetSize;  // skipped bytes
+        }
+    }
+    _rxBuffer.remove(0, offset);
 
-    while (rec >= 0)
+    if (frameCount > 0)
     {
-        rec = readPacket(data.mid(id));
-        id += rec;
+        emit framesReceived();
     }
 }
 
-int CanBusTcpUDT::readPacket(QByteArray data)
+/**
+ * @brief Decodes one packet at data
+ * @return packet size if a frame was queued, 0 if the packet is not complete, minus the number of
+ * bytes to skip for an invalid or foreign packet
+ */
+int CanBusTcpUDT::readPacket(const char *data, int size)
 {
-    QDataStream stream(&data, QIODevice::ReadOnly);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    quint8 magic;
-    quint8 busid;
-    quint8 flags;
-    quint8 dlc;
-    quint32 frameId;
-    stream >> magic;
-    stream >> busid;
-    stream >> flags;
-    stream >> dlc;
-    stream >> frameId;
-
-    if (magic != 'U' || busid != 0)
+    if (size < PACKET_HEADER_SIZE)
     {
-        return -1;
+        return 0;
     }
 
-    QCanBusFrame qtFrame;
-    qtFrame.setFrameId(frameId);
+    const uchar *header = reinterpret_cast<const uchar *>(data);
+    quint8 magic = header[0];
+    quint8 busid = header[1];
+    quint8 flags = header[2];
+    quint8 dlc = header[3];
 
-    QByteArray payLoad;
-    for (int i = 0; i < dlc; i++)
+    if (magic != 'U' || dlc > 64)
     {
-        payLoad.append(data[i + 8]);
+        return -1;  // resynchronize on the next byte
+    }
+    if (size < PACKET_HEADER_SIZE + dlc)
+    {
+        return 0;
+    }
+    if (busid != 0)
+    {
+        return -(PACKET_HEADER_SIZE + dlc);
     }
-    qtFrame.setPayload(payLoad);
 
-    qtFrame.setFrameType(QCanBusFrame::DataFrame);
-    if (flags == 4)
+    QCanBusFrame qtFrame;
+    switch (flags)
     {
-        qtFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+        case 2:
+            qtFrame.setExtendedFrameFormat(true);
+            break;
+
+        case 3:
+            qtFrame.setFrameType(QCanBusFrame::ErrorFrame);
+            break;
+
+        case 4:
+            qtFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+            break;
+
+        default:
+            break;
     }
+    qtFrame.setFrameId(qFromLittleEndian<quint32>(header + 4));
+    qtFrame.setPayload(data + PACKET_HEADER_SIZE, dlc);
 
     _queue.append(qtFrame);
-    emit framesReceived();
 
-    return dlc + 8;
+    return PACKET_HEADER_SIZE + dlc;
 }
 
 void CanBusTcpUDT::stateChanged(QAbstractSocket::SocketState socketState)
@@ -165,6 +243,10 @@ void CanBusTcpUDT::stateChanged(QAbstractSocket::SocketState socketState)
             break;
 
         case QAbstractSocket::ConnectedState:
+            _sock->setSocketOption(QAbstractSocket::LowDelayOption, _lowDelay ? 1 : 0);
+            setState(CONNECTED);
+            break;
+
         case QAbstractSocket::ListeningState:
             setState(CONNECTED);
             break;
@@ -39,17 +39,30 @@ public:
     void disconnectDevice() override;
     QCanBusFrame readFrame() override;
     bool writeFrame(const QCanBusFrame &qtframe) override;
+    int writeFrames(const QCanBusFrame *qtframes, int count) override;
+
+    bool lowDelay() const;
+    void setLowDelay(bool lowDelay);
 
 private:
     QMutex _socketMutex;
     QTcpSocket *_sock;
     QQueue<QCanBusFrame> _queue;
+    bool _lowDelay;
+
+    enum
+    {
+        PACKET_HEADER_SIZE = 8,  // magic, bus id, flags, dlc, frame id (u32)
+        BUFFER_SIZE = 16384
+    };
+    QByteArray _rxBuffer;
+    QByteArray _txBuffer;
 
 protected slots:
     void readTCP();
 
 protected:
-    int readPacket(QByteArray data);
+    int readPacket(const char *data, int size);
     void stateChanged(QAbstractSocket::SocketState socketState);
 };
 
@@ -0,0 +1,373 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "cancapturereader.h"
+
+#include <QDateTime>
+#include <QTextStream>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+#include "canframelog.h"
+#include "cancapturewriter.h"
+
+CanCaptureReader::CanCaptureReader()
+{
+    _data = nullptr;
+    _size = 0;
+    _frameCount = 0;
+    _cursorChunk = 0;
+    _cursorOffset = 0;
+    _cursorIndex = 0;
+}
+
+CanCaptureReader::~CanCaptureReader()
+{
+    close();
+}
+
+bool CanCaptureReader::open(const QString &fileName)
+{
+    close();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    _size = _file.size();
+    if (_size < CanCaptureWriter::FILE_HEADER_SIZE)
+    {
+        close();
+        return false;
+    }
+    _data = _file.map(0, _size);
+    if (_data == nullptr || memcmp(_data, "UCAP", 4) != 0 || qFromLittleEndian<quint32>(_data + 4) != CanCaptureWriter::VERSION)
+    {
+        close();
+        return false;
+    }
+
+    if (!loadIndex())
+    {
+        scanChunks();
+    }
+    seek(0);
+    return true;
+}
+
+bool CanCaptureReader::isOpen() const
+{
+    return _data != nullptr;
+}
+
+void CanCaptureReader::close()
+{
+    if (_data != nullptr)
+    {
+        _file.unmap(const_cast<uchar *>(_data));
+        _data = nullptr;
+    }
+    _file.close();
+    _size = 0;
+    _chunks.clear();
+    _frameCount = 0;
+}
+
+QString CanCaptureReader::fileName() const
+{
+    return _file.fileName();
+}
+
+qint64 CanCaptureReader::frameCount() const
+{
+    return _frameCount;
+}
+
+int CanCaptureReader::chunkCount() const
+{
+    return _chunks.count();
+}
+
+qint64 CanCaptureReader::firstTimeStamp() const
+{
+    if (_chunks.isEmpty())
+    {
+        return 0;
+    }
+    return _chunks.first().firstStamp;
+}
+
+qint64 CanCaptureReader::lastTimeStamp() const
+{
+    if (_chunks.isEmpty())
+    {
+        return 0;
+    }
+    return _chunks.last().lastStamp;
+}
+
+/**
+ * @brief Frame at index, moves the read cursor after it
+ * @return an invalid frame if index is out of the capture
+ */
+QCanBusFrame CanCaptureReader::frame(qint64 index)
+{
+    QCanBusFrame frame(QCanBusFrame::InvalidFrame);
+    if (index != _cursorIndex && !seek(index))
+    {
+        return frame;
+    }
+    readNext(frame);
+    return frame;
+}
+
+/**
+ * @brief Moves the read cursor to frame index
+ */
+bool CanCaptureReader::seek(qint64 index)
+{
+    if (index < 0 || index > _frameCount)
+    {
+        return false;
+    }
+
+    QVector<Chunk>::const_iterator chunkIt = std::upper_bound(_chunks.cbegin(), _chunks.cend(), index, [](qint64 value, const Chunk &chunk) {
+        return value < chunk.firstFrame;
+    });
+    if (chunkIt != _chunks.cbegin())
+    {
+        --chunkIt;
+    }
+    _cursorChunk = static_cast<int>(chunkIt - _chunks.cbegin());
+    _cursorOffset = 0;
+    _cursorIndex = (_chunks.isEmpty()) ? 0 : chunkIt->firstFrame;
+
+    // records are variable sized, walk inside the chunk
+    QCanBusFrame frame;
+    while (_cursorIndex < index)
+    {
+        if (!readNext(frame))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+qint64 CanCaptureReader::position() const
+{
+    return _cursorIndex;
+}
+
+bool CanCaptureReader::readNext(QCanBusFrame &frame)
+{
+    while (_cursorChunk < _chunks.count())
+    {
+        const Chunk &chunk = _chunks.at(_cursorChunk);
+        if (_cursorOffset < chunk.size)
+        {
+            int size = CanFrameLog::decodeFrame(reinterpret_cast<const char *>(_data + chunk.offset + _cursorOffset), chunk.size - _cursorOffset, frame);
+            if (size > 0)
+            {
+                _cursorOffset += size;
+                _cursorIndex++;
+                return true;
+            }
+        }
+        _cursorChunk++;
+        _cursorOffset = 0;
+    }
+    return false;
+}
+
+bool CanCaptureReader::readChunkHeader(qint64 offset, qint64 firstFrame, Chunk &chunk) const
+{
+    if (offset < 0 || offset + CanCaptureWriter::CHUNK_HEADER_SIZE > _size)
+    {
+        return false;
+    }
+    const uchar *header = _data + offset;
+    if (memcmp(header, "CHNK", 4) != 0)
+    {
+        return false;
+    }
+    chunk.count = static_cast<int>(qFromLittleEndian<quint32>(header + 4));
+    chunk.size = static_cast<int>(qFromLittleEndian<quint32>(header + 8));
+    chunk.firstStamp = qFromLittleEndian<qint64>(header + 16);
+    chunk.lastStamp = qFromLittleEndian<qint64>(header + 24);
+    chunk.offset = offset + CanCaptureWriter::CHUNK_HEADER_SIZE;
+    chunk.firstFrame = firstFrame;
+    return (chunk.offset + chunk.size <= _size);
+}
+
+bool CanCaptureReader::loadIndex()
+{
+    if (_size < CanCaptureWriter::FILE_HEADER_SIZE + CanCaptureWriter::TRAILER_SIZE)
+    {
+        return false;
+    }
+    const uchar *trailer = _data + _size - CanCaptureWriter::TRAILER_SIZE;
+    if (memcmp(trailer + 8, "UEND", 4) != 0)
+    {
+        return false;
+    }
+    qint64 indexOffset = qFromLittleEndian<qint64>(trailer);
+    if (indexOffset < CanCaptureWriter::FILE_HEADER_SIZE || indexOffset + 8 > _size - CanCaptureWriter::TRAILER_SIZE || memcmp(_data + indexOffset, "CIDX", 4) != 0)
+    {
+        return false;
+    }
+    quint32 count = qFromLittleEndian<quint32>(_data + indexOffset + 4);
+    if (indexOffset + 8 + static_cast<qint64>(count) * CanCaptureWriter::INDEX_ENTRY_SIZE > _size - CanCaptureWriter::TRAILER_SIZE)
+    {
+        return false;
+    }
+
+    QVector<Chunk> chunks;
+    chunks.reserve(static_cast<int>(count));
+    qint64 frameCount = 0;
+    for (quint32 i = 0; i < count; i++)
+    {
+        const uchar *entry = _data + indexOffset + 8 + i * CanCaptureWriter::INDEX_ENTRY_SIZE;
+        Chunk chunk;
+        if (!readChunkHeader(qFromLittleEndian<qint64>(entry), qFromLittleEndian<qint64>(entry + 8), chunk))
+        {
+            return false;
+        }
+        chunks.append(chunk);
+        frameCount = chunk.firstFrame + chunk.count;
+    }
+    _chunks.swap(chunks);
+    _frameCount = frameCount;
+    return true;
+}
+
+/**
+ * @brief Rebuilds the chunk list from the chunk headers, used for files without trailer
+ */
+void CanCaptureReader::scanChunks()
+{
+    _chunks.clear();
+    _frameCount = 0;
+
+    qint64 offset = CanCaptureWriter::FILE_HEADER_SIZE;
+    Chunk chunk;
+    while (readChunkHeader(offset, _frameCount, chunk))
+    {
+        _chunks.append(chunk);
+        _frameCount += chunk.count;
+        offset = chunk.offset + chunk.size;
+    }
+}
+
+/**
+ * @brief Writes all the frames in candump log format ('candump -l')
+ */
+bool CanCaptureReader::exportCandump(const QString &candumpFileName, const QString &interfaceName)
+{
+    QFile output(candumpFileName);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        return false;
+    }
+    QTextStream stream(&output);
+
+    seek(0);
+    QCanBusFrame frame;
+    while (readNext(frame))
+    {
+        if (frame.frameType() != QCanBusFrame::DataFrame && frame.frameType() != QCanBusFrame::RemoteRequestFrame)
+        {
+            continue;
+        }
+
+        stream << '(' << frame.timeStamp().seconds() << '.' << QString::number(frame.timeStamp().microSeconds()).rightJustified(6, '0') << ") " << interfaceName
+               << ' ' << QString::number(frame.frameId(), 16).toUpper().rightJustified(frame.hasExtendedFrameFormat() ? 8 : 3, '0') << '#';
+        if (frame.frameType() == QCanBusFrame::RemoteRequestFrame)
+        {
+            stream << 'R';
+        }
+        else
+        {
+            if (frame.hasFlexibleDataRateFormat())
+            {
+                int flags = (frame.hasBitrateSwitch() ? 0x01 : 0) | (frame.hasErrorStateIndicator() ? 0x02 : 0);
+                stream << '#' << QString::number(flags, 16).toUpper();
+            }
+            stream << QByteArray(frame.payloadData(), frame.payloadSize()).toHex().toUpper();
+        }
+        stream << '\n';
+    }
+    return true;
+}
+
+/**
+ * @brief Writes all the frames in Vector ASC format, time stamps relative to the first frame
+ */
+bool CanCaptureReader::exportAsc(const QString &ascFileName)
+{
+    QFile output(ascFileName);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        return false;
+    }
+    QTextStream stream(&output);
+
+    qint64 startStamp = firstTimeStamp();
+    stream << "date " << QDateTime::fromMSecsSinceEpoch(startStamp / 1000000).toString(QStringLiteral("ddd MMM dd hh:mm:ss.zzz yyyy")) << '\n';
+    stream << "base hex  timestamps absolute\n";
+    stream << "no internal events logged\n";
+    stream << "Begin Triggerblock\n";
+
+    seek(0);
+    QCanBusFrame frame;
+    while (readNext(frame))
+    {
+        if (frame.frameType() != QCanBusFrame::DataFrame && frame.frameType() != QCanBusFrame::RemoteRequestFrame)
+        {
+            continue;
+        }
+
+        qint64 stamp = frame.timeStamp().toNanoSeconds() - startStamp;
+        QString id = QString::number(frame.frameId(), 16).toUpper();
+        if (frame.hasExtendedFrameFormat())
+        {
+            id.append('x');
+        }
+        stream << QString::number(stamp / 1000000000).rightJustified(4, ' ') << '.' << QString::number((stamp % 1000000000) / 1000).rightJustified(6, '0') << " 1  "
+               << id.leftJustified(15, ' ') << (frame.hasLocalEcho() ? " Tx   " : " Rx   ");
+        if (frame.frameType() == QCanBusFrame::RemoteRequestFrame)
+        {
+            stream << "r";
+        }
+        else
+        {
+            stream << "d " << frame.payloadSize();
+            for (int i = 0; i < frame.payloadSize(); i++)
+            {
+                stream << ' ' << QString::number(static_cast<quint8>(frame.payloadData()[i]), 16).toUpper().rightJustified(2, '0');
+            }
+        }
+        stream << '\n';
+    }
+
+    stream << "End TriggerBlock\n";
+    return true;
+}
@@ -0,0 +1,87 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANCAPTUREREADER_H
+#define CANCAPTUREREADER_H
+
+#include "canopen_global.h"
+
+#include <QFile>
+#include <QVector>
+
+#include "busdriver/qcanbusframe.h"
+
+/**
+ * @brief Memory mapped reader of CAN capture files written by CanCaptureWriter
+ *
+ * Frames can be read sequentially with readNext() or randomly with frame(), chunks are located
+ * with the file chunk index, or by scanning the chunk headers if the file has no trailer.
+ */
+class CANOPEN_EXPORT CanCaptureReader
+{
+public:
+    CanCaptureReader();
+    ~CanCaptureReader();
+
+    bool open(const QString &fileName);
+    bool isOpen() const;
+    void close();
+    QString fileName() const;
+
+    qint64 frameCount() const;
+    int chunkCount() const;
+    qint64 firstTimeStamp() const;
+    qint64 lastTimeStamp() const;
+
+    QCanBusFrame frame(qint64 index);
+    bool seek(qint64 index);
+    qint64 position() const;
+    bool readNext(QCanBusFrame &frame);
+
+    // conversion to text captures
+    bool exportCandump(const QString &candumpFileName, const QString &interfaceName = QStringLiteral("can0"));
+    bool exportAsc(const QString &ascFileName);
+
+private:
+    QFile _file;
+    const uchar *_data;
+    qint64 _size;
+
+    struct Chunk
+    {
+        qint64 offset;  // first record offset
+        int size;
+        int count;
+        qint64 firstFrame;
+        qint64 firstStamp;
+        qint64 lastStamp;
+    };
+    QVector<Chunk> _chunks;
+    qint64 _frameCount;
+
+    bool readChunkHeader(qint64 offset, qint64 firstFrame, Chunk &chunk) const;
+    bool loadIndex();
+    void scanChunks();
+
+    // sequential read cursor
+    int _cursorChunk;
+    int _cursorOffset;
+    qint64 _cursorIndex;
+};
+
+#endif  // CANCAPTUREREADER_H
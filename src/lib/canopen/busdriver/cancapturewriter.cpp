@@ -0,0 +1,322 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "cancapturewriter.h"
+
+#include <QRegularExpression>
+#include <QTextStream>
+#include <QtEndian>
+
+#include "canframelog.h"
+
+CanCaptureWriter::CanCaptureWriter()
+{
+    _chunkFrameCount = 0;
+    _chunkFirstStamp = 0;
+    _chunkLastStamp = 0;
+    _frameCount = 0;
+}
+
+CanCaptureWriter::~CanCaptureWriter()
+{
+    close();
+}
+
+/**
+ * @brief Creates or truncates fileName and writes the file header
+ */
+bool CanCaptureWriter::open(const QString &fileName)
+{
+    close();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    uchar header[FILE_HEADER_SIZE] = {'U', 'C', 'A', 'P'};
+    qToLittleEndian<quint32>(VERSION, header + 4);
+    qToLittleEndian<quint64>(0, header + 8);
+    if (_file.write(reinterpret_cast<const char *>(header), FILE_HEADER_SIZE) != FILE_HEADER_SIZE)
+    {
+        _file.close();
+        return false;
+    }
+
+    _chunk.clear();
+    _chunk.reserve(CHUNK_FRAMES * 22);
+    _chunkFrameCount = 0;
+    _frameCount = 0;
+    _chunks.clear();
+    return true;
+}
+
+bool CanCaptureWriter::isOpen() const
+{
+    return _file.isOpen();
+}
+
+/**
+ * @brief Writes the pending chunk, the chunk index and the trailer, then closes the file
+ */
+void CanCaptureWriter::close()
+{
+    if (!_file.isOpen())
+    {
+        return;
+    }
+
+    flush();
+
+    qint64 indexOffset = _file.pos();
+    QByteArray index;
+    uchar indexHeader[8] = {'C', 'I', 'D', 'X'};
+    qToLittleEndian<quint32>(static_cast<quint32>(_chunks.count()), indexHeader + 4);
+    index.append(reinterpret_cast<const char *>(indexHeader), 8);
+    for (const ChunkIndex &chunk : qAsConst(_chunks))
+    {
+        uchar entry[INDEX_ENTRY_SIZE];
+        qToLittleEndian<qint64>(chunk.offset, entry);
+        qToLittleEndian<qint64>(chunk.firstFrame, entry + 8);
+        qToLittleEndian<qint64>(chunk.firstStamp, entry + 16);
+        index.append(reinterpret_cast<const char *>(entry), INDEX_ENTRY_SIZE);
+    }
+
+    uchar trailer[TRAILER_SIZE];
+    qToLittleEndian<qint64>(indexOffset, trailer);
+    trailer[8] = 'U';
+    trailer[9] = 'E';
+    trailer[10] = 'N';
+    trailer[11] = 'D';
+    index.append(reinterpret_cast<const char *>(trailer), TRAILER_SIZE);
+
+    _file.write(index);
+    _file.close();
+}
+
+QString CanCaptureWriter::fileName() const
+{
+    return _file.fileName();
+}
+
+bool CanCaptureWriter::append(const QCanBusFrame &frame)
+{
+    if (!_file.isOpen())
+    {
+        return false;
+    }
+
+    qint64 stamp = frame.timeStamp().toNanoSeconds();
+    if (_chunkFrameCount == 0)
+    {
+        _chunkFirstStamp = stamp;
+    }
+    _chunkLastStamp = stamp;
+
+    CanFrameLog::encodeFrame(_chunk, frame);
+    _chunkFrameCount++;
+    _frameCount++;
+
+    if (_chunkFrameCount >= CHUNK_FRAMES)
+    {
+        return flush();
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the frames appended since the last chunk as a new chunk
+ */
+bool CanCaptureWriter::flush()
+{
+    if (!_file.isOpen() || _chunkFrameCount == 0)
+    {
+        return true;
+    }
+
+    uchar header[CHUNK_HEADER_SIZE] = {'C', 'H', 'N', 'K'};
+    qToLittleEndian<quint32>(static_cast<quint32>(_chunkFrameCount), header + 4);
+    qToLittleEndian<quint32>(static_cast<quint32>(_chunk.size()), header + 8);
+    qToLittleEndian<quint32>(0, header + 12);
+    qToLittleEndian<qint64>(_chunkFirstStamp, header + 16);
+    qToLittleEndian<qint64>(_chunkLastStamp, header + 24);
+
+    qint64 offset = _file.pos();
+    bool ok = (_file.write(reinterpret_cast<const char *>(header), CHUNK_HEADER_SIZE) == CHUNK_HEADER_SIZE);
+    ok = ok && (_file.write(_chunk) == _chunk.size());
+    _file.flush();
+
+    _chunks.append(ChunkIndex{offset, _frameCount - _chunkFrameCount, _chunkFirstStamp});
+    _chunk.clear();
+    _chunkFrameCount = 0;
+    return ok;
+}
+
+qint64 CanCaptureWriter::frameCount() const
+{
+    return _frameCount;
+}
+
+// fractional part of a decimal time stamp string to ns
+static qint64 fractionToNanoSeconds(const QString &fraction)
+{
+    return fraction.left(9).leftJustified(9, '0').toLongLong();
+}
+
+/**
+ * @brief Converts a candump log file ('candump -l' format) to a capture file
+ *
+ * Line format: "(seconds.fraction) interface id#data", "id#R" for remote requests and
+ * "id##<flags>data" for CAN FD. Identifiers written with 8 digits are extended ones.
+ */
+bool CanCaptureWriter::importCandump(const QString &candumpFileName, const QString &captureFileName)
+{
+    QFile input(candumpFileName);
+    if (!input.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return false;
+    }
+    CanCaptureWriter writer;
+    if (!writer.open(captureFileName))
+    {
+        return false;
+    }
+
+    QRegularExpression lineRegExp(QStringLiteral("^\\((\\d+)\\.(\\d+)\\)\\s+(\\S+)\\s+([0-9A-Fa-f]+)#(.*)$"));
+    QTextStream stream(&input);
+    while (!stream.atEnd())
+    {
+        const QString line = stream.readLine().trimmed();
+        QRegularExpressionMatch match = lineRegExp.match(line);
+        if (!match.hasMatch())
+        {
+            continue;
+        }
+
+        QCanBusFrame frame;
+        const QString idString = match.captured(4);
+        frame.setExtendedFrameFormat(idString.size() > 3);
+        frame.setFrameId(idString.toUInt(nullptr, 16));
+        frame.setTimeStamp(QCanBusFrame::TimeStamp::fromNanoSeconds(match.captured(1).toLongLong(), fractionToNanoSeconds(match.captured(2))));
+
+        QString data = match.captured(5);
+        if (data.startsWith('R'))
+        {
+            frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+            data.clear();
+        }
+        else if (data.startsWith('#'))
+        {
+            // CAN FD, one flags digit
+            int flags = data.mid(1, 1).toInt(nullptr, 16);
+            frame.setFlexibleDataRateFormat(true);
+            frame.setBitrateSwitch((flags & 0x01) != 0);
+            frame.setErrorStateIndicator((flags & 0x02) != 0);
+            data = data.mid(2);
+        }
+        data.remove('.');
+        frame.setPayload(QByteArray::fromHex(data.toLatin1()));
+
+        writer.append(frame);
+    }
+
+    writer.close();
+    return true;
+}
+
+/**
+ * @brief Converts a Vector ASC log file to a capture file, only CAN data and remote frames are kept
+ */
+bool CanCaptureWriter::importAsc(const QString &ascFileName, const QString &captureFileName)
+{
+    QFile input(ascFileName);
+    if (!input.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return false;
+    }
+    CanCaptureWriter writer;
+    if (!writer.open(captureFileName))
+    {
+        return false;
+    }
+
+    // data bytes are two hex digits, or one to three digits with base dec
+    const QString linePattern(QStringLiteral("^(\\d+)\\.(\\d+)\\s+\\d+\\s+([0-9A-Fa-f]+)(x?)\\s+(Rx|Tx)\\s+([dr])(?:\\s+([0-9A-Fa-f]+))?((?:\\s+%1)*)"));
+    QRegularExpression hexLineRegExp(linePattern.arg(QStringLiteral("[0-9A-Fa-f]{2}")));
+    QRegularExpression decLineRegExp(linePattern.arg(QStringLiteral("\\d{1,3}")));
+    bool decimalBase = false;
+    bool relativeTime = false;
+    qint64 lastStamp = 0;
+
+    QTextStream stream(&input);
+    while (!stream.atEnd())
+    {
+        const QString line = stream.readLine().trimmed();
+        if (line.startsWith(QLatin1String("base")))
+        {
+            decimalBase = line.contains(QLatin1String(" dec"));
+            relativeTime = line.contains(QLatin1String("relative"));
+            continue;
+        }
+
+        QRegularExpressionMatch match = decimalBase ? decLineRegExp.match(line) : hexLineRegExp.match(line);
+        if (!match.hasMatch())
+        {
+            continue;
+        }
+
+        int base = decimalBase ? 10 : 16;
+        qint64 stamp = match.captured(1).toLongLong() * 1000000000 + fractionToNanoSeconds(match.captured(2));
+        if (relativeTime)
+        {
+            stamp += lastStamp;
+        }
+        lastStamp = stamp;
+
+        QCanBusFrame frame;
+        frame.setExtendedFrameFormat(!match.captured(4).isEmpty());
+        frame.setFrameId(match.captured(3).toUInt(nullptr, base));
+        frame.setTimeStamp(QCanBusFrame::TimeStamp::fromNanoSeconds(stamp));
+        frame.setLocalEcho(match.captured(5) == QLatin1String("Tx"));
+        if (match.captured(6) == QLatin1String("r"))
+        {
+            frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+        }
+        else
+        {
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+            const QStringList bytes = match.captured(8).split(' ', QString::SkipEmptyParts);
+#else
+            const QStringList bytes = match.captured(8).split(' ', Qt::SkipEmptyParts);
+#endif
+            int dlc = match.captured(7).toInt(nullptr, base);
+            QByteArray payload;
+            for (int i = 0; i < bytes.count() && i < dlc; i++)
+            {
+                payload.append(static_cast<char>(bytes.at(i).toUInt(nullptr, base)));
+            }
+            frame.setPayload(payload);
+        }
+
+        writer.append(frame);
+    }
+
+    writer.close();
+    return true;
+}
@@ -0,0 +1,87 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANCAPTUREWRITER_H
+#define CANCAPTUREWRITER_H
+
+#include "canopen_global.h"
+
+#include <QFile>
+#include <QVector>
+
+#include "busdriver/qcanbusframe.h"
+
+/**
+ * @brief Append-only writer of CAN capture files
+ *
+ * File layout, little endian:
+ *  - file header (16 bytes): "UCAP", version (u32), reserved (u64)
+ *  - chunks: "CHNK", frame count (u32), records size (u32), reserved (u32), first and last
+ *    time stamps in ns (2 * i64), then the frame records (see CanFrameLog::encodeFrame())
+ *  - chunk index written by close(): "CIDX", chunk count (u32), then per chunk its file offset
+ *    (u64), absolute index of its first frame (u64) and first time stamp (i64)
+ *  - trailer (12 bytes): index offset (u64), "UEND"
+ * A file without trailer (capture interrupted) is still readable by scanning the chunks.
+ */
+class CANOPEN_EXPORT CanCaptureWriter
+{
+public:
+    CanCaptureWriter();
+    ~CanCaptureWriter();
+
+    bool open(const QString &fileName);
+    bool isOpen() const;
+    void close();
+    QString fileName() const;
+
+    bool append(const QCanBusFrame &frame);
+    bool flush();
+    qint64 frameCount() const;
+
+    // conversion from text captures
+    static bool importCandump(const QString &candumpFileName, const QString &captureFileName);
+    static bool importAsc(const QString &ascFileName, const QString &captureFileName);
+
+    enum
+    {
+        CHUNK_FRAMES = 4096,
+        FILE_HEADER_SIZE = 16,
+        CHUNK_HEADER_SIZE = 32,
+        INDEX_ENTRY_SIZE = 24,
+        TRAILER_SIZE = 12,
+        VERSION = 1
+    };
+
+private:
+    QFile _file;
+    QByteArray _chunk;
+    int _chunkFrameCount;
+    qint64 _chunkFirstStamp;
+    qint64 _chunkLastStamp;
+    qint64 _frameCount;
+
+    struct ChunkIndex
+    {
+        qint64 offset;
+        qint64 firstFrame;
+        qint64 firstStamp;
+    };
+    QVector<ChunkIndex> _chunks;
+};
+
+#endif  // CANCAPTUREWRITER_H
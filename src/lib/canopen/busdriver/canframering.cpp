@@ -0,0 +1,149 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "canframering.h"
+
+CanFrameRing::CanFrameRing(int capacity)
+{
+    quint32 size = 16;
+    while (size < static_cast<quint32>(capacity))
+    {
+        size <<= 1;
+    }
+    _frames = new Frame[size];
+    _mask = size - 1;
+    _head.storeRelease(0);
+    _tail.storeRelease(0);
+    _dropped.storeRelease(0);
+}
+
+CanFrameRing::~CanFrameRing()
+{
+    delete[] _frames;
+}
+
+int CanFrameRing::capacity() const
+{
+    return static_cast<int>(_mask + 1);
+}
+
+int CanFrameRing::count() const
+{
+    return static_cast<int>(_head.loadAcquire() - _tail.loadAcquire());
+}
+
+bool CanFrameRing::isEmpty() const
+{
+    return _head.loadAcquire() == _tail.loadAcquire();
+}
+
+/**
+ * @brief Discards all pending frames, must only be called while the producer is stopped
+ */
+void CanFrameRing::clear()
+{
+    _tail.storeRelease(_head.loadAcquire());
+}
+
+/**
+ * @brief Returns the next free slot or nullptr if the ring is full, the slot is published by commit()
+ */
+CanFrameRing::Frame *CanFrameRing::reserve()
+{
+    quint32 head = _head.loadAcquire();
+    if (head - _tail.loadAcquire() > _mask)
+    {
+        return nullptr;
+    }
+    return &_frames[head & _mask];
+}
+
+void CanFrameRing::commit()
+{
+    _head.storeRelease(_head.loadAcquire() + 1);
+}
+
+bool CanFrameRing::push(const Frame &frame)
+{
+    Frame *slot = reserve();
+    if (slot == nullptr)
+    {
+        drop();
+        return false;
+    }
+    *slot = frame;
+    commit();
+    return true;
+}
+
+void CanFrameRing::drop(quint32 count)
+{
+    _dropped.fetchAndAddRelaxed(count);
+}
+
+bool CanFrameRing::pop(QCanBusFrame &frame)
+{
+    quint32 tail = _tail.loadAcquire();
+    if (tail == _head.loadAcquire())
+    {
+        return false;
+    }
+    frame = toCanBusFrame(_frames[tail & _mask]);
+    _tail.storeRelease(tail + 1);
+    return true;
+}
+
+int CanFrameRing::pop(QCanBusFrame *frames, int maxCount)
+{
+    quint32 tail = _tail.loadAcquire();
+    quint32 available = _head.loadAcquire() - tail;
+    int count = qMin(static_cast<int>(available), maxCount);
+    for (int i = 0; i < count; i++)
+    {
+        frames[i] = toCanBusFrame(_frames[(tail + static_cast<quint32>(i)) & _mask]);
+    }
+    _tail.storeRelease(tail + static_cast<quint32>(count));
+    return count;
+}
+
+quint32 CanFrameRing::droppedCount() const
+{
+    return _dropped.loadAcquire();
+}
+
+QCanBusFrame CanFrameRing::toCanBusFrame(const Frame &frame)
+{
+    QCanBusFrame qtFrame;
+    qtFrame.setFrameId(frame.canId);
+    qtFrame.setExtendedFrameFormat((frame.flags & FlagExtended) != 0);
+    qtFrame.setPayload(reinterpret_cast<const char *>(frame.data), frame.dlc);
+    qtFrame.setTimeStamp(QCanBusFrame::TimeStamp::fromNanoSeconds(frame.seconds, frame.nanoSeconds));
+    if ((frame.flags & FlagError) != 0)
+    {
+        qtFrame.setFrameType(QCanBusFrame::ErrorFrame);
+    }
+    else if ((frame.flags & FlagRemoteRequest) != 0)
+    {
+        qtFrame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+    }
+    else
+    {
+        qtFrame.setFrameType(QCanBusFrame::DataFrame);
+    }
+    return qtFrame;
+}
@@ -0,0 +1,89 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANFRAMERING_H
+#define CANFRAMERING_H
+
+#include "canopen_global.h"
+
+#include <QAtomicInteger>
+
+#include "busdriver/qcanbusframe.h"
+
+/**
+ * @brief Single producer / single consumer lock-free ring of raw CAN frames
+ *
+ * The producer (driver reader thread) only writes _head, the consumer (bus thread) only
+ * writes _tail. Capacity is rounded up to a power of two. When the ring is full, new frames
+ * are dropped and counted.
+ */
+class CANOPEN_EXPORT CanFrameRing
+{
+public:
+    CanFrameRing(int capacity = 4096);
+    ~CanFrameRing();
+
+    struct Frame
+    {
+        quint32 canId;  // 29 bits identifier
+        quint8 flags;   // Flag
+        quint8 dlc;
+        quint8 data[8];
+        qint64 seconds;
+        qint64 nanoSeconds;
+    };
+    enum Flag : quint8
+    {
+        FlagExtended = 0x01,
+        FlagRemoteRequest = 0x02,
+        FlagError = 0x04
+    };
+
+    int capacity() const;
+    int count() const;
+    bool isEmpty() const;
+    void clear();
+
+    // producer side
+    Frame *reserve();
+    void commit();
+    bool push(const Frame &frame);
+    void drop(quint32 count = 1);
+
+    // consumer side
+    bool pop(QCanBusFrame &frame);
+    int pop(QCanBusFrame *frames, int maxCount);
+
+    quint32 droppedCount() const;
+
+    static QCanBusFrame toCanBusFrame(const Frame &frame);
+
+private:
+    Frame *_frames;
+    quint32 _mask;
+
+    // head and tail are kept on different cache lines to avoid false sharing
+    char _pad0[64];
+    QAtomicInteger<quint32> _head;
+    char _pad1[64];
+    QAtomicInteger<quint32> _tail;
+    char _pad2[64];
+    QAtomicInteger<quint32> _dropped;
+};
+
+#endif  // CANFRAMERING_H
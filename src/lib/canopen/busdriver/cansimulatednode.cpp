@@ -0,0 +1,914 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "cansimulatednode.h"
+
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <cstring>
+
+#include "model/deviceconfiguration.h"
+#include "parser/edsparser.h"
+
+enum
+{
+    SDO_CLIENT_COBID = 0x600,
+    SDO_SERVER_COBID = 0x580,
+    HEARTBEAT_COBID = 0x700,
+    SDO_BLOCK_SIZE = 127,
+
+    SDO_ABORT_TOGGLE = 0x05030000,
+    SDO_ABORT_CMD_NOT_VALID = 0x05040001,
+    SDO_ABORT_INVALID_BLOCK_SIZE = 0x05040002,
+    SDO_ABORT_INVALID_SEQ_NUMBER = 0x05040003,
+    SDO_ABORT_CRC_ERROR = 0x05040004,
+    SDO_ABORT_WRITE_ONLY = 0x06010001,
+    SDO_ABORT_READ_ONLY = 0x06010002,
+    SDO_ABORT_NO_OBJECT = 0x06020000,
+    SDO_ABORT_LENGTH_DOESNT_MATCH = 0x06070010,
+    SDO_ABORT_NO_SUBINDEX = 0x06090011
+};
+
+static QByteArray encodeValue(const QVariant &value, SubIndex::DataType dataType, int length)
+{
+    switch (dataType)
+    {
+        case SubIndex::VISIBLE_STRING:
+            return value.toString().toLatin1();
+
+        case SubIndex::REAL32:
+        {
+            float fvalue = value.toFloat();
+            quint32 raw;
+            memcpy(&raw, &fvalue, sizeof(raw));
+            QByteArray data(4, 0);
+            qToLittleEndian(raw, reinterpret_cast<uchar *>(data.data()));
+            return data;
+        }
+
+        case SubIndex::REAL64:
+        {
+            double dvalue = value.toDouble();
+            quint64 raw;
+            memcpy(&raw, &dvalue, sizeof(raw));
+            QByteArray data(8, 0);
+            qToLittleEndian(raw, reinterpret_cast<uchar *>(data.data()));
+            return data;
+        }
+
+        default:
+            break;
+    }
+
+    if (length == 0)
+    {
+        return value.toByteArray();
+    }
+
+    quint64 raw = (dataType == SubIndex::UNSIGNED64) ? value.toULongLong() : static_cast<quint64>(value.toLongLong());
+    QByteArray data(length, 0);
+    for (int i = 0; i < length; i++)
+    {
+        data[i] = static_cast<char>(raw >> (8 * i));
+    }
+    return data;
+}
+
+CanSimulatedNode::CanSimulatedNode(quint8 nodeId)
+    : _nodeId(nodeId)
+{
+    _state = StateBootUp;
+    _lastHeartbeatMs = 0;
+    _sdo.state = SdoIdle;
+    _sdo.index = 0;
+    _sdo.subIndex = 0;
+}
+
+quint8 CanSimulatedNode::nodeId() const
+{
+    return _nodeId;
+}
+
+/**
+ * @brief Builds the object dictionary from an EDS file, values are resolved for the node id
+ */
+bool CanSimulatedNode::loadEds(const QString &fileName)
+{
+    QString mfileName = QFileInfo(fileName).canonicalFilePath();
+
+    EdsParser parser;
+    DeviceDescription *deviceDescription = parser.parse(mfileName);
+    if (deviceDescription == nullptr)
+    {
+        return false;
+    }
+    DeviceConfiguration *deviceConfiguration = DeviceConfiguration::fromDeviceDescription(deviceDescription, _nodeId);
+    _edsFileName = mfileName;
+
+    _objects.clear();
+    _tpdos.clear();
+    for (Index *odIndex : qAsConst(deviceConfiguration->indexes()))
+    {
+        for (SubIndex *odSubIndex : odIndex->subIndexes())
+        {
+            Object object;
+            object.length = static_cast<quint8>(odSubIndex->length());
+            object.defaultValue = encodeValue(odSubIndex->value(), odSubIndex->dataType(), object.length);
+            object.value = object.defaultValue;
+            object.accessType = static_cast<quint8>(odSubIndex->accessType());
+            _objects.insert(key(odIndex->index(), odSubIndex->subIndex()), object);
+        }
+
+        if (odIndex->index() >= 0x1800 && odIndex->index() < 0x1A00)
+        {
+            Tpdo tpdo;
+            tpdo.number = odIndex->index() - 0x1800;
+            tpdo.syncCount = 0;
+            tpdo.lastEventMs = 0;
+            _tpdos.append(tpdo);
+        }
+    }
+
+    delete deviceDescription;
+    delete deviceConfiguration;
+
+    return true;
+}
+
+const QString &CanSimulatedNode::edsFileName() const
+{
+    return _edsFileName;
+}
+
+/**
+ * @brief Restores all objects to their EDS default value
+ */
+void CanSimulatedNode::resetValues()
+{
+    for (Object &object : _objects)
+    {
+        object.value = object.defaultValue;
+    }
+}
+
+CanSimulatedNode::State CanSimulatedNode::state() const
+{
+    return _state;
+}
+
+quint32 CanSimulatedNode::key(quint16 index, quint8 subIndex)
+{
+    return (static_cast<quint32>(index) << 8) | subIndex;
+}
+
+bool CanSimulatedNode::hasObject(quint16 index, quint8 subIndex) const
+{
+    return _objects.contains(key(index, subIndex));
+}
+
+QByteArray CanSimulatedNode::value(quint16 index, quint8 subIndex) const
+{
+    return _objects.value(key(index, subIndex)).value;
+}
+
+/**
+ * @brief Sets a raw little endian value, used by tests to make process data evolve
+ */
+bool CanSimulatedNode::setValue(quint16 index, quint8 subIndex, const QByteArray &value)
+{
+    QMap<quint32, Object>::iterator it = _objects.find(key(index, subIndex));
+    if (it == _objects.end())
+    {
+        return false;
+    }
+    if (it->length != 0)
+    {
+        // fixed size types are truncated or zero extended
+        it->value = value.left(it->length);
+        it->value.append(QByteArray(it->length - it->value.size(), 0));
+    }
+    else
+    {
+        it->value = value;
+    }
+    return true;
+}
+
+quint32 CanSimulatedNode::valueU32(quint16 index, quint8 subIndex, quint32 defaultValue) const
+{
+    QMap<quint32, Object>::const_iterator it = _objects.constFind(key(index, subIndex));
+    if (it == _objects.constEnd())
+    {
+        return defaultValue;
+    }
+    quint32 value = 0;
+    for (int i = 0; i < qMin(4, it->value.size()); i++)
+    {
+        value |= static_cast<quint32>(static_cast<quint8>(it->value[i])) << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief Enters pre-operational state and sends the bootup message
+ */
+void CanSimulatedNode::bootUp(qint64 nowMs, QVector<QCanBusFrame> &responses)
+{
+    _state = StatePreOperational;
+    _sdo.state = SdoIdle;
+    _lastHeartbeatMs = nowMs;
+    for (Tpdo &tpdo : _tpdos)
+    {
+        tpdo.syncCount = 0;
+        tpdo.lastEventMs = nowMs;
+    }
+
+    const char bootUp = 0x00;
+    QCanBusFrame frame;
+    frame.setFrameId(HEARTBEAT_COBID + _nodeId);
+    frame.setPayload(&bootUp, 1);
+    responses.append(frame);
+}
+
+void CanSimulatedNode::processFrame(const QCanBusFrame &frame, qint64 nowMs, QVector<QCanBusFrame> &responses)
+{
+    if (frame.frameType() != QCanBusFrame::DataFrame || frame.hasExtendedFrameFormat())
+    {
+        return;
+    }
+
+    quint32 cobId = frame.frameId();
+    if (cobId == 0x000)
+    {
+        processNmt(frame, nowMs, responses);
+    }
+    else if (_state == StateBootUp || _state == StateStopped)
+    {
+        return;
+    }
+    else if (cobId == (valueU32(0x1005, 0, 0x80) & 0x7FF))
+    {
+        processSync(nowMs, responses);
+    }
+    else if (cobId == SDO_CLIENT_COBID + _nodeId)
+    {
+        processSdo(frame, responses);
+    }
+}
+
+/**
+ * @brief Heartbeat producer and event driven TPDOs
+ */
+void CanSimulatedNode::processTime(qint64 nowMs, QVector<QCanBusFrame> &responses)
+{
+    if (_state == StateBootUp)
+    {
+        return;
+    }
+
+    quint32 heartbeatMs = valueU32(0x1017, 0) & 0xFFFF;
+    if (heartbeatMs > 0 && nowMs - _lastHeartbeatMs >= heartbeatMs)
+    {
+        const char state = static_cast<char>(_state);
+        QCanBusFrame frame;
+        frame.setFrameId(HEARTBEAT_COBID + _nodeId);
+        frame.setPayload(&state, 1);
+        responses.append(frame);
+
+        // keep the period without accumulating late ticks
+        _lastHeartbeatMs += heartbeatMs;
+        if (nowMs - _lastHeartbeatMs >= heartbeatMs)
+        {
+            _lastHeartbeatMs = nowMs;
+        }
+    }
+
+    if (_state != StateOperational)
+    {
+        return;
+    }
+    for (Tpdo &tpdo : _tpdos)
+    {
+        quint8 transmissionType = static_cast<quint8>(valueU32(0x1800 + tpdo.number, 2));
+        quint32 eventTimerMs = valueU32(0x1800 + tpdo.number, 5) & 0xFFFF;
+        if (transmissionType < 0xFE || eventTimerMs == 0 || nowMs - tpdo.lastEventMs < eventTimerMs)
+        {
+            continue;
+        }
+        tpdo.lastEventMs = nowMs;
+        QCanBusFrame frame;
+        if (tpdoFrame(tpdo.number, frame))
+        {
+            responses.append(frame);
+        }
+    }
+}
+
+void CanSimulatedNode::processNmt(const QCanBusFrame &frame, qint64 nowMs, QVector<QCanBusFrame> &responses)
+{
+    if (frame.payloadSize() < 2)
+    {
+        return;
+    }
+    quint8 command = static_cast<quint8>(frame.payloadData()[0]);
+    quint8 nodeId = static_cast<quint8>(frame.payloadData()[1]);
+    if (nodeId != 0 && nodeId != _nodeId)
+    {
+        return;
+    }
+
+    switch (command)
+    {
+        case 0x01:  // start
+            _state = StateOperational;
+            break;
+
+        case 0x02:  // stop
+            _state = StateStopped;
+            break;
+
+        case 0x80:  // pre-operational
+            _state = StatePreOperational;
+            break;
+
+        case 0x81:  // reset node
+            resetValues();
+            bootUp(nowMs, responses);
+            break;
+
+        case 0x82:  // reset communication
+            for (QMap<quint32, Object>::iterator it = _objects.begin(); it != _objects.end(); ++it)
+            {
+                if ((it.key() >> 8) >= 0x1000 && (it.key() >> 8) < 0x2000)
+                {
+                    it->value = it->defaultValue;
+                }
+            }
+            bootUp(nowMs, responses);
+            break;
+    }
+}
+
+void CanSimulatedNode::processSync(qint64 nowMs, QVector<QCanBusFrame> &responses)
+{
+    if (_state != StateOperational)
+    {
+        return;
+    }
+
+    for (Tpdo &tpdo : _tpdos)
+    {
+        quint8 transmissionType = static_cast<quint8>(valueU32(0x1800 + tpdo.number, 2));
+        if (transmissionType > 240)
+        {
+            continue;
+        }
+        // acyclic synchronous TPDOs (0) are sent on each SYNC as if their data always changed
+        tpdo.syncCount++;
+        if (transmissionType != 0 && tpdo.syncCount < transmissionType)
+        {
+            continue;
+        }
+        tpdo.syncCount = 0;
+        tpdo.lastEventMs = nowMs;
+        QCanBusFrame frame;
+        if (tpdoFrame(tpdo.number, frame))
+        {
+            responses.append(frame);
+        }
+    }
+}
+
+/**
+ * @brief Packs the mapped objects of a TPDO, bit by bit as described by the 0x1A00 mapping
+ */
+bool CanSimulatedNode::tpdoFrame(quint16 number, QCanBusFrame &frame) const
+{
+    quint32 cobId = valueU32(0x1800 + number, 1, 0x80000000);
+    if ((cobId & 0x80000000) != 0)
+    {
+        return false;
+    }
+
+    char buffer[8] = {0};
+    int bitPos = 0;
+    quint8 count = static_cast<quint8>(valueU32(0x1A00 + number, 0));
+    for (quint8 i = 1; i <= count; i++)
+    {
+        quint32 mapping = valueU32(0x1A00 + number, i);
+        int bitLength = static_cast<int>(mapping & 0xFF);
+        if (bitPos + bitLength > 64)
+        {
+            return false;
+        }
+
+        // dummy entries and unknown objects are sent as zeros
+        const QByteArray data = value(static_cast<quint16>(mapping >> 16), static_cast<quint8>(mapping >> 8));
+        for (int bit = 0; bit < bitLength && bit / 8 < data.size(); bit++)
+        {
+            if ((data[bit / 8] & (1 << (bit % 8))) != 0)
+            {
+                buffer[(bitPos + bit) / 8] |= static_cast<char>(1 << ((bitPos + bit) % 8));
+            }
+        }
+        bitPos += bitLength;
+    }
+
+    frame = QCanBusFrame();
+    frame.setFrameId(cobId & 0x7FF);
+    frame.setPayload(buffer, (bitPos + 7) / 8);
+    return true;
+}
+
+/**
+ * @brief CRC-16 CCITT as used by SDO block transfers (polynomial 0x1021, initial value 0)
+ */
+quint16 CanSimulatedNode::crc16(const char *data, int size, quint16 crc)
+{
+    for (int i = 0; i < size; i++)
+    {
+        crc ^= static_cast<quint16>(static_cast<quint8>(data[i]) << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? static_cast<quint16>((crc << 1) ^ 0x1021) : static_cast<quint16>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void CanSimulatedNode::processSdo(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    char request[8] = {0};
+    memcpy(request, frame.payloadData(), static_cast<size_t>(qMin(8, frame.payloadSize())));
+    QCanBusFrame sdoFrame;
+    sdoFrame.setFrameId(frame.frameId());
+    sdoFrame.setPayload(request, 8);
+
+    quint8 cmd = static_cast<quint8>(request[0]);
+    if (_sdo.state == SdoBlockDownloadSubBlock && cmd != 0x80)
+    {
+        sdoBlockDownloadSubBlock(sdoFrame, responses);
+        return;
+    }
+
+    switch (cmd >> 5)
+    {
+        case 0:  // download segment
+            sdoDownloadSegment(sdoFrame, responses);
+            break;
+
+        case 1:  // download initiate
+            sdoDownloadInitiate(sdoFrame, responses);
+            break;
+
+        case 2:  // upload initiate
+            sdoUploadInitiate(sdoFrame, responses);
+            break;
+
+        case 3:  // upload segment
+            sdoUploadSegment(sdoFrame, responses);
+            break;
+
+        case 4:  // abort from client
+            _sdo.state = SdoIdle;
+            break;
+
+        case 5:  // block upload
+            sdoBlockUpload(sdoFrame, responses);
+            break;
+
+        case 6:  // block download
+            sdoBlockDownload(sdoFrame, responses);
+            break;
+
+        default:
+            sdoAbort(qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(request + 1)),
+                     static_cast<quint8>(request[3]),
+                     SDO_ABORT_CMD_NOT_VALID,
+                     responses);
+            break;
+    }
+}
+
+quint32 CanSimulatedNode::checkAccess(quint16 index, quint8 subIndex, quint8 accessType) const
+{
+    QMap<quint32, Object>::const_iterator it = _objects.constFind(key(index, subIndex));
+    if (it == _objects.constEnd())
+    {
+        return hasObject(index, 0) ? SDO_ABORT_NO_SUBINDEX : SDO_ABORT_NO_OBJECT;
+    }
+    if ((it->accessType & accessType) == 0)
+    {
+        return (accessType == SubIndex::READ) ? SDO_ABORT_WRITE_ONLY : SDO_ABORT_READ_ONLY;
+    }
+    return 0;
+}
+
+quint32 CanSimulatedNode::writeObject(quint16 index, quint8 subIndex, const QByteArray &data)
+{
+    quint32 abortCode = checkAccess(index, subIndex, SubIndex::WRITE);
+    if (abortCode != 0)
+    {
+        return abortCode;
+    }
+    const Object &object = _objects[key(index, subIndex)];
+    if (object.length != 0 && data.size() < object.length)
+    {
+        return SDO_ABORT_LENGTH_DOESNT_MATCH;
+    }
+    setValue(index, subIndex, data);
+    return 0;
+}
+
+void CanSimulatedNode::sdoResponse(const char *data, QVector<QCanBusFrame> &responses) const
+{
+    QCanBusFrame frame;
+    frame.setFrameId(SDO_SERVER_COBID + _nodeId);
+    frame.setPayload(data, 8);
+    responses.append(frame);
+}
+
+void CanSimulatedNode::sdoAbort(quint16 index, quint8 subIndex, quint32 abortCode, QVector<QCanBusFrame> &responses)
+{
+    char response[8];
+    response[0] = static_cast<char>(0x80);
+    qToLittleEndian(index, reinterpret_cast<uchar *>(response + 1));
+    response[3] = static_cast<char>(subIndex);
+    qToLittleEndian(abortCode, reinterpret_cast<uchar *>(response + 4));
+    sdoResponse(response, responses);
+    _sdo.state = SdoIdle;
+}
+
+/**
+ * @brief Answers an SDO request with an abort, used for error injection
+ */
+void CanSimulatedNode::abortSdo(const QCanBusFrame &request, quint32 abortCode, QVector<QCanBusFrame> &responses)
+{
+    quint16 index = _sdo.index;
+    quint8 subIndex = _sdo.subIndex;
+    if (request.payloadSize() >= 4 && _sdo.state == SdoIdle)
+    {
+        index = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(request.payloadData() + 1));
+        subIndex = static_cast<quint8>(request.payloadData()[3]);
+    }
+    sdoAbort(index, subIndex, abortCode, responses);
+}
+
+void CanSimulatedNode::sdoUploadInitiate(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    const char *request = frame.payloadData();
+    quint16 index = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(request + 1));
+    quint8 subIndex = static_cast<quint8>(request[3]);
+
+    quint32 abortCode = checkAccess(index, subIndex, SubIndex::READ);
+    if (abortCode != 0)
+    {
+        sdoAbort(index, subIndex, abortCode, responses);
+        return;
+    }
+
+    const QByteArray data = value(index, subIndex);
+    char response[8] = {0};
+    memcpy(response + 1, request + 1, 3);
+    if (data.size() > 0 && data.size() <= 4)
+    {
+        // expedited
+        response[0] = static_cast<char>(0x43 | ((4 - data.size()) << 2));
+        memcpy(response + 4, data.constData(), static_cast<size_t>(data.size()));
+        _sdo.state = SdoIdle;
+    }
+    else
+    {
+        // segmented, size indicated
+        response[0] = 0x41;
+        qToLittleEndian(static_cast<quint32>(data.size()), reinterpret_cast<uchar *>(response + 4));
+        _sdo.state = SdoUploadSegment;
+        _sdo.index = index;
+        _sdo.subIndex = subIndex;
+        _sdo.data = data;
+        _sdo.offset = 0;
+        _sdo.toggle = 0;
+    }
+    sdoResponse(response, responses);
+}
+
+void CanSimulatedNode::sdoUploadSegment(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    quint8 cmd = static_cast<quint8>(frame.payloadData()[0]);
+    if (_sdo.state != SdoUploadSegment)
+    {
+        sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_CMD_NOT_VALID, responses);
+        return;
+    }
+    if (((cmd >> 4) & 0x01) != _sdo.toggle)
+    {
+        sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_TOGGLE, responses);
+        return;
+    }
+
+    int size = qMin(7, _sdo.data.size() - _sdo.offset);
+    bool last = (_sdo.offset + size >= _sdo.data.size());
+    char response[8] = {0};
+    response[0] = static_cast<char>((_sdo.toggle << 4) | ((7 - size) << 1) | (last ? 0x01 : 0x00));
+    memcpy(response + 1, _sdo.data.constData() + _sdo.offset, static_cast<size_t>(size));
+    sdoResponse(response, responses);
+
+    _sdo.offset += size;
+    _sdo.toggle ^= 0x01;
+    if (last)
+    {
+        _sdo.state = SdoIdle;
+    }
+}
+
+void CanSimulatedNode::sdoDownloadInitiate(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    const char *request = frame.payloadData();
+    quint8 cmd = static_cast<quint8>(request[0]);
+    quint16 index = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(request + 1));
+    quint8 subIndex = static_cast<quint8>(request[3]);
+
+    quint32 abortCode = checkAccess(index, subIndex, SubIndex::WRITE);
+    if (abortCode != 0)
+    {
+        sdoAbort(index, subIndex, abortCode, responses);
+        return;
+    }
+
+    if ((cmd & 0x02) != 0)
+    {
+        // expedited
+        int size = ((cmd & 0x01) != 0) ? 4 - ((cmd >> 2) & 0x03) : 4;
+        abortCode = writeObject(index, subIndex, QByteArray(request + 4, size));
+        if (abortCode != 0)
+        {
+            sdoAbort(index, subIndex, abortCode, responses);
+            return;
+        }
+        _sdo.state = SdoIdle;
+    }
+    else
+    {
+        _sdo.state = SdoDownloadSegment;
+        _sdo.index = index;
+        _sdo.subIndex = subIndex;
+        _sdo.data.clear();
+        _sdo.toggle = 0;
+    }
+
+    char response[8] = {0};
+    response[0] = 0x60;
+    memcpy(response + 1, request + 1, 3);
+    sdoResponse(response, responses);
+}
+
+void CanSimulatedNode::sdoDownloadSegment(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    const char *request = frame.payloadData();
+    quint8 cmd = static_cast<quint8>(request[0]);
+    if (_sdo.state != SdoDownloadSegment)
+    {
+        sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_CMD_NOT_VALID, responses);
+        return;
+    }
+    if (((cmd >> 4) & 0x01) != _sdo.toggle)
+    {
+        sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_TOGGLE, responses);
+        return;
+    }
+
+    _sdo.data.append(request + 1, 7 - ((cmd >> 1) & 0x07));
+    if ((cmd & 0x01) != 0)
+    {
+        quint32 abortCode = writeObject(_sdo.index, _sdo.subIndex, _sdo.data);
+        if (abortCode != 0)
+        {
+            sdoAbort(_sdo.index, _sdo.subIndex, abortCode, responses);
+            return;
+        }
+        _sdo.state = SdoIdle;
+    }
+
+    char response[8] = {0};
+    response[0] = static_cast<char>(0x20 | (_sdo.toggle << 4));
+    sdoResponse(response, responses);
+    _sdo.toggle ^= 0x01;
+}
+
+void CanSimulatedNode::sdoBlockUpload(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    const char *request = frame.payloadData();
+    quint8 cmd = static_cast<quint8>(request[0]);
+    char response[8] = {0};
+
+    switch (cmd & 0x03)
+    {
+        case 0:  // initiate
+        {
+            quint16 index = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(request + 1));
+            quint8 subIndex = static_cast<quint8>(request[3]);
+            quint32 abortCode = checkAccess(index, subIndex, SubIndex::READ);
+            if (abortCode != 0)
+            {
+                sdoAbort(index, subIndex, abortCode, responses);
+                return;
+            }
+            quint8 blksize = static_cast<quint8>(request[4]);
+            if (blksize == 0 || blksize > SDO_BLOCK_SIZE)
+            {
+                sdoAbort(index, subIndex, SDO_ABORT_INVALID_BLOCK_SIZE, responses);
+                return;
+            }
+
+            _sdo.state = SdoBlockUploadStart;
+            _sdo.index = index;
+            _sdo.subIndex = subIndex;
+            _sdo.data = value(index, subIndex);
+            _sdo.offset = 0;
+            _sdo.blksize = blksize;
+            _sdo.crc = ((cmd & 0x04) != 0);
+
+            response[0] = static_cast<char>(0xC2 | 0x04);  // size indicated, CRC supported
+            memcpy(response + 1, request + 1, 3);
+            qToLittleEndian(static_cast<quint32>(_sdo.data.size()), reinterpret_cast<uchar *>(response + 4));
+            sdoResponse(response, responses);
+            break;
+        }
+
+        case 3:  // start
+            if (_sdo.state != SdoBlockUploadStart)
+            {
+                sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_CMD_NOT_VALID, responses);
+                return;
+            }
+            sdoBlockUploadSubBlock(responses);
+            break;
+
+        case 2:  // sub-block acknowledge
+        {
+            if (_sdo.state != SdoBlockUploadSubBlock)
+            {
+                sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_CMD_NOT_VALID, responses);
+                return;
+            }
+            quint8 ackseq = static_cast<quint8>(request[1]);
+            quint8 blksize = static_cast<quint8>(request[2]);
+            if (ackseq > _sdo.seqno || blksize == 0 || blksize > SDO_BLOCK_SIZE)
+            {
+                sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_INVALID_SEQ_NUMBER, responses);
+                return;
+            }
+            _sdo.offset = qMin(_sdo.data.size(), _sdo.offset + 7 * ackseq);
+            _sdo.blksize = blksize;
+
+            bool lastAcked = (ackseq == _sdo.seqno && _sdo.offset >= _sdo.data.size());
+            if (!lastAcked)
+            {
+                sdoBlockUploadSubBlock(responses);
+                return;
+            }
+
+            int segmentCount = qMax(1, (_sdo.data.size() + 6) / 7);
+            int n = segmentCount * 7 - _sdo.data.size();
+            response[0] = static_cast<char>(0xC1 | (n << 2));
+            quint16 crc = _sdo.crc ? crc16(_sdo.data.constData(), _sdo.data.size()) : 0;
+            qToLittleEndian(crc, reinterpret_cast<uchar *>(response + 1));
+            sdoResponse(response, responses);
+            _sdo.state = SdoBlockUploadEnd;
+            break;
+        }
+
+        case 1:  // end
+            _sdo.state = SdoIdle;
+            break;
+    }
+}
+
+void CanSimulatedNode::sdoBlockUploadSubBlock(QVector<QCanBusFrame> &responses)
+{
+    int offset = _sdo.offset;
+    quint8 seqno = 0;
+    bool last = false;
+    while (seqno < _sdo.blksize && !last)
+    {
+        seqno++;
+        int size = qMin(7, _sdo.data.size() - offset);
+        last = (offset + size >= _sdo.data.size());
+
+        char segment[8] = {0};
+        segment[0] = static_cast<char>(seqno | (last ? 0x80 : 0x00));
+        memcpy(segment + 1, _sdo.data.constData() + offset, static_cast<size_t>(size));
+        sdoResponse(segment, responses);
+        offset += size;
+    }
+    _sdo.seqno = seqno;
+    _sdo.state = SdoBlockUploadSubBlock;
+}
+
+void CanSimulatedNode::sdoBlockDownload(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    const char *request = frame.payloadData();
+    quint8 cmd = static_cast<quint8>(request[0]);
+    char response[8] = {0};
+
+    if ((cmd & 0x01) == 0)
+    {
+        // initiate
+        quint16 index = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(request + 1));
+        quint8 subIndex = static_cast<quint8>(request[3]);
+        quint32 abortCode = checkAccess(index, subIndex, SubIndex::WRITE);
+        if (abortCode != 0)
+        {
+            sdoAbort(index, subIndex, abortCode, responses);
+            return;
+        }
+
+        _sdo.state = SdoBlockDownloadSubBlock;
+        _sdo.index = index;
+        _sdo.subIndex = subIndex;
+        _sdo.data.clear();
+        _sdo.seqno = 0;
+        _sdo.blksize = SDO_BLOCK_SIZE;
+        _sdo.crc = ((cmd & 0x04) != 0);
+
+        response[0] = static_cast<char>(0xA0 | 0x04);  // CRC supported
+        memcpy(response + 1, request + 1, 3);
+        response[4] = static_cast<char>(_sdo.blksize);
+        sdoResponse(response, responses);
+        return;
+    }
+
+    // end
+    if (_sdo.state != SdoBlockDownloadEnd)
+    {
+        sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_CMD_NOT_VALID, responses);
+        return;
+    }
+    int n = (cmd >> 2) & 0x07;
+    _sdo.data.chop(n);
+    if (_sdo.crc)
+    {
+        quint16 crc = qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(request + 1));
+        if (crc != crc16(_sdo.data.constData(), _sdo.data.size()))
+        {
+            sdoAbort(_sdo.index, _sdo.subIndex, SDO_ABORT_CRC_ERROR, responses);
+            return;
+        }
+    }
+    quint32 abortCode = writeObject(_sdo.index, _sdo.subIndex, _sdo.data);
+    if (abortCode != 0)
+    {
+        sdoAbort(_sdo.index, _sdo.subIndex, abortCode, responses);
+        return;
+    }
+    _sdo.state = SdoIdle;
+
+    response[0] = static_cast<char>(0xA1);
+    sdoResponse(response, responses);
+}
+
+void CanSimulatedNode::sdoBlockDownloadSubBlock(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses)
+{
+    const char *segment = frame.payloadData();
+    quint8 seqno = static_cast<quint8>(segment[0]) & 0x7F;
+    bool last = ((static_cast<quint8>(segment[0]) & 0x80) != 0);
+
+    // out of sequence segments are ignored, the acknowledge carries the last good one
+    bool inSequence = (seqno == _sdo.seqno + 1);
+    if (inSequence)
+    {
+        _sdo.data.append(segment + 1, 7);
+        _sdo.seqno = seqno;
+    }
+
+    if ((last && inSequence) || seqno >= _sdo.blksize)
+    {
+        char response[8] = {0};
+        response[0] = static_cast<char>(0xA2);
+        response[1] = static_cast<char>(_sdo.seqno);
+        response[2] = static_cast<char>(_sdo.blksize);
+        sdoResponse(response, responses);
+
+        _sdo.seqno = 0;
+        if (last && inSequence)
+        {
+            _sdo.state = SdoBlockDownloadEnd;
+        }
+    }
+}
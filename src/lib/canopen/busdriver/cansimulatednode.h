@@ -0,0 +1,136 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANSIMULATEDNODE_H
+#define CANSIMULATEDNODE_H
+
+#include "canopen_global.h"
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include "busdriver/qcanbusframe.h"
+
+/**
+ * @brief Simulated CANopen slave with an object dictionary loaded from an EDS
+ *
+ * Answers NMT, SYNC and SDO requests (expedited, segmented and block transfers) and produces
+ * bootup, heartbeat and TPDO frames. Produced frames are appended to the responses vector.
+ */
+class CANOPEN_EXPORT CanSimulatedNode
+{
+public:
+    CanSimulatedNode(quint8 nodeId);
+
+    quint8 nodeId() const;
+
+    bool loadEds(const QString &fileName);
+    const QString &edsFileName() const;
+    void resetValues();
+
+    enum State : quint8
+    {
+        StateBootUp = 0x00,
+        StateStopped = 0x04,
+        StateOperational = 0x05,
+        StatePreOperational = 0x7F
+    };
+    State state() const;
+
+    bool hasObject(quint16 index, quint8 subIndex) const;
+    QByteArray value(quint16 index, quint8 subIndex) const;
+    bool setValue(quint16 index, quint8 subIndex, const QByteArray &value);
+
+    void bootUp(qint64 nowMs, QVector<QCanBusFrame> &responses);
+    void processFrame(const QCanBusFrame &frame, qint64 nowMs, QVector<QCanBusFrame> &responses);
+    void processTime(qint64 nowMs, QVector<QCanBusFrame> &responses);
+    void abortSdo(const QCanBusFrame &request, quint32 abortCode, QVector<QCanBusFrame> &responses);
+
+    static quint16 crc16(const char *data, int size, quint16 crc = 0);
+
+private:
+    quint8 _nodeId;
+    QString _edsFileName;
+    State _state;
+
+    struct Object
+    {
+        QByteArray value;
+        QByteArray defaultValue;
+        quint8 accessType;
+        quint8 length;  // fixed size in bytes, 0 for variable size types
+    };
+    QMap<quint32, Object> _objects;  // key: index << 8 | subIndex
+    static quint32 key(quint16 index, quint8 subIndex);
+
+    // NMT and error control
+    qint64 _lastHeartbeatMs;
+    struct Tpdo
+    {
+        quint16 number;
+        quint8 syncCount;
+        qint64 lastEventMs;
+    };
+    QVector<Tpdo> _tpdos;
+    void processNmt(const QCanBusFrame &frame, qint64 nowMs, QVector<QCanBusFrame> &responses);
+    void processSync(qint64 nowMs, QVector<QCanBusFrame> &responses);
+    quint32 valueU32(quint16 index, quint8 subIndex, quint32 defaultValue = 0) const;
+    bool tpdoFrame(quint16 number, QCanBusFrame &frame) const;
+
+    // SDO server
+    enum SdoState
+    {
+        SdoIdle,
+        SdoUploadSegment,
+        SdoDownloadSegment,
+        SdoBlockUploadStart,
+        SdoBlockUploadSubBlock,
+        SdoBlockUploadEnd,
+        SdoBlockDownloadSubBlock,
+        SdoBlockDownloadEnd
+    };
+    struct SdoTransfer
+    {
+        SdoState state;
+        quint16 index;
+        quint8 subIndex;
+        QByteArray data;
+        int offset;
+        quint8 toggle;
+        quint8 blksize;
+        quint8 seqno;
+        bool crc;
+    };
+    SdoTransfer _sdo;
+    void processSdo(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    void sdoUploadInitiate(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    void sdoUploadSegment(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    void sdoDownloadInitiate(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    void sdoDownloadSegment(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    void sdoBlockUpload(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    void sdoBlockUploadSubBlock(QVector<QCanBusFrame> &responses);
+    void sdoBlockDownload(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    void sdoBlockDownloadSubBlock(const QCanBusFrame &frame, QVector<QCanBusFrame> &responses);
+    quint32 checkAccess(quint16 index, quint8 subIndex, quint8 accessType) const;
+    quint32 writeObject(quint16 index, quint8 subIndex, const QByteArray &data);
+    void sdoResponse(const char *data, QVector<QCanBusFrame> &responses) const;
+    void sdoAbort(quint16 index, quint8 subIndex, quint32 abortCode, QVector<QCanBusFrame> &responses);
+};
+
+#endif  // CANSIMULATEDNODE_H
@@ -6,6 +6,8 @@
 
 #include <QString>
 
+#include <cstring>
+
 bool QCanBusFrame::isValid() const
 {
     if (_format == InvalidFrame)
@@ -25,7 +27,7 @@ bool QCanBusFrame::isValid() const
     }
 
     // maximum permitted payload size in CAN or CAN FD
-    const int length = _load.length();
+    const int length = _length;
     if (_isFlexibleDataRate)
     {
         if (_format == RemoteRequestFrame)
@@ -104,7 +106,8 @@ QCanBusFrame::QCanBusFrame(FrameType type)
       _isBitrateSwitch(0x0),
       _isErrorStateIndicator(0x0),
       _isLocalEcho(0x0),
-      _reserved0(0x0)
+      _reserved0(0x0),
+      _length(0)
 {
     setFrameId(0x0);
     setFrameType(type);
@@ -118,9 +121,10 @@ QCanBusFrame::QCanBusFrame(quint32 identifier, const QByteArray &data)
       _isErrorStateIndicator(0x0),
       _isLocalEcho(0x0),
       _reserved0(0x0),
-      _load(data)
+      _length(0)
 {
     setFrameId(identifier);
+    setPayload(data);
 }
 
 void QCanBusFrame::setFrameId(quint32 newFrameId)
@@ -140,13 +144,38 @@ void QCanBusFrame::setFrameId(quint32 newFrameId)
 
 void QCanBusFrame::setPayload(const QByteArray &data)
 {
-    _load = data;
-    if (data.length() > 8)
+    setPayload(data.constData(), data.size());
+}
+
+/**
+ * @brief Copies size bytes of data as payload, truncated to 64 bytes
+ */
+void QCanBusFrame::setPayload(const char *data, int size)
+{
+    _length = static_cast<quint8>(qBound(0, size, static_cast<int>(sizeof(_load))));
+    if (_length > 0)
+    {
+        memcpy(_load, data, _length);
+    }
+    if (_length > 8)
     {
         _isFlexibleDataRate = 0x1;
     }
 }
 
+/**
+ * @brief Direct access to the payload bytes, valid as long as the frame is, payloadSize() bytes long
+ */
+const char *QCanBusFrame::payloadData() const
+{
+    return _load;
+}
+
+int QCanBusFrame::payloadSize() const
+{
+    return _length;
+}
+
 void QCanBusFrame::setTimeStamp(TimeStamp ts)
 {
     _stamp = ts;
@@ -154,7 +183,7 @@ void QCanBusFrame::setTimeStamp(TimeStamp ts)
 
 QByteArray QCanBusFrame::payload() const
 {
-    return _load;
+    return QByteArray(_load, _length);
 }
 
 void QCanBusFrame::setError(FrameErrors e)
@@ -201,13 +230,13 @@ QString QCanBusFrame::toString() const
     const char *const dlcFormat = hasFlexibleDataRateFormat() ? "  [%02d]" : "   [%d]";
     QString result;
     result.append(QString::asprintf(idFormat, static_cast<uint>(frameId())));
-    result.append(QString::asprintf(dlcFormat, payload().size()));
+    result.append(QString::asprintf(dlcFormat, payloadSize()));
 
     if (type == RemoteRequestFrame)
     {
         result.append(QStringLiteral("  Remote Request"));
     }
-    else if (!payload().isEmpty())
+    else if (payloadSize() > 0)
     {
         const QByteArray data = payload().toHex(' ').toUpper();
         result.append(QStringLiteral("  "));
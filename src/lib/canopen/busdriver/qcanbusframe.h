@@ -7,6 +7,7 @@
 
 #include "canopen_global.h"
 
+#include <QtCore/qbytearray.h>
 #include <QtCore/qmetatype.h>
 
 class QDataStream;
@@ -17,7 +18,7 @@ public:
     class TimeStamp
     {
     public:
-        Q_DECL_CONSTEXPR TimeStamp(qint64 s = 0, qint64 usec = 0) Q_DECL_NOTHROW : secs(s), usecs(usec)
+        Q_DECL_CONSTEXPR TimeStamp(qint64 s = 0, qint64 usec = 0) Q_DECL_NOTHROW : secs(s), nsecs(usec * 1000)
         {
         }
 
@@ -26,6 +27,18 @@ public:
             return TimeStamp(usec / 1000000, usec % 1000000);
         }
 
+        static TimeStamp fromNanoSeconds(qint64 s, qint64 nsec) Q_DECL_NOTHROW
+        {
+            TimeStamp ts(s + nsec / 1000000000);
+            ts.nsecs = nsec % 1000000000;
+            return ts;
+        }
+
+        static TimeStamp fromNanoSeconds(qint64 nsec) Q_DECL_NOTHROW
+        {
+            return fromNanoSeconds(0, nsec);
+        }
+
         Q_DECL_CONSTEXPR qint64 seconds() const Q_DECL_NOTHROW
         {
             return secs;
@@ -33,12 +46,22 @@ public:
 
         Q_DECL_CONSTEXPR qint64 microSeconds() const Q_DECL_NOTHROW
         {
-            return usecs;
+            return nsecs / 1000;
+        }
+
+        Q_DECL_CONSTEXPR qint64 nanoSeconds() const Q_DECL_NOTHROW
+        {
+            return nsecs;
+        }
+
+        Q_DECL_CONSTEXPR qint64 toNanoSeconds() const Q_DECL_NOTHROW
+        {
+            return secs * 1000000000 + nsecs;
         }
 
     private:
         qint64 secs;
-        qint64 usecs;
+        qint64 nsecs;  // sub-second part, in nanoseconds
     };
 
     enum FrameType
@@ -86,6 +109,9 @@ public:
 
     QByteArray payload() const;
     void setPayload(const QByteArray &data);
+    void setPayload(const char *data, int size);
+    const char *payloadData() const;
+    int payloadSize() const;
 
     TimeStamp timeStamp() const;
     void setTimeStamp(TimeStamp ts);
@@ -120,8 +146,14 @@ private:
     quint8 _isLocalEcho : 1;
     quint16 _reserved0 : 10;
 
-    QByteArray _load;
+    // inline payload, no allocation and trivially copyable
+    quint8 _length;
+    char _load[64];
     TimeStamp _stamp;
 };
 
+// inline POD payload, copied with memcpy, frames added by a container resize are zero filled
+Q_DECLARE_TYPEINFO(QCanBusFrame, Q_PRIMITIVE_TYPE);
+Q_DECLARE_METATYPE(QCanBusFrame)
+
 #endif  // QCANBUSFRAME_H
@@ -0,0 +1,537 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "canframelog.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+enum
+{
+    RECORD_HEADER_SIZE = 14,  // stamp (8), id (4), flags (1), length (1)
+    RING_MIN_ALLOCATION = 1024
+};
+
+static quint8 frameFlags(const QCanBusFrame &frame)
+{
+    quint8 flags = static_cast<quint8>(frame.frameType()) & 0x07U;
+    if (frame.hasExtendedFrameFormat())
+    {
+        flags |= 0x08U;
+    }
+    if (frame.hasLocalEcho())
+    {
+        flags |= 0x10U;
+    }
+    if (frame.hasFlexibleDataRateFormat())
+    {
+        flags |= 0x20U;
+    }
+    if (frame.hasBitrateSwitch())
+    {
+        flags |= 0x40U;
+    }
+    if (frame.hasErrorStateIndicator())
+    {
+        flags |= 0x80U;
+    }
+    return flags;
+}
+
+static quint32 frameIdOrError(const QCanBusFrame &frame)
+{
+    if (frame.frameType() == QCanBusFrame::ErrorFrame)
+    {
+        return static_cast<quint32>(frame.error());
+    }
+    return frame.frameId();
+}
+
+static void setupFrame(QCanBusFrame &frame, qint64 stamp, quint32 id, quint8 flags, const char *data, int length)
+{
+    QCanBusFrame::FrameType type = static_cast<QCanBusFrame::FrameType>(flags & 0x07U);
+    frame.setFrameType(type);
+    if (type == QCanBusFrame::ErrorFrame)
+    {
+        frame.setError(QCanBusFrame::FrameErrors(id));
+    }
+    else
+    {
+        frame.setFrameId(id);
+        frame.setExtendedFrameFormat((flags & 0x08U) != 0);
+    }
+    frame.setPayload(data, length);
+    frame.setLocalEcho((flags & 0x10U) != 0);
+    frame.setFlexibleDataRateFormat((flags & 0x20U) != 0);
+    frame.setBitrateSwitch((flags & 0x40U) != 0);
+    frame.setErrorStateIndicator((flags & 0x80U) != 0);
+    frame.setTimeStamp(QCanBusFrame::TimeStamp::fromNanoSeconds(stamp));
+}
+
+CanFrameLog::CanFrameLog(int capacity)
+{
+    _capacity = qMax(1, capacity);
+    _head = 0;
+    _count = 0;
+    _firstIndex = 0;
+    _retentionMs = 0;
+
+    _spillFirstIndex = 0;
+    _spillFileSize = 0;
+    _spillMaxSize = DEFAULT_SPILL_MAX_SIZE;
+    _spillBufferFirstIndex = 0;
+    _spillBufferCount = 0;
+    _cachedChunk = -1;
+    _spillBufferFramesValid = false;
+}
+
+CanFrameLog::~CanFrameLog()
+{
+    _spillFile.close();
+}
+
+void CanFrameLog::append(const QCanBusFrame &frame)
+{
+    QMutexLocker locker(&_mutex);
+    if (_count == _entries.count())
+    {
+        if (_entries.count() < _capacity)
+        {
+            grow();
+        }
+        else
+        {
+            evictFirst();
+        }
+    }
+
+    qint64 index = _firstIndex + _count;
+    Entry &entry = _entries[(_head + _count) % _entries.count()];
+    entry = toEntry(frame);
+    if (frame.payloadSize() > 8)
+    {
+        _fdPayloads.insert(index, frame.payload());
+    }
+    _count++;
+
+    // age retention, relative to the newest frame
+    if (_retentionMs > 0)
+    {
+        qint64 limit = entry.stamp - static_cast<qint64>(_retentionMs) * 1000000;
+        while (_count > 1 && _entries.at(_head).stamp < limit)
+        {
+            evictFirst();
+        }
+    }
+}
+
+/**
+ * @brief Removes all the frames, indexes continue from endIndex()
+ */
+void CanFrameLog::clear()
+{
+    QMutexLocker locker(&_mutex);
+    _firstIndex += _count;
+    _head = 0;
+    _count = 0;
+    _fdPayloads.clear();
+
+    if (_spillFile.isOpen())
+    {
+        _spillFile.resize(0);
+    }
+    _spillChunks.clear();
+    _spillFileSize = 0;
+    _spillFirstIndex = _firstIndex;
+    _spillBuffer.clear();
+    _spillBufferFirstIndex = _firstIndex;
+    _spillBufferCount = 0;
+    _cachedChunk = -1;
+    _spillBufferFramesValid = false;
+}
+
+/**
+ * @brief Absolute index of the oldest frame still readable
+ */
+qint64 CanFrameLog::firstIndex() const
+{
+    QMutexLocker locker(&_mutex);
+    if (_spillFile.isOpen())
+    {
+        return _spillFirstIndex;
+    }
+    return _firstIndex;
+}
+
+/**
+ * @brief Absolute index following the newest frame, total number of frames appended
+ */
+qint64 CanFrameLog::endIndex() const
+{
+    QMutexLocker locker(&_mutex);
+    return _firstIndex + _count;
+}
+
+qint64 CanFrameLog::count() const
+{
+    QMutexLocker locker(&_mutex);
+    return _firstIndex + _count - (_spillFile.isOpen() ? _spillFirstIndex : _firstIndex);
+}
+
+/**
+ * @brief Frame at absolute index, from memory or from the spill file
+ * @return an invalid frame if index is out of the log
+ */
+QCanBusFrame CanFrameLog::frame(qint64 index) const
+{
+    QMutexLocker locker(&_mutex);
+    if (index >= _firstIndex && index < _firstIndex + _count)
+    {
+        return fromEntry(index);
+    }
+    if (_spillFile.isOpen() && index >= _spillFirstIndex && index < _firstIndex)
+    {
+        return spilledFrame(index);
+    }
+    return QCanBusFrame(QCanBusFrame::InvalidFrame);
+}
+
+int CanFrameLog::capacity() const
+{
+    QMutexLocker locker(&_mutex);
+    return _capacity;
+}
+
+/**
+ * @brief Sets the maximum number of frames kept in memory, oldest frames are evicted
+ *
+ * The ring is allocated on demand, the capacity is only a bound.
+ */
+void CanFrameLog::setCapacity(int capacity)
+{
+    QMutexLocker locker(&_mutex);
+    _capacity = qMax(1, capacity);
+    while (_count > _capacity)
+    {
+        evictFirst();
+    }
+    if (_entries.count() > _capacity)
+    {
+        reallocate(qMax(_count, qMin(_capacity, RING_MIN_ALLOCATION)));
+    }
+}
+
+int CanFrameLog::retentionMs() const
+{
+    QMutexLocker locker(&_mutex);
+    return _retentionMs;
+}
+
+/**
+ * @brief Sets the maximum age of frames kept in memory, 0 to only use capacity
+ */
+void CanFrameLog::setRetentionMs(int retentionMs)
+{
+    QMutexLocker locker(&_mutex);
+    _retentionMs = retentionMs;
+}
+
+QString CanFrameLog::spillFileName() const
+{
+    QMutexLocker locker(&_mutex);
+    return _spillFileName;
+}
+
+/**
+ * @brief Enables the spill of evicted frames to fileName, truncated, or disables it if empty
+ */
+bool CanFrameLog::setSpillFileName(const QString &fileName)
+{
+    QMutexLocker locker(&_mutex);
+    if (_spillFile.isOpen())
+    {
+        writeSpillChunk();
+        _spillFile.close();
+    }
+    _spillFileName = fileName;
+    _spillChunks.clear();
+    _spillFileSize = 0;
+    _spillFirstIndex = _firstIndex;
+    _spillBuffer.clear();
+    _spillBufferFirstIndex = _firstIndex;
+    _spillBufferCount = 0;
+    _cachedChunk = -1;
+    _spillBufferFramesValid = false;
+
+    if (fileName.isEmpty())
+    {
+        return true;
+    }
+
+    _spillFile.setFileName(fileName);
+    return _spillFile.open(QIODevice::ReadWrite | QIODevice::Truncate);
+}
+
+qint64 CanFrameLog::spillMaxSize() const
+{
+    QMutexLocker locker(&_mutex);
+    return _spillMaxSize;
+}
+
+/**
+ * @brief Sets the maximum size in bytes of the spill file, 0 for no limit
+ *
+ * When the limit is reached, writing restarts at the beginning of the file and the oldest
+ * spilled frames are overwritten.
+ */
+void CanFrameLog::setSpillMaxSize(qint64 size)
+{
+    QMutexLocker locker(&_mutex);
+    _spillMaxSize = qMax(Q_INT64_C(0), size);
+}
+
+qint64 CanFrameLog::spilledCount() const
+{
+    QMutexLocker locker(&_mutex);
+    if (!_spillFile.isOpen())
+    {
+        return 0;
+    }
+    return _firstIndex - _spillFirstIndex;
+}
+
+/**
+ * @brief Appends the binary record of frame to buffer
+ *
+ * Little endian record: time stamp in ns (8 bytes), identifier or error flags (4), flags (1),
+ * payload length (1), payload.
+ */
+void CanFrameLog::encodeFrame(QByteArray &buffer, const QCanBusFrame &frame)
+{
+    uchar record[RECORD_HEADER_SIZE + 64];
+    qToLittleEndian<qint64>(frame.timeStamp().toNanoSeconds(), record);
+    qToLittleEndian<quint32>(frameIdOrError(frame), record + 8);
+    record[12] = frameFlags(frame);
+    record[13] = static_cast<uchar>(frame.payloadSize());
+    memcpy(record + RECORD_HEADER_SIZE, frame.payloadData(), static_cast<size_t>(frame.payloadSize()));
+    buffer.append(reinterpret_cast<const char *>(record), RECORD_HEADER_SIZE + frame.payloadSize());
+}
+
+/**
+ * @brief Decodes a binary record written by encodeFrame()
+ * @return record size, -1 if size is too short for a complete record
+ */
+int CanFrameLog::decodeFrame(const char *data, int size, QCanBusFrame &frame)
+{
+    if (size < RECORD_HEADER_SIZE)
+    {
+        return -1;
+    }
+    const uchar *record = reinterpret_cast<const uchar *>(data);
+    int length = record[13];
+    if (length > 64 || size < RECORD_HEADER_SIZE + length)
+    {
+        return -1;
+    }
+    setupFrame(frame, qFromLittleEndian<qint64>(record), qFromLittleEndian<quint32>(record + 8), record[12], data + RECORD_HEADER_SIZE, length);
+    return RECORD_HEADER_SIZE + length;
+}
+
+CanFrameLog::Entry CanFrameLog::toEntry(const QCanBusFrame &frame)
+{
+    Entry entry;
+    entry.stamp = frame.timeStamp().toNanoSeconds();
+    entry.id = frameIdOrError(frame);
+    entry.flags = frameFlags(frame);
+    entry.length = static_cast<quint8>(frame.payloadSize());
+    memcpy(entry.data, frame.payloadData(), static_cast<size_t>(qMin(frame.payloadSize(), 8)));
+    return entry;
+}
+
+QCanBusFrame CanFrameLog::fromEntry(qint64 index) const
+{
+    const Entry &entry = _entries.at(static_cast<int>((_head + (index - _firstIndex)) % _entries.count()));
+    QCanBusFrame frame;
+    if (entry.length > 8)
+    {
+        const QByteArray payload = _fdPayloads.value(index);
+        setupFrame(frame, entry.stamp, entry.id, entry.flags, payload.constData(), payload.size());
+    }
+    else
+    {
+        setupFrame(frame, entry.stamp, entry.id, entry.flags, reinterpret_cast<const char *>(entry.data), entry.length);
+    }
+    return frame;
+}
+
+void CanFrameLog::grow()
+{
+    reallocate(qMin(_capacity, qMax(RING_MIN_ALLOCATION, _entries.count() * 2)));
+}
+
+void CanFrameLog::reallocate(int size)
+{
+    QVector<Entry> entries(size);
+    for (int i = 0; i < _count; i++)
+    {
+        entries[i] = _entries.at((_head + i) % _entries.count());
+    }
+    _entries.swap(entries);
+    _head = 0;
+}
+
+void CanFrameLog::evictFirst()
+{
+    if (_count == 0)
+    {
+        return;
+    }
+
+    if (_spillFile.isOpen())
+    {
+        encodeFrame(_spillBuffer, fromEntry(_firstIndex));
+        _spillBufferCount++;
+        _spillBufferFramesValid = false;
+        if (_spillBufferCount >= SPILL_CHUNK_FRAMES)
+        {
+            writeSpillChunk();
+        }
+    }
+
+    if (_entries.at(_head).length > 8)
+    {
+        _fdPayloads.remove(_firstIndex);
+    }
+    _head = (_head + 1) % _entries.count();
+    _count--;
+    _firstIndex++;
+}
+
+void CanFrameLog::writeSpillChunk()
+{
+    if (_spillBufferCount == 0)
+    {
+        return;
+    }
+
+    // rotation, the file is used as a ring of chunks
+    if (_spillMaxSize > 0 && _spillFileSize > 0 && _spillFileSize + _spillBuffer.size() > _spillMaxSize)
+    {
+        // chunks left at the end of the file by the previous turn are the oldest ones
+        while (!_spillChunks.isEmpty() && _spillChunks.first().offset >= _spillFileSize)
+        {
+            _spillChunks.removeFirst();
+        }
+        _spillFileSize = 0;
+    }
+    qint64 end = _spillFileSize + _spillBuffer.size();
+    while (!_spillChunks.isEmpty() && _spillChunks.first().offset >= _spillFileSize && _spillChunks.first().offset < end)
+    {
+        _spillChunks.removeFirst();
+    }
+    _cachedChunk = -1;
+    _cachedChunkFrames.clear();
+    _spillFirstIndex = _spillChunks.isEmpty() ? _spillBufferFirstIndex : _spillChunks.first().firstIndex;
+
+    _spillFile.seek(_spillFileSize);
+    qint64 written = _spillFile.write(_spillBuffer);
+    if (written == _spillBuffer.size())
+    {
+        _spillChunks.append(Chunk{_spillBufferFirstIndex, _spillFileSize, _spillBuffer.size(), _spillBufferCount});
+        _spillFileSize += written;
+    }
+    else
+    {
+        // disk full or write error, the spilled frames are lost
+        _spillFirstIndex = _spillBufferFirstIndex + _spillBufferCount;
+        _spillChunks.clear();
+        _cachedChunk = -1;
+    }
+
+    _spillBufferFirstIndex += _spillBufferCount;
+    _spillBuffer.clear();
+    _spillBufferCount = 0;
+    _spillBufferFramesValid = false;
+}
+
+QCanBusFrame CanFrameLog::spilledFrame(qint64 index) const
+{
+    // frames evicted but not yet written
+    if (index >= _spillBufferFirstIndex)
+    {
+        if (!_spillBufferFramesValid)
+        {
+            _spillBufferFrames.clear();
+            int offset = 0;
+            QCanBusFrame frame;
+            int size;
+            while ((size = decodeFrame(_spillBuffer.constData() + offset, _spillBuffer.size() - offset, frame)) > 0)
+            {
+                _spillBufferFrames.append(frame);
+                offset += size;
+            }
+            _spillBufferFramesValid = true;
+        }
+        int bufferIndex = static_cast<int>(index - _spillBufferFirstIndex);
+        if (bufferIndex < _spillBufferFrames.count())
+        {
+            return _spillBufferFrames.at(bufferIndex);
+        }
+        return QCanBusFrame(QCanBusFrame::InvalidFrame);
+    }
+
+    // chunk containing index
+    QVector<Chunk>::const_iterator chunkIt = std::upper_bound(_spillChunks.cbegin(), _spillChunks.cend(), index, [](qint64 value, const Chunk &chunk) {
+        return value < chunk.firstIndex;
+    });
+    if (chunkIt == _spillChunks.cbegin())
+    {
+        return QCanBusFrame(QCanBusFrame::InvalidFrame);
+    }
+    --chunkIt;
+    int chunkId = static_cast<int>(chunkIt - _spillChunks.cbegin());
+
+    if (chunkId != _cachedChunk)
+    {
+        _cachedChunk = -1;
+        _cachedChunkFrames.clear();
+        if (!_spillFile.seek(chunkIt->offset))
+        {
+            return QCanBusFrame(QCanBusFrame::InvalidFrame);
+        }
+        QByteArray chunkData = _spillFile.read(chunkIt->size);
+        int offset = 0;
+        QCanBusFrame frame;
+        int size;
+        while ((size = decodeFrame(chunkData.constData() + offset, chunkData.size() - offset, frame)) > 0)
+        {
+            _cachedChunkFrames.append(frame);
+            offset += size;
+        }
+        _cachedChunk = chunkId;
+    }
+
+    int chunkIndex = static_cast<int>(index - chunkIt->firstIndex);
+    if (chunkIndex < _cachedChunkFrames.count())
+    {
+        return _cachedChunkFrames.at(chunkIndex);
+    }
+    return QCanBusFrame(QCanBusFrame::InvalidFrame);
+}
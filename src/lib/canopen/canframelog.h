@@ -0,0 +1,131 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANFRAMELOG_H
+#define CANFRAMELOG_H
+
+#include "canopen_global.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include "busdriver/qcanbusframe.h"
+
+/**
+ * @brief Bounded log of CAN frames with absolute indexes
+ *
+ * Frames are kept in a ring of compact entries, grown on demand up to the capacity. The retention
+ * is given in number of frames (capacity) and optionally in age. Frames leaving the ring can be
+ * spilled to a chunked binary file, bounded by spillMaxSize(), and are still readable with
+ * frame(). All methods are thread safe, the log is filled by the bus thread and read by views.
+ */
+class CANOPEN_EXPORT CanFrameLog
+{
+public:
+    enum
+    {
+        DEFAULT_SPILL_MAX_SIZE = 256 * 1024 * 1024  // bytes
+    };
+
+    CanFrameLog(int capacity = 1000000);
+    ~CanFrameLog();
+
+    void append(const QCanBusFrame &frame);
+    void clear();
+
+    qint64 firstIndex() const;
+    qint64 endIndex() const;
+    qint64 count() const;
+    QCanBusFrame frame(qint64 index) const;
+
+    // retention
+    int capacity() const;
+    void setCapacity(int capacity);
+    int retentionMs() const;
+    void setRetentionMs(int retentionMs);
+
+    // disk spill
+    QString spillFileName() const;
+    bool setSpillFileName(const QString &fileName);
+    qint64 spillMaxSize() const;
+    void setSpillMaxSize(qint64 size);
+    qint64 spilledCount() const;
+
+    // binary record format, shared with capture files
+    static void encodeFrame(QByteArray &buffer, const QCanBusFrame &frame);
+    static int decodeFrame(const char *data, int size, QCanBusFrame &frame);
+
+private:
+    mutable QMutex _mutex;
+
+    // ring tier
+    struct Entry
+    {
+        qint64 stamp;  // ns
+        quint32 id;
+        quint8 flags;
+        quint8 length;
+        quint8 data[8];
+    };
+    QVector<Entry> _entries;
+    int _capacity;
+    int _head;
+    int _count;
+    qint64 _firstIndex;
+    QHash<qint64, QByteArray> _fdPayloads;  // payloads longer than 8 bytes
+    int _retentionMs;
+
+    static Entry toEntry(const QCanBusFrame &frame);
+    QCanBusFrame fromEntry(qint64 index) const;
+    void grow();
+    void reallocate(int size);
+    void evictFirst();
+
+    // spill tier
+    enum
+    {
+        SPILL_CHUNK_FRAMES = 4096
+    };
+    struct Chunk
+    {
+        qint64 firstIndex;
+        qint64 offset;
+        int size;
+        int count;
+    };
+    QString _spillFileName;
+    mutable QFile _spillFile;
+    QVector<Chunk> _spillChunks;
+    qint64 _spillFirstIndex;
+    qint64 _spillFileSize;  // write offset
+    qint64 _spillMaxSize;
+    QByteArray _spillBuffer;
+    qint64 _spillBufferFirstIndex;
+    int _spillBufferCount;
+    void writeSpillChunk();
+
+    mutable int _cachedChunk;
+    mutable QVector<QCanBusFrame> _cachedChunkFrames;
+    mutable QVector<QCanBusFrame> _spillBufferFrames;
+    mutable bool _spillBufferFramesValid;
+    QCanBusFrame spilledFrame(qint64 index) const;
+};
+
+#endif  // CANFRAMELOG_H
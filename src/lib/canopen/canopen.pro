@@ -14,12 +14,19 @@ CONFIG(release, debug|release) {
 SOURCES += \
     $$PWD/canopen.cpp \
     $$PWD/canopenbus.cpp \
+    $$PWD/canframelog.cpp \
+    $$PWD/canopentxqueue.cpp \
     $$PWD/node.cpp \
     $$PWD/nodeod.cpp \
     $$PWD/nodeindex.cpp \
     $$PWD/nodesubindex.cpp \
     $$PWD/nodeobjectid.cpp \
+    $$PWD/nodeobjectresult.cpp \
+    $$PWD/nodeodjournal.cpp \
+    $$PWD/nodeodnotifier.cpp \
     $$PWD/nodeodsubscriber.cpp \
+    $$PWD/nodeodtemplate.cpp \
+    $$PWD/nodeodvalues.cpp \
     $$PWD/services/service.cpp \
     $$PWD/services/emergency.cpp \
     $$PWD/services/nmt.cpp \
@@ -27,6 +34,9 @@ SOURCES += \
     $$PWD/services/tpdo.cpp \
     $$PWD/services/rpdo.cpp \
     $$PWD/services/sdo.cpp \
+    $$PWD/services/sdoscheduler.cpp \
+    $$PWD/services/sdobatch.cpp \
+    $$PWD/services/sdostatistics.cpp \
     $$PWD/services/sync.cpp \
     $$PWD/services/timestamp.cpp \
     $$PWD/services/errorcontrol.cpp \
@@ -50,7 +60,13 @@ SOURCES += \
     $$PWD/indexdb402.cpp \
     $$PWD/busdriver/qcanbusframe.cpp \
     $$PWD/busdriver/canbusdriver.cpp \
+    $$PWD/busdriver/canframering.cpp \
     $$PWD/busdriver/canbustcpudt.cpp \
+    $$PWD/busdriver/canbusreplay.cpp \
+    $$PWD/busdriver/canbusdevicefarm.cpp \
+    $$PWD/busdriver/cansimulatednode.cpp \
+    $$PWD/busdriver/cancapturereader.cpp \
+    $$PWD/busdriver/cancapturewriter.cpp \
     $$PWD/bootloader/bootloader.cpp \
     $$PWD/bootloader/model/ufwmodel.cpp \
     $$PWD/bootloader/parser/hexparser.cpp \
@@ -70,12 +86,19 @@ HEADERS += \
     $$PWD/canopen.h \
     $$PWD/canopen_global.h \
     $$PWD/canopenbus.h \
+    $$PWD/canframelog.h \
+    $$PWD/canopentxqueue.h \
     $$PWD/node.h \
     $$PWD/nodeod.h \
     $$PWD/nodeindex.h \
     $$PWD/nodesubindex.h \
     $$PWD/nodeobjectid.h \
+    $$PWD/nodeobjectresult.h \
+    $$PWD/nodeodjournal.h \
+    $$PWD/nodeodnotifier.h \
     $$PWD/nodeodsubscriber.h \
+    $$PWD/nodeodtemplate.h \
+    $$PWD/nodeodvalues.h \
     $$PWD/services/service.h \
     $$PWD/services/services.h \
     $$PWD/services/emergency.h \
@@ -84,6 +107,9 @@ HEADERS += \
     $$PWD/services/tpdo.h \
     $$PWD/services/rpdo.h \
     $$PWD/services/sdo.h \
+    $$PWD/services/sdoscheduler.h \
+    $$PWD/services/sdobatch.h \
+    $$PWD/services/sdostatistics.h \
     $$PWD/services/sync.h \
     $$PWD/services/timestamp.h \
     $$PWD/services/errorcontrol.h \
@@ -107,7 +133,13 @@ HEADERS += \
     $$PWD/indexdb402.h \
     $$PWD/busdriver/qcanbusframe.h \
     $$PWD/busdriver/canbusdriver.h \
+    $$PWD/busdriver/canframering.h \
     $$PWD/busdriver/canbustcpudt.h \
+    $$PWD/busdriver/canbusreplay.h \
+    $$PWD/busdriver/canbusdevicefarm.h \
+    $$PWD/busdriver/cansimulatednode.h \
+    $$PWD/busdriver/cancapturereader.h \
+    $$PWD/busdriver/cancapturewriter.h \
     $$PWD/bootloader/bootloader.h \
     $$PWD/bootloader/model/ufwmodel.h \
     $$PWD/bootloader/parser/hexparser.h \
@@ -19,17 +19,44 @@
 #include "canopenbus.h"
 
 #include "canopen.h"
+#include "services/sdoscheduler.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QThread>
 
 CanOpenBus::CanOpenBus(CanBusDriver *canBusDriver)
 {
     _busId = 255;
     _canOpen = nullptr;
     _canBusDriver = nullptr;
-    setCanBusDriver(canBusDriver);
-    _spyMode = false;
+    _spyMode.storeRelease(0);
+    _ioThread = nullptr;
+
+    // types of commands queued to the I/O thread
+    qRegisterMetaType<QCanBusFrame>();
+    qRegisterMetaType<Node *>();
+    qRegisterMetaType<SDO *>();
+    qRegisterMetaType<CanBusDriver *>();
+    qRegisterMetaType<QThread *>();
+    qRegisterMetaType<QMetaType::Type>("QMetaType::Type");
+    qRegisterMetaType<SDO::Priority>("SDO::Priority");
+    qRegisterMetaType<QSharedPointer<SdoBatch>>("QSharedPointer<SdoBatch>");
+    qRegisterMetaType<NodeObjectResult>();
+    qRegisterMetaType<SdoStatistics>();
 
     // services
     _serviceDispatcher = new ServiceDispatcher(this);
+    _sdoScheduler = new SdoScheduler(this);
+
+    // driver reception filters, recomputed once per event loop iteration on dispatcher changes
+    _kernelFilterEnabled = false;
+    _kernelFilterTimer = new QTimer(this);
+    _kernelFilterTimer->setSingleShot(true);
+    _kernelFilterTimer->setInterval(0);
+    connect(_kernelFilterTimer, &QTimer::timeout, this, &CanOpenBus::updateKernelFilter);
+    connect(_serviceDispatcher, &ServiceDispatcher::registeredCobIdsChanged, this, &CanOpenBus::scheduleKernelFilterUpdate);
 
     _sync = new Sync(this);
     _serviceDispatcher->addService(_sync);
@@ -43,18 +70,40 @@ CanOpenBus::CanOpenBus(CanBusDriver *canBusDriver)
 
     // can frame logger
     _canFrameLogId = 0;
+    _rxFrames.reserve(RX_BATCH_SIZE);
+
+    // transmission queue
+    _txFrames.reserve(TX_BATCH_SIZE);
+    _txFlushTimer = new QTimer(this);
+    _txFlushTimer->setSingleShot(true);
+    connect(_txFlushTimer, &QTimer::timeout, this, &CanOpenBus::flushTxQueue);
+
     _canFramesLogTimer = new QTimer(this);
     connect(_canFramesLogTimer, &QTimer::timeout, this, &CanOpenBus::notifyForNewFrames);
     _canFramesLogTimer->start(100);
+
+    setCanBusDriver(canBusDriver);
 }
 
 CanOpenBus::~CanOpenBus()
 {
+    setIoThreadEnabled(false);
+
     delete _sync;
     delete _timestamp;
     delete _nodeDiscover;
     delete _serviceDispatcher;
+
+    // no SDO client is resumed while the nodes are deleted
+    for (Node *node : qAsConst(_nodes))
+    {
+        for (SDO *sdo : node->sdoClients())
+        {
+            _sdoScheduler->removeSdo(sdo);
+        }
+    }
     qDeleteAll(_nodes);
+    delete _sdoScheduler;
 
     if (_canBusDriver != nullptr)
     {
@@ -87,24 +136,31 @@ quint8 CanOpenBus::busId() const
     return _busId;
 }
 
-const QList<Node *> &CanOpenBus::nodes() const
+/**
+ * @brief Snapshot of the nodes of the bus, safe to call from any thread
+ */
+QList<Node *> CanOpenBus::nodes() const
 {
+    QMutexLocker locker(&_nodesMutex);
     return _nodes;
 }
 
 Node *CanOpenBus::node(quint8 nodeId)
 {
+    QMutexLocker locker(&_nodesMutex);
     return _nodesMap.value(nodeId);
 }
 
 bool CanOpenBus::existNode(quint8 nodeId)
 {
+    QMutexLocker locker(&_nodesMutex);
     return _nodesMap.contains(nodeId);
 }
 
 QList<Node *> CanOpenBus::nodesFiltered(quint32 vendorId, quint32 productCode) const
 {
     QList<Node *> nodes;
+    QMutexLocker locker(&_nodesMutex);
     for (Node *node : _nodes)
     {
         if (node->vendorId() == vendorId)
@@ -120,9 +176,18 @@ QList<Node *> CanOpenBus::nodesFiltered(quint32 vendorId, quint32 productCode) c
 
 void CanOpenBus::addNode(Node *node)
 {
+    if (QThread::currentThread() != thread())
+    {
+        node->moveNodeToThread(thread());
+        QMetaObject::invokeMethod(this, "addNode", Qt::BlockingQueuedConnection, Q_ARG(Node *, node));
+        return;
+    }
+
     emit nodeAboutToBeAdded(node->nodeId());
+    _nodesMutex.lock();
     _nodes.append(node);
     _nodesMap.insert(node->nodeId(), node);
+    _nodesMutex.unlock();
 
     node->setBus(this);
     QListIterator<Service *> service(node->services());
@@ -135,6 +200,12 @@ void CanOpenBus::addNode(Node *node)
 
 void CanOpenBus::removeNode(Node *node)
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "removeNode", Qt::BlockingQueuedConnection, Q_ARG(Node *, node));
+        return;
+    }
+
     if (_nodes.contains(node))
     {
         emit nodeAboutToBeRemoved(node->nodeId());
@@ -143,9 +214,15 @@ void CanOpenBus::removeNode(Node *node)
         {
             _serviceDispatcher->removeService(service.next());
         }
+        for (SDO *sdo : node->sdoClients())
+        {
+            _sdoScheduler->removeSdo(sdo);
+        }
 
+        _nodesMutex.lock();
         _nodes.removeOne(node);
         _nodesMap.remove(node->nodeId());
+        _nodesMutex.unlock();
         node->deleteLater();
         emit nodeRemoved(node->nodeId());
     }
@@ -153,11 +230,22 @@ void CanOpenBus::removeNode(Node *node)
 
 void CanOpenBus::exploreBus()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "exploreBus", Qt::QueuedConnection);
+        return;
+    }
     _nodeDiscover->exploreBus();
 }
 
 void CanOpenBus::stopAll()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "stopAll", Qt::QueuedConnection);
+        return;
+    }
+
     QByteArray nmtStopPayload;
     nmtStopPayload.append(static_cast<char>(0x02));
     nmtStopPayload.append(static_cast<char>(0));
@@ -172,9 +260,70 @@ void CanOpenBus::stopAll()
     }
 }
 
-const QList<QCanBusFrame> &CanOpenBus::canFramesLog() const
+CanFrameLog *CanOpenBus::canFramesLog()
 {
-    return _canFramesLog;
+    return &_canFramesLog;
+}
+
+const CanFrameLog *CanOpenBus::canFramesLog() const
+{
+    return &_canFramesLog;
+}
+
+NodeOdJournal *CanOpenBus::odJournal()
+{
+    return &_odJournal;
+}
+
+const NodeOdJournal *CanOpenBus::odJournal() const
+{
+    return &_odJournal;
+}
+
+/**
+ * @brief Records all the frames received and sent to a capture file, see CanCaptureWriter
+ *
+ * The writer is only used in the bus thread, where frames are logged.
+ */
+bool CanOpenBus::startCapture(const QString &fileName)
+{
+    if (QThread::currentThread() != thread())
+    {
+        bool opened = false;
+        QMetaObject::invokeMethod(this, "startCapture", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, opened), Q_ARG(QString, fileName));
+        return opened;
+    }
+    return _captureWriter.open(fileName);
+}
+
+void CanOpenBus::stopCapture()
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "stopCapture", Qt::BlockingQueuedConnection);
+        return;
+    }
+    _captureWriter.close();
+}
+
+bool CanOpenBus::isCapturing() const
+{
+    if (QThread::currentThread() != thread())
+    {
+        bool capturing = false;
+        QMetaObject::invokeMethod(const_cast<CanOpenBus *>(this), "isCapturing", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, capturing));
+        return capturing;
+    }
+    return _captureWriter.isOpen();
+}
+
+void CanOpenBus::logFrame(const QCanBusFrame &frame)
+{
+    _canFramesLog.append(frame);
+    if (_captureWriter.isOpen())
+    {
+        _captureWriter.append(frame);
+    }
 }
 
 CanBusDriver *CanOpenBus::canBusDriver() const
@@ -184,6 +333,23 @@ CanBusDriver *CanOpenBus::canBusDriver() const
 
 void CanOpenBus::setCanBusDriver(CanBusDriver *canBusDriver)
 {
+    if (QThread::currentThread() != thread())
+    {
+        if (canBusDriver != nullptr)
+        {
+            canBusDriver->moveToThread(thread());
+        }
+        QMetaObject::invokeMethod(this, "setCanBusDriver", Qt::BlockingQueuedConnection, Q_ARG(CanBusDriver *, canBusDriver));
+        return;
+    }
+
+    // the SYNC producer thread may write directly to the previous driver
+    int syncPeriodMs = (_sync->status() == Sync::STARTED) ? _sync->periodMs() : 0;
+    if (syncPeriodMs > 0)
+    {
+        _sync->stopSync();
+    }
+
     if (_canBusDriver != nullptr)
     {
         _canBusDriver->deleteLater();
@@ -198,6 +364,12 @@ void CanOpenBus::setCanBusDriver(CanBusDriver *canBusDriver)
         }
         connect(_canBusDriver, &CanBusDriver::framesReceived, this, &CanOpenBus::canFrameRec, Qt::UniqueConnection);
         connect(_canBusDriver, &CanBusDriver::stateChanged, this, &CanOpenBus::updateState);
+        updateKernelFilter();
+    }
+
+    if (syncPeriodMs > 0)
+    {
+        _sync->startSync(syncPeriodMs);
     }
 }
 
@@ -212,23 +384,193 @@ bool CanOpenBus::isConnected() const
 
 bool CanOpenBus::canWrite() const
 {
-    return isConnected() && !_spyMode;
+    return isConnected() && !isSpyMode();
+}
+
+/**
+ * @brief Can be called from any thread, used by the SYNC producer
+ */
+bool CanOpenBus::isSpyMode() const
+{
+    return (_spyMode.loadAcquire() != 0);
+}
+
+/**
+ * @brief In spy mode, nothing is sent on the bus and all frames are received
+ */
+void CanOpenBus::setSpyMode(bool spyMode)
+{
+    _spyMode.storeRelease(spyMode ? 1 : 0);
+    if (spyMode)
+    {
+        _txQueue.clear();
+    }
+    updateKernelFilter();
+}
+
+bool CanOpenBus::isIoThreadEnabled() const
+{
+    return (_ioThread != nullptr);
+}
+
+/**
+ * @brief Runs the bus protocol processing in a dedicated thread, away from the GUI event loop
+ *
+ * Must be called from the thread which created the bus. Nodes added later are moved to the
+ * I/O thread and subscribers keep receiving notifications in their own thread.
+ */
+void CanOpenBus::setIoThreadEnabled(bool enabled)
+{
+    if (enabled == isIoThreadEnabled())
+    {
+        return;
+    }
+
+    if (enabled)
+    {
+        _ioThread = new QThread();
+        _ioThread->setObjectName(QStringLiteral("CanOpenBus %1").arg(_busName));
+        _ioThread->start(QThread::HighPriority);
+        moveObjectsToThread(_ioThread);
+    }
+    else
+    {
+        QMetaObject::invokeMethod(this, "moveObjectsToThread", Qt::BlockingQueuedConnection, Q_ARG(QThread *, QThread::currentThread()));
+        _ioThread->quit();
+        _ioThread->wait();
+        delete _ioThread;
+        _ioThread = nullptr;
+    }
+}
+
+// must be called from the current thread of the bus, timers are restarted in the new thread
+void CanOpenBus::moveObjectsToThread(QThread *thread)
+{
+    _serviceDispatcher->moveToThread(thread);
+    _sync->moveToThread(thread);
+    _timestamp->moveToThread(thread);
+    _nodeDiscover->moveToThread(thread);
+    if (_canBusDriver != nullptr)
+    {
+        _canBusDriver->moveToThread(thread);
+    }
+    for (Node *node : qAsConst(_nodes))
+    {
+        node->moveNodeToThread(thread);
+    }
+    moveToThread(thread);
+}
+
+bool CanOpenBus::isKernelFilterEnabled() const
+{
+    return _kernelFilterEnabled;
+}
+
+/**
+ * @brief When enabled, the driver only receives the COB-IDs registered in the dispatcher,
+ * the frame log then only contains those frames. Disabled by default and in spy mode.
+ */
+void CanOpenBus::setKernelFilterEnabled(bool enabled)
+{
+    _kernelFilterEnabled = enabled;
+    updateKernelFilter();
+}
+
+void CanOpenBus::scheduleKernelFilterUpdate()
+{
+    if (_kernelFilterEnabled)
+    {
+        _kernelFilterTimer->start();
+    }
+}
+
+void CanOpenBus::updateKernelFilter()
+{
+    if (_canBusDriver == nullptr)
+    {
+        return;
+    }
+
+    QVector<CanBusDriver::Filter> filters;
+    if (_kernelFilterEnabled && !isSpyMode())
+    {
+        filters = CanBusDriver::compressFilters(_serviceDispatcher->registeredCobIds(), KERNEL_FILTER_MAX);
+    }
+    _canBusDriver->setFilters(filters);
 }
 
+/**
+ * @brief Queues frame for transmission
+ * @return false if the bus cannot write or the class of the frame is full, always true from
+ * another thread than the bus one, the frame is then posted to the bus thread
+ */
 bool CanOpenBus::writeFrame(const QCanBusFrame &frame)
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "writeFrame", Qt::QueuedConnection, Q_ARG(QCanBusFrame, frame));
+        return true;
+    }
     if (!canWrite())
     {
         return false;
     }
-    _canBusDriver->writeFrame(frame);
-    QCanBusFrame emitFrame = frame;
-    emitFrame.setTimeStamp(QCanBusFrame::TimeStamp::fromMicroSeconds(QDateTime::currentMSecsSinceEpoch() * 1000));
-    emitFrame.setLocalEcho(true);
-    _canFramesLog.append(emitFrame);
+
+    if (!_txQueue.enqueue(frame))
+    {
+        return false;
+    }
+    if (CanOpenTxQueue::priority(frame) <= CanOpenTxQueue::PrioritySync)
+    {
+        flushTxQueue();
+    }
+    else if (!_txFlushTimer->isActive())
+    {
+        // deferred to group all the frames queued during this event loop iteration
+        _txFlushTimer->start(0);
+    }
     return true;
 }
 
+const CanOpenTxQueue &CanOpenBus::txQueue() const
+{
+    return _txQueue;
+}
+
+void CanOpenBus::flushTxQueue()
+{
+    if (!canWrite())
+    {
+        _txQueue.clear();
+        return;
+    }
+
+    _txFrames.clear();
+    int count = _txQueue.take(_txFrames, TX_BATCH_SIZE, TX_BULK_BATCH_SIZE);
+    int written = _canBusDriver->writeFrames(_txFrames.constData(), count);
+
+    QCanBusFrame::TimeStamp stamp = CanBusDriver::currentTimeStamp();
+    for (int i = 0; i < written; i++)
+    {
+        QCanBusFrame emitFrame = _txFrames.at(i);
+        emitFrame.setTimeStamp(stamp);
+        emitFrame.setLocalEcho(true);
+        logFrame(emitFrame);
+    }
+
+    if (written < count)
+    {
+        // driver queue full, keep the remaining frames in order and retry later
+        _txQueue.requeue(_txFrames.constData() + written, count - written);
+        _txFlushTimer->start(TX_RETRY_MS);
+    }
+    else if (!_txQueue.isEmpty())
+    {
+        // let the event loop run between two bursts
+        _txFlushTimer->start(0);
+    }
+}
+
 ServiceDispatcher *CanOpenBus::dispatcher() const
 {
     return _serviceDispatcher;
@@ -239,6 +581,94 @@ Sync *CanOpenBus::sync() const
     return _sync;
 }
 
+/**
+ * @brief SDO statistics of the bus, all nodes merged, computed in the bus thread
+ */
+SdoStatistics CanOpenBus::sdoStatistics() const
+{
+    SdoStatistics statistics;
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(const_cast<CanOpenBus *>(this), "sdoStatistics", Qt::BlockingQueuedConnection, Q_RETURN_ARG(SdoStatistics, statistics));
+        return statistics;
+    }
+
+    for (Node *node : _nodes)
+    {
+        statistics.merge(node->sdoStatistics());
+    }
+    return statistics;
+}
+
+void CanOpenBus::resetSdoStatistics()
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "resetSdoStatistics", Qt::BlockingQueuedConnection);
+        return;
+    }
+
+    for (Node *node : qAsConst(_nodes))
+    {
+        node->resetSdoStatistics();
+    }
+}
+
+/**
+ * @brief SDO statistics of the bus and of each node as a JSON document
+ */
+QByteArray CanOpenBus::exportSdoStatisticsJson() const
+{
+    if (QThread::currentThread() != thread())
+    {
+        QByteArray data;
+        QMetaObject::invokeMethod(const_cast<CanOpenBus *>(this), "exportSdoStatisticsJson", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QByteArray, data));
+        return data;
+    }
+
+    QJsonObject json;
+    json.insert(QStringLiteral("bus"), _busName);
+    json.insert(QStringLiteral("total"), sdoStatistics().toJson());
+
+    QJsonObject nodes;
+    for (Node *node : _nodes)
+    {
+        nodes.insert(QString::number(node->nodeId()), node->sdoStatistics().toJson());
+    }
+    json.insert(QStringLiteral("nodes"), nodes);
+    return QJsonDocument(json).toJson();
+}
+
+/**
+ * @brief SDO statistics as CSV, one row per node and a last row for the whole bus
+ */
+QByteArray CanOpenBus::exportSdoStatisticsCsv() const
+{
+    if (QThread::currentThread() != thread())
+    {
+        QByteArray data;
+        QMetaObject::invokeMethod(const_cast<CanOpenBus *>(this), "exportSdoStatisticsCsv", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QByteArray, data));
+        return data;
+    }
+
+    QStringList rows;
+    rows.append(SdoStatistics::csvHeader());
+    for (Node *node : _nodes)
+    {
+        rows.append(node->sdoStatistics().toCsv(QStringLiteral("node %1").arg(node->nodeId())));
+    }
+    rows.append(sdoStatistics().toCsv(QStringLiteral("total")));
+    return rows.join(QLatin1Char('\n')).append(QLatin1Char('\n')).toUtf8();
+}
+
+/**
+ * @brief Bus wide SDO transfers budget and priority scheduling
+ */
+SdoScheduler *CanOpenBus::sdoScheduler() const
+{
+    return _sdoScheduler;
+}
+
 void CanOpenBus::canFrameRec()
 {
     if (_canBusDriver == nullptr)
@@ -246,26 +676,37 @@ void CanOpenBus::canFrameRec()
         return;
     }
 
-    QCanBusFrame frame = _canBusDriver->readFrame();
-    while (frame.isValid())
+    // consume all the frames available with one wakeup, by batches to reuse the same buffer
+    _rxFrames.clear();
+    while (_canBusDriver->readFrames(_rxFrames, RX_BATCH_SIZE) > 0)
     {
-        _serviceDispatcher->parseFrame(frame);
-        _canFramesLog.append(frame);
-
-        frame = _canBusDriver->readFrame();
+        for (const QCanBusFrame &frame : qAsConst(_rxFrames))
+        {
+            // frames sent by this side, as the ones of a replayed capture, are only logged
+            if (!frame.hasLocalEcho())
+            {
+                _serviceDispatcher->parseFrame(frame);
+            }
+            logFrame(frame);
+        }
+        _rxFrames.clear();
     }
 }
 
 void CanOpenBus::notifyForNewFrames()
 {
-    if (_canFrameLogId < _canFramesLog.count())
+    if (_canFrameLogId < _canFramesLog.endIndex())
     {
-        _canFrameLogId = _canFramesLog.count();
+        _canFrameLogId = _canFramesLog.endIndex();
         emit frameAvailable(_canFrameLogId);
     }
 }
 
 void CanOpenBus::updateState()
 {
+    if (!isConnected())
+    {
+        _txQueue.clear();
+    }
     emit connectedChanged(isConnected());
 }
@@ -24,12 +24,28 @@
 #include <QObject>
 
 #include "busdriver/canbusdriver.h"
+#include "busdriver/cancapturewriter.h"
+#include "canframelog.h"
+#include "canopentxqueue.h"
+#include "nodeodjournal.h"
 #include "node.h"
 #include "services/services.h"
 
+#include <QAtomicInt>
 #include <QMap>
+#include <QMutex>
 
 class CanOpen;
+class QThread;
+class SdoScheduler;
+
+/**
+ * @brief CANopen bus, owns the driver, the services dispatcher and the nodes
+ *
+ * With the I/O thread enabled, the bus, its driver, services and nodes live in a dedicated thread.
+ * Commands issued from another thread (node reads and writes, NMT, frames, sync) are queued to it
+ * and object dictionary notifications are delivered by batch in the subscribers thread.
+ */
 
 class CANOPEN_EXPORT CanOpenBus : public QObject
 {
@@ -43,23 +59,48 @@ public:
     CanOpen *canOpen() const;
     quint8 busId() const;
 
-    const QList<Node *> &nodes() const;
+    QList<Node *> nodes() const;
     Node *node(quint8 nodeId);
-    void addNode(Node *node);
-    void removeNode(Node *node);
+    Q_INVOKABLE void addNode(Node *node);
+    Q_INVOKABLE void removeNode(Node *node);
     bool existNode(quint8 nodeId);
     QList<Node *> nodesFiltered(quint32 vendorId, quint32 productCode = 0xFFFFFFFF) const;
 
     CanBusDriver *canBusDriver() const;
-    void setCanBusDriver(CanBusDriver *canBusDriver);
+    Q_INVOKABLE void setCanBusDriver(CanBusDriver *canBusDriver);
     bool isConnected() const;
     bool canWrite() const;
-    bool writeFrame(const QCanBusFrame &frame);
 
-    const QList<QCanBusFrame> &canFramesLog() const;
+    bool isSpyMode() const;
+    void setSpyMode(bool spyMode);
+
+    bool isKernelFilterEnabled() const;
+    void setKernelFilterEnabled(bool enabled);
+
+    bool isIoThreadEnabled() const;
+    void setIoThreadEnabled(bool enabled);
+
+    Q_INVOKABLE bool writeFrame(const QCanBusFrame &frame);
+    const CanOpenTxQueue &txQueue() const;
+
+    CanFrameLog *canFramesLog();
+    const CanFrameLog *canFramesLog() const;
+
+    NodeOdJournal *odJournal();
+    const NodeOdJournal *odJournal() const;
+
+    Q_INVOKABLE bool startCapture(const QString &fileName);
+    Q_INVOKABLE void stopCapture();
+    Q_INVOKABLE bool isCapturing() const;
 
     ServiceDispatcher *dispatcher() const;
     Sync *sync() const;
+    SdoScheduler *sdoScheduler() const;
+
+    Q_INVOKABLE SdoStatistics sdoStatistics() const;
+    Q_INVOKABLE void resetSdoStatistics();
+    Q_INVOKABLE QByteArray exportSdoStatisticsJson() const;
+    Q_INVOKABLE QByteArray exportSdoStatisticsCsv() const;
 
 public slots:
     void exploreBus();
@@ -67,7 +108,7 @@ public slots:
     void setBusName(const QString &busName);
 
 signals:
-    void frameAvailable(int id);
+    void frameAvailable(qint64 id);
 
     void nodeAboutToBeAdded(int nodeId);
     void nodeAdded(int nodeId);
@@ -81,22 +122,50 @@ signals:
 
 protected slots:
     void canFrameRec();
+    void flushTxQueue();
+    void scheduleKernelFilterUpdate();
+    void updateKernelFilter();
     void notifyForNewFrames();
     void updateState();
 
 protected:
+    Q_INVOKABLE void moveObjectsToThread(QThread *thread);
+
     friend class CanOpen;
+    friend class Sync;
     CanOpen *_canOpen;
     quint8 _busId;
 
     QString _busName;
     QMap<quint8, Node *> _nodesMap;
     QList<Node *> _nodes;
+    mutable QMutex _nodesMutex;  // nodes are added and removed in the bus thread, listed from any thread
     CanBusDriver *_canBusDriver;
 
+    // reception batch buffer
+    enum
+    {
+        RX_BATCH_SIZE = 256
+    };
+    QVector<QCanBusFrame> _rxFrames;
+
+    // transmission queue
+    enum
+    {
+        TX_BATCH_SIZE = 64,       // frames given to the driver per flush
+        TX_BULK_BATCH_SIZE = 16,  // SDO and heartbeat class frames per flush
+        TX_RETRY_MS = 1           // retry delay when the driver queue is full
+    };
+    CanOpenTxQueue _txQueue;
+    QVector<QCanBusFrame> _txFrames;
+    QTimer *_txFlushTimer;
+
     // CAN frames logger
-    QList<QCanBusFrame> _canFramesLog;
-    int _canFrameLogId;
+    CanFrameLog _canFramesLog;
+    NodeOdJournal _odJournal;  // object changes of all the nodes
+    qint64 _canFrameLogId;
+    CanCaptureWriter _captureWriter;
+    void logFrame(const QCanBusFrame &frame);
     QTimer *_canFramesLogTimer;
 
     // services
@@ -104,9 +173,21 @@ protected:
     NodeDiscover *_nodeDiscover;
     Sync *_sync;
     TimeStamp *_timestamp;
+    SdoScheduler *_sdoScheduler;
 
     // spy mode
-    bool _spyMode;
+    QAtomicInt _spyMode;
+
+    // driver reception filters
+    enum
+    {
+        KERNEL_FILTER_MAX = 64
+    };
+    bool _kernelFilterEnabled;
+    QTimer *_kernelFilterTimer;
+
+    // protocol processing thread
+    QThread *_ioThread;
 };
 
 #endif  // CANOPENBUS_H
@@ -0,0 +1,189 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "canopentxqueue.h"
+
+CanOpenTxQueue::CanOpenTxQueue()
+{
+    _count = 0;
+    for (int priority = PriorityNmt; priority < PriorityCount; priority++)
+    {
+        // network management, SYNC and emergencies are never refused
+        _capacities[priority] = (priority >= PriorityPdo) ? DEFAULT_CAPACITY : 0;
+        _droppedCounts[priority] = 0;
+    }
+    resetHighWaterMarks();
+}
+
+/**
+ * @brief Service class of a frame, deduced from its COB-ID
+ */
+CanOpenTxQueue::Priority CanOpenTxQueue::priority(const QCanBusFrame &frame)
+{
+    if (frame.hasExtendedFrameFormat())
+    {
+        return PriorityHeartbeat;
+    }
+
+    quint32 cobId = frame.frameId();
+    if (cobId == 0x000)
+    {
+        return PriorityNmt;
+    }
+    if (cobId == 0x080)
+    {
+        return PrioritySync;
+    }
+    if (cobId <= 0x100)  // EMCY and TIME
+    {
+        return PriorityEmergency;
+    }
+    if (cobId >= 0x180 && cobId < 0x580)
+    {
+        return PriorityPdo;
+    }
+    if (cobId >= 0x580 && cobId < 0x680)
+    {
+        return PrioritySdo;
+    }
+    return PriorityHeartbeat;
+}
+
+/**
+ * @brief Queues frame at the end of its class
+ * @return false if the class is full, the frame is dropped
+ */
+bool CanOpenTxQueue::enqueue(const QCanBusFrame &frame)
+{
+    Priority framePriority = priority(frame);
+    QQueue<QCanBusFrame> &queue = _queues[framePriority];
+    if (_capacities[framePriority] > 0 && queue.count() >= _capacities[framePriority])
+    {
+        _droppedCounts[framePriority]++;
+        return false;
+    }
+    queue.enqueue(frame);
+    _count++;
+    if (queue.count() > _highWaterMarks[framePriority])
+    {
+        _highWaterMarks[framePriority] = queue.count();
+    }
+    return true;
+}
+
+/**
+ * @brief Moves up to maxCount frames to frames, highest priority first
+ * @param maxBulkCount maximum number of SDO and heartbeat class frames taken, limits the time
+ * a burst of bulk frames holds the controller queue in front of latency critical frames
+ * @return number of frames taken
+ */
+int CanOpenTxQueue::take(QVector<QCanBusFrame> &frames, int maxCount, int maxBulkCount)
+{
+    int taken = 0;
+    int bulkTaken = 0;
+    for (int priority = PriorityNmt; priority < PriorityCount && taken < maxCount; priority++)
+    {
+        QQueue<QCanBusFrame> &queue = _queues[priority];
+        while (!queue.isEmpty() && taken < maxCount)
+        {
+            if (priority >= PrioritySdo)
+            {
+                if (bulkTaken >= maxBulkCount)
+                {
+                    break;
+                }
+                bulkTaken++;
+            }
+            frames.append(queue.dequeue());
+            taken++;
+        }
+    }
+    _count -= taken;
+    return taken;
+}
+
+/**
+ * @brief Puts back at the head of their class queue frames taken but not sent, already accepted
+ * frames are never dropped by the bound
+ */
+void CanOpenTxQueue::requeue(const QCanBusFrame *frames, int count)
+{
+    for (int i = count - 1; i >= 0; i--)
+    {
+        _queues[priority(frames[i])].prepend(frames[i]);
+    }
+    _count += count;
+}
+
+void CanOpenTxQueue::clear()
+{
+    for (QQueue<QCanBusFrame> &queue : _queues)
+    {
+        queue.clear();
+    }
+    _count = 0;
+}
+
+bool CanOpenTxQueue::isEmpty() const
+{
+    return _count == 0;
+}
+
+int CanOpenTxQueue::count() const
+{
+    return _count;
+}
+
+int CanOpenTxQueue::count(Priority priority) const
+{
+    return _queues[priority].count();
+}
+
+int CanOpenTxQueue::highWaterMark(Priority priority) const
+{
+    return _highWaterMarks[priority];
+}
+
+void CanOpenTxQueue::resetHighWaterMarks()
+{
+    for (int priority = PriorityNmt; priority < PriorityCount; priority++)
+    {
+        _highWaterMarks[priority] = _queues[priority].count();
+    }
+}
+
+int CanOpenTxQueue::capacity(Priority priority) const
+{
+    return _capacities[priority];
+}
+
+/**
+ * @brief Sets the bound of a class, the frames already queued are kept
+ */
+void CanOpenTxQueue::setCapacity(Priority priority, int capacity)
+{
+    _capacities[priority] = qMax(0, capacity);
+}
+
+/**
+ * @brief Number of frames refused because their class was full
+ */
+quint32 CanOpenTxQueue::droppedCount(Priority priority) const
+{
+    return _droppedCounts[priority];
+}
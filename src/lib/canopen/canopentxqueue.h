@@ -0,0 +1,81 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef CANOPENTXQUEUE_H
+#define CANOPENTXQUEUE_H
+
+#include "canopen_global.h"
+
+#include <QQueue>
+#include <QVector>
+
+#include "busdriver/qcanbusframe.h"
+
+/**
+ * @brief Transmit queue of a CanOpenBus, frames are ordered by CANopen service class
+ *
+ * One FIFO per class, classes are served in CAN arbitration order: NMT, SYNC, EMCY/TIME,
+ * PDO, SDO and heartbeat / others. Order inside a class is kept. PDO, SDO and heartbeat / others
+ * classes are bounded, a frame of a full class is refused.
+ */
+class CANOPEN_EXPORT CanOpenTxQueue
+{
+public:
+    CanOpenTxQueue();
+
+    enum Priority
+    {
+        PriorityNmt,
+        PrioritySync,
+        PriorityEmergency,
+        PriorityPdo,
+        PrioritySdo,
+        PriorityHeartbeat,
+        PriorityCount
+    };
+    static Priority priority(const QCanBusFrame &frame);
+
+    bool enqueue(const QCanBusFrame &frame);
+    int take(QVector<QCanBusFrame> &frames, int maxCount, int maxBulkCount);
+    void requeue(const QCanBusFrame *frames, int count);
+    void clear();
+
+    bool isEmpty() const;
+    int count() const;
+    int count(Priority priority) const;
+    int highWaterMark(Priority priority) const;
+    void resetHighWaterMarks();
+
+    // bound of a class, 0 for an unbounded one
+    enum
+    {
+        DEFAULT_CAPACITY = 1024
+    };
+    int capacity(Priority priority) const;
+    void setCapacity(Priority priority, int capacity);
+    quint32 droppedCount(Priority priority) const;
+
+private:
+    QQueue<QCanBusFrame> _queues[PriorityCount];
+    int _highWaterMarks[PriorityCount];
+    int _capacities[PriorityCount];
+    quint32 _droppedCounts[PriorityCount];
+    int _count;
+};
+
+#endif  // CANOPENTXQUEUE_H
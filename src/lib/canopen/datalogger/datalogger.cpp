@@ -287,8 +287,8 @@ void DataLogger::odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
         return;
     }
 
-    const QVariant &value = dlData->nodeSubIndex()->value();
-    const QDateTime &dateTime = dlData->nodeSubIndex()->lastModification();
+    QVariant value = dlData->nodeSubIndex()->value();
+    QDateTime dateTime = dlData->nodeSubIndex()->lastModification();
     addDataValue(dlData, value, dateTime);
 }
 
@@ -323,7 +323,7 @@ void DataLogger::readData()
     {
         if ((dlData->node() != nullptr) && dlData->isActive())
         {
-            dlData->node()->readObject(dlData->objectId());
+            dlData->node()->readObject(dlData->objectId(), SDO::PriorityBackground);
         }
     }
 }
@@ -24,6 +24,8 @@
 #include "profile/nodeprofile.h"
 #include "profile/nodeprofilefactory.h"
 
+#include <QThread>
+
 Node::Node(quint8 nodeId, const QString &name, const QString &edsFileName)
     : _nodeId(nodeId)
 {
@@ -100,6 +102,36 @@ void Node::setBus(CanOpenBus *bus)
     reset();
 }
 
+/**
+ * @brief Moves the node, its object dictionary, services and profiles to the bus I/O thread,
+ * object dictionary subscribers among them are notified in this thread too
+ */
+void Node::moveNodeToThread(QThread *thread)
+{
+    moveToThread(thread);
+    _nodeOd->moveToThread(thread);
+    for (Service *service : qAsConst(_services))
+    {
+        service->moveToThread(thread);
+    }
+    _errorControl->setSubscriberThread(thread);
+    for (TPDO *tpdo : qAsConst(_tpdos))
+    {
+        tpdo->setSubscriberThread(thread);
+    }
+    for (RPDO *rpdo : qAsConst(_rpdos))
+    {
+        rpdo->setSubscriberThread(thread);
+    }
+    _bootloader->moveToThread(thread);
+    _bootloader->setSubscriberThread(thread);
+    for (NodeProfile *nodeProfile : qAsConst(_nodeProfiles))
+    {
+        nodeProfile->moveToThread(thread);
+        nodeProfile->setSubscriberThread(thread);
+    }
+}
+
 CanOpenBus *Node::bus() const
 {
     return _bus;
@@ -208,15 +240,36 @@ NodeOd *Node::nodeOd() const
     return _nodeOd;
 }
 
-void Node::readObject(const NodeObjectId &id)
+void Node::readObject(const NodeObjectId &id, SDO::Priority priority)
 {
-    readObject(id.index(), id.subIndex(), id.dataType());
+    readObject(id.index(), id.subIndex(), id.dataType(), priority);
 }
 
-void Node::readObject(quint16 index, quint8 subindex, QMetaType::Type dataType)
+void Node::readObject(quint16 index, quint8 subindex, QMetaType::Type dataType, SDO::Priority priority)
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this,
+                                  "readObject",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(quint16, index),
+                                  Q_ARG(quint8, subindex),
+                                  Q_ARG(QMetaType::Type, dataType),
+                                  Q_ARG(SDO::Priority, priority));
+        return;
+    }
+
+    requestRead(index, subindex, dataType, priority, QSharedPointer<SdoBatch>(), 0);
+}
+
+void Node::requestRead(quint16 index, quint8 subindex, QMetaType::Type dataType, SDO::Priority priority, const QSharedPointer<SdoBatch> &batch, int slot)
 {
     if (_status == STOPPED || _status == UNKNOWN)
     {
+        if (!batch.isNull())
+        {
+            batch->cancel(slot);
+        }
         return;
     }
 
@@ -225,6 +278,12 @@ void Node::readObject(quint16 index, quint8 subindex, QMetaType::Type dataType)
     {
         if (tpdoMapped->isEnabled() && _status == STARTED && _bus->sync()->status() == Sync::STARTED)
         {
+            // kept up to date by the PDO
+            if (!batch.isNull())
+            {
+                NodeObjectId objectId(busId(), nodeId(), index, subindex, dataType);
+                batch->complete(slot, NodeObjectResult(objectId, NodeObjectResult::Done, _nodeOd->value(index, subindex)));
+            }
             return;
         }
     }
@@ -234,18 +293,39 @@ void Node::readObject(quint16 index, quint8 subindex, QMetaType::Type dataType)
     {
         mdataType = _nodeOd->dataType(index, subindex);
     }
-    _sdoClients.at(0)->uploadData(index, subindex, mdataType);
+    sdoClient(index, subindex, false)->uploadData(index, subindex, mdataType, priority, batch, slot);
+}
+
+void Node::writeObject(const NodeObjectId &id, const QVariant &data, SDO::Priority priority)
+{
+    writeObject(id.index(), id.subIndex(), data, priority);
 }
 
-void Node::writeObject(const NodeObjectId &id, const QVariant &data)
+void Node::writeObject(quint16 index, quint8 subindex, const QVariant &data, SDO::Priority priority)
 {
-    writeObject(id.index(), id.subIndex(), data);
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this,
+                                  "writeObject",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(quint16, index),
+                                  Q_ARG(quint8, subindex),
+                                  Q_ARG(QVariant, data),
+                                  Q_ARG(SDO::Priority, priority));
+        return;
+    }
+
+    requestWrite(index, subindex, data, priority, QSharedPointer<SdoBatch>(), 0);
 }
 
-void Node::writeObject(quint16 index, quint8 subindex, const QVariant &data)
+void Node::requestWrite(quint16 index, quint8 subindex, const QVariant &data, SDO::Priority priority, const QSharedPointer<SdoBatch> &batch, int slot)
 {
     if (_status == STOPPED /*|| _status == UNKNOWN*/)
     {
+        if (!batch.isNull())
+        {
+            batch->cancel(slot);
+        }
         return;
     }
     // qDebug().nospace() << " > Node::writeObject 0x" << QString::number(index, 16) << "." << subindex << data;
@@ -258,12 +338,14 @@ void Node::writeObject(quint16 index, quint8 subindex, const QVariant &data)
     }
 
     NodeObjectId object(busId(), nodeId(), index, subindex);
-    if ((rpdoMappedObject(NodeObjectId(index, subindex)) != nullptr) && _status == STARTED && _bus->sync()->status() == Sync::STARTED)
+    if ((rpdoMappedObject(NodeObjectId(index, subindex)) != nullptr) && _status == STARTED)
     {
+        // synchronous RPDOs need the SYNC, event-driven ones are sent on write
+        bool syncStarted = (_bus->sync()->status() == Sync::STARTED);
         bool writtenInRpdo = false;
         for (RPDO *rpdo : qAsConst(_rpdos))
         {
-            if (rpdo->isMappedObject(object) && rpdo->isEnabled())
+            if (rpdo->isMappedObject(object) && rpdo->isEnabled() && (syncStarted || rpdo->isEventDriven()))
             {
                 rpdo->write(object, data);
                 writtenInRpdo = true;
@@ -272,11 +354,98 @@ void Node::writeObject(quint16 index, quint8 subindex, const QVariant &data)
 
         if (writtenInRpdo)
         {
+            if (!batch.isNull())
+            {
+                batch->complete(slot, NodeObjectResult(object, NodeObjectResult::Done, mdata));
+            }
             return;
         }
     }
 
-    _sdoClients.at(0)->downloadData(index, subindex, mdata);
+    sdoClient(index, subindex, true)->downloadData(index, subindex, mdata, priority, batch, slot);
+}
+
+/**
+ * @brief Reads an object, the returned future holds one result
+ */
+QFuture<NodeObjectResult> Node::readObjectAsync(const NodeObjectId &id, SDO::Priority priority)
+{
+    QSharedPointer<SdoBatch> batch(new SdoBatch());
+    batch->addRead(id);
+    return executeBatch(batch, priority);
+}
+
+/**
+ * @brief Writes an object, the returned future holds one result
+ */
+QFuture<NodeObjectResult> Node::writeObjectAsync(const NodeObjectId &id, const QVariant &data, SDO::Priority priority)
+{
+    QSharedPointer<SdoBatch> batch(new SdoBatch());
+    batch->addWrite(id, data);
+    return executeBatch(batch, priority);
+}
+
+/**
+ * @brief Reads a list of objects, all requests are queued at once and the future finishes with
+ * one result per object, in the list order
+ */
+QFuture<NodeObjectResult> Node::readObjects(const QList<NodeObjectId> &ids, SDO::Priority priority)
+{
+    QSharedPointer<SdoBatch> batch(new SdoBatch());
+    for (const NodeObjectId &id : ids)
+    {
+        batch->addRead(id);
+    }
+    return executeBatch(batch, priority);
+}
+
+/**
+ * @brief Writes a list of objects in order, writes following a failed one are cancelled
+ */
+QFuture<NodeObjectResult> Node::writeObjects(const QList<QPair<NodeObjectId, QVariant>> &objects, SDO::Priority priority)
+{
+    QSharedPointer<SdoBatch> batch(new SdoBatch(SdoBatch::AllOrNothing));
+    for (const QPair<NodeObjectId, QVariant> &object : objects)
+    {
+        batch->addWrite(object.first, object.second);
+    }
+    return executeBatch(batch, priority);
+}
+
+QFuture<NodeObjectResult> Node::executeBatch(const QSharedPointer<SdoBatch> &batch, SDO::Priority priority)
+{
+    QFuture<NodeObjectResult> future = batch->future();
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "startBatch", Qt::QueuedConnection, Q_ARG(QSharedPointer<SdoBatch>, batch), Q_ARG(SDO::Priority, priority));
+    }
+    else
+    {
+        startBatch(batch, priority);
+    }
+    return future;
+}
+
+void Node::startBatch(const QSharedPointer<SdoBatch> &batch, SDO::Priority priority)
+{
+    for (int slot = 0; slot < batch->count(); slot++)
+    {
+        if (batch->isAborted())
+        {
+            batch->cancel(slot);
+            continue;
+        }
+
+        const SdoBatch::Item &item = batch->item(slot);
+        if (item.write)
+        {
+            requestWrite(item.objectId.index(), item.objectId.subIndex(), item.value, priority, batch, slot);
+        }
+        else
+        {
+            requestRead(item.objectId.index(), item.objectId.subIndex(), item.objectId.dataType(), priority, batch, slot);
+        }
+    }
 }
 
 void Node::loadEds(const QString &fileName)
@@ -296,8 +465,137 @@ QList<SDO *> Node::sdoClients() const
     return _sdoClients;
 }
 
+/**
+ * @brief SDO statistics of the node, all client channels merged, read in the node thread
+ */
+SdoStatistics Node::sdoStatistics() const
+{
+    SdoStatistics statistics;
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(const_cast<Node *>(this), "sdoStatistics", Qt::BlockingQueuedConnection, Q_RETURN_ARG(SdoStatistics, statistics));
+        return statistics;
+    }
+
+    for (SDO *sdo : _sdoClients)
+    {
+        statistics.merge(sdo->statistics());
+    }
+    return statistics;
+}
+
+void Node::resetSdoStatistics()
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "resetSdoStatistics", Qt::BlockingQueuedConnection);
+        return;
+    }
+
+    for (SDO *sdo : qAsConst(_sdoClients))
+    {
+        sdo->resetStatistics();
+    }
+}
+
+/**
+ * @brief Adds a client channel connected to an additional server SDO of the node
+ * @return the new channel, or the existing one with the same COB-IDs
+ */
+SDO *Node::addSdoClient(quint32 cobIdClientToServer, quint32 cobIdServerToClient)
+{
+    if (QThread::currentThread() != thread())
+    {
+        SDO *sdo = nullptr;
+        QMetaObject::invokeMethod(this,
+                                  "addSdoClient",
+                                  Qt::BlockingQueuedConnection,
+                                  Q_RETURN_ARG(SDO *, sdo),
+                                  Q_ARG(quint32, cobIdClientToServer),
+                                  Q_ARG(quint32, cobIdServerToClient));
+        return sdo;
+    }
+
+    for (SDO *sdo : qAsConst(_sdoClients))
+    {
+        if (sdo->cobIdClientToServer() == cobIdClientToServer && sdo->cobIdServerToClient() == cobIdServerToClient)
+        {
+            return sdo;
+        }
+    }
+
+    SDO *sdo = new SDO(this, cobIdClientToServer, cobIdServerToClient);
+    _sdoClients.append(sdo);
+    _services.append(sdo);
+    if (_bus != nullptr)
+    {
+        _bus->dispatcher()->addService(sdo);
+    }
+    return sdo;
+}
+
+/**
+ * @brief Adds a client channel for each valid additional server SDO parameter (0x1201 to 0x127F)
+ * of the node object dictionary
+ */
+void Node::configureSdoClients()
+{
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "configureSdoClients", Qt::QueuedConnection);
+        return;
+    }
+
+    for (quint16 index = 0x1201; index <= 0x127F; index++)
+    {
+        if (!_nodeOd->subIndexExist(index, 1) || !_nodeOd->subIndexExist(index, 2))
+        {
+            continue;
+        }
+        quint32 cobIdClientToServer = _nodeOd->value(index, 1).toUInt();
+        quint32 cobIdServerToClient = _nodeOd->value(index, 2).toUInt();
+        if ((cobIdClientToServer & 0x80000000) != 0 || (cobIdServerToClient & 0x80000000) != 0)  // invalid bit
+        {
+            continue;
+        }
+        addSdoClient(cobIdClientToServer & 0x7FF, cobIdServerToClient & 0x7FF);
+    }
+}
+
+/**
+ * @brief Channel for a request: downloads stay in order on the default channel, uploads go to the
+ * least loaded channel unless a request on the same object or a download is pending before them
+ */
+SDO *Node::sdoClient(quint16 index, quint8 subindex, bool download) const
+{
+    SDO *defaultClient = _sdoClients.first();
+    if (download || _sdoClients.count() == 1 || defaultClient->hasDownloadPending())
+    {
+        return defaultClient;
+    }
+
+    SDO *client = defaultClient;
+    for (SDO *sdo : _sdoClients)
+    {
+        if (sdo->hasRequestOn(index, subindex))
+        {
+            return sdo;
+        }
+        if (sdo->load() < client->load())
+        {
+            client = sdo;
+        }
+    }
+    return client;
+}
+
 void Node::addProfile(NodeProfile *nodeProfile)
 {
+    if (nodeProfile->thread() != thread())
+    {
+        nodeProfile->moveToThread(thread());
+        nodeProfile->setSubscriberThread(thread());
+    }
     _nodeProfiles.append(nodeProfile);
 }
 
@@ -389,30 +687,60 @@ void Node::reset()
 
 void Node::sendPreop()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "sendPreop", Qt::QueuedConnection);
+        return;
+    }
     _nmt->sendPreop();
 }
 
 void Node::sendStart()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "sendStart", Qt::QueuedConnection);
+        return;
+    }
     _nmt->sendStart();
 }
 
 void Node::sendStop()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "sendStop", Qt::QueuedConnection);
+        return;
+    }
     _nmt->sendStop();
 }
 
 void Node::sendResetComm()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "sendResetComm", Qt::QueuedConnection);
+        return;
+    }
     _nmt->sendResetComm();
 }
 
 void Node::sendResetNode()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "sendResetNode", Qt::QueuedConnection);
+        return;
+    }
     _nmt->sendResetNode();
 }
 
 void Node::sendStatusReq()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "sendStatusReq", Qt::QueuedConnection);
+        return;
+    }
     _nmt->sendNodeGuarding();
 }
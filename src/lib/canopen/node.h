@@ -23,11 +23,14 @@
 
 #include <QObject>
 
+#include <QFuture>
 #include <QMetaType>
+#include <QPair>
 
 #include "nodeod.h"
 
 class CanOpenBus;
+class QThread;
 
 class TPDO;
 class RPDO;
@@ -92,16 +95,30 @@ public:
 
     // Node od
     NodeOd *nodeOd() const;
-    void readObject(const NodeObjectId &id);
-    void readObject(quint16 index, quint8 subindex, QMetaType::Type dataType = QMetaType::UnknownType);
-    void writeObject(const NodeObjectId &id, const QVariant &data);
-    void writeObject(quint16 index, quint8 subindex, const QVariant &data);
+    void readObject(const NodeObjectId &id, SDO::Priority priority = SDO::PriorityInteractive);
+    Q_INVOKABLE void readObject(quint16 index,
+                                quint8 subindex,
+                                QMetaType::Type dataType = QMetaType::UnknownType,
+                                SDO::Priority priority = SDO::PriorityInteractive);
+    void writeObject(const NodeObjectId &id, const QVariant &data, SDO::Priority priority = SDO::PriorityInteractive);
+    Q_INVOKABLE void writeObject(quint16 index, quint8 subindex, const QVariant &data, SDO::Priority priority = SDO::PriorityInteractive);
+
+    // asynchronous access
+    QFuture<NodeObjectResult> readObjectAsync(const NodeObjectId &id, SDO::Priority priority = SDO::PriorityInteractive);
+    QFuture<NodeObjectResult> writeObjectAsync(const NodeObjectId &id, const QVariant &data, SDO::Priority priority = SDO::PriorityInteractive);
+    QFuture<NodeObjectResult> readObjects(const QList<NodeObjectId> &ids, SDO::Priority priority = SDO::PriorityInteractive);
+    QFuture<NodeObjectResult> writeObjects(const QList<QPair<NodeObjectId, QVariant>> &objects, SDO::Priority priority = SDO::PriorityInteractive);
+    QFuture<NodeObjectResult> executeBatch(const QSharedPointer<SdoBatch> &batch, SDO::Priority priority = SDO::PriorityInteractive);
 
     void loadEds(const QString &fileName);
     const QString &edsFileName() const;
 
     // SDO
     QList<SDO *> sdoClients() const;
+    Q_INVOKABLE SDO *addSdoClient(quint32 cobIdClientToServer, quint32 cobIdServerToClient);
+    Q_INVOKABLE void configureSdoClients();
+    Q_INVOKABLE SdoStatistics sdoStatistics() const;
+    Q_INVOKABLE void resetSdoStatistics();
 
     // Profiles
     void addProfile(NodeProfile *nodeProfile);
@@ -139,6 +156,7 @@ signals:
 protected:
     friend class CanOpenBus;
     void setBus(CanOpenBus *bus);
+    void moveNodeToThread(QThread *thread);
     CanOpenBus *_bus;
 
     quint8 _nodeId;
@@ -147,6 +165,10 @@ protected:
 
     // services
     QList<SDO *> _sdoClients;
+    SDO *sdoClient(quint16 index, quint8 subindex, bool download) const;
+    void requestRead(quint16 index, quint8 subindex, QMetaType::Type dataType, SDO::Priority priority, const QSharedPointer<SdoBatch> &batch, int slot);
+    void requestWrite(quint16 index, quint8 subindex, const QVariant &data, SDO::Priority priority, const QSharedPointer<SdoBatch> &batch, int slot);
+    Q_INVOKABLE void startBatch(const QSharedPointer<SdoBatch> &batch, SDO::Priority priority);
     QList<TPDO *> _tpdos;
     QList<RPDO *> _rpdos;
     Emergency *_emergency;
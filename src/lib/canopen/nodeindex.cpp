@@ -168,12 +168,7 @@ const QMap<uint8_t, NodeSubIndex *> &NodeIndex::subIndexes() const
  */
 NodeSubIndex *NodeIndex::subIndex(uint8_t subIndex) const
 {
-    if (_nodeSubIndexes.contains(subIndex))
-    {
-        return _nodeSubIndexes.value(subIndex);
-    }
-
-    return nullptr;
+    return _nodeSubIndexes.value(subIndex, nullptr);
 }
 
 /**
@@ -185,6 +180,10 @@ void NodeIndex::addSubIndex(NodeSubIndex *subIndex)
 {
     _nodeSubIndexes.insert(subIndex->subIndex(), subIndex);
     subIndex->_nodeIndex = this;
+    if (_nodeOd != nullptr)
+    {
+        _nodeOd->insertObject(_index, subIndex);
+    }
 }
 
 /**
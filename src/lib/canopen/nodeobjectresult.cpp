@@ -0,0 +1,61 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "nodeobjectresult.h"
+
+NodeObjectResult::NodeObjectResult()
+    : _status(Cancelled),
+      _error(0)
+{
+}
+
+NodeObjectResult::NodeObjectResult(const NodeObjectId &objectId, Status status, const QVariant &value, quint32 error)
+    : _objectId(objectId),
+      _status(status),
+      _value(value),
+      _error(error)
+{
+}
+
+const NodeObjectId &NodeObjectResult::objectId() const
+{
+    return _objectId;
+}
+
+NodeObjectResult::Status NodeObjectResult::status() const
+{
+    return _status;
+}
+
+bool NodeObjectResult::isDone() const
+{
+    return (_status == Done);
+}
+
+/**
+ * @brief Value read from the device, or value written
+ */
+const QVariant &NodeObjectResult::value() const
+{
+    return _value;
+}
+
+quint32 NodeObjectResult::error() const
+{
+    return _error;
+}
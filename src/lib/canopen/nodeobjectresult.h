@@ -0,0 +1,60 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NODEOBJECTRESULT_H
+#define NODEOBJECTRESULT_H
+
+#include "canopen_global.h"
+
+#include <QVariant>
+
+#include "nodeobjectid.h"
+
+/**
+ * @brief Outcome of an asynchronous read or write of a node object
+ */
+class CANOPEN_EXPORT NodeObjectResult
+{
+public:
+    enum Status
+    {
+        Done,      // transfer succeeded
+        Error,     // transfer aborted, see error()
+        Cancelled  // never sent: node stopped or reset, or batch given up after an error
+    };
+
+    NodeObjectResult();
+    NodeObjectResult(const NodeObjectId &objectId, Status status, const QVariant &value = QVariant(), quint32 error = 0);
+
+    const NodeObjectId &objectId() const;
+    Status status() const;
+    bool isDone() const;
+
+    const QVariant &value() const;
+    quint32 error() const;
+
+private:
+    NodeObjectId _objectId;
+    Status _status;
+    QVariant _value;
+    quint32 _error;  // SDO abort code
+};
+
+Q_DECLARE_METATYPE(NodeObjectResult)
+
+#endif  // NODEOBJECTRESULT_H
@@ -18,35 +18,42 @@
 
 #include "nodeod.h"
 
+#include "canopenbus.h"
 #include "indexdb.h"
 #include "model/deviceconfiguration.h"
 #include "node.h"
+#include "nodeodjournal.h"
+#include "nodeodnotifier.h"
 #include "nodeodsubscriber.h"
-#include "parser/edsparser.h"
+#include "nodeodtemplate.h"
 #include "writer/dcfwriter.h"
 
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QThread>
+#include <QVarLengthArray>
+
+#include <algorithm>
 
 NodeOd::NodeOd(Node *node)
     : _node(node)
 {
+    _journal = new NodeOdJournal();
     createMandatoryObjects();
 }
 
 NodeOd::~NodeOd()
 {
     // Remove reference of this instance to all subcriber
-    QMultiMap<quint32, Subscriber>::iterator itSub = _subscribers.begin();
-    while (itSub != _subscribers.end())
+    for (const Subscriber &subscriber : qAsConst(_subscribers))
     {
-        itSub.value().object->_nodeInterrest = nullptr;
-        ++itSub;
+        subscriber.object->_nodeInterrest = nullptr;
     }
 
     qDeleteAll(_nodeIndexes);
     _nodeIndexes.clear();
+    delete _journal;
 }
 
 Node *NodeOd::node() const
@@ -68,21 +75,17 @@ void NodeOd::resetAllObjects()
 
 bool NodeOd::loadEds(const QString &fileName)
 {
-    QString mfileName(fileName);
-    mfileName = QFileInfo(mfileName).canonicalFilePath();
-
-    EdsParser parser;
-    DeviceDescription *deviceDescription = parser.parse(mfileName);
-    if (deviceDescription == nullptr)
+    // parsed once per EDS revision, metadata are shared with all the nodes using the same file
+    QSharedPointer<const NodeOdTemplate> odTemplate = NodeOdTemplate::fromEds(fileName);
+    if (odTemplate.isNull())
     {
         return false;
     }
-    _edsFileInfos = deviceDescription->fileInfos();
+    _odTemplate = odTemplate;
+    _edsFileInfos = odTemplate->fileInfos();
+    _edsFileName = odTemplate->fileName();
 
-    DeviceConfiguration *deviceConfiguration = DeviceConfiguration::fromDeviceDescription(deviceDescription, _node->nodeId());
-    _edsFileName = mfileName;
-
-    for (Index *odIndex : qAsConst(deviceConfiguration->indexes()))
+    for (NodeIndex *odIndex : odTemplate->indexes())
     {
         NodeIndex *nodeIndex;
         nodeIndex = index(odIndex->index());
@@ -91,10 +94,10 @@ bool NodeOd::loadEds(const QString &fileName)
             nodeIndex = new NodeIndex(odIndex->index());
         }
         nodeIndex->setName(odIndex->name());
-        nodeIndex->setObjectType(static_cast<NodeIndex::ObjectType>(odIndex->objectType()));
+        nodeIndex->setObjectType(odIndex->objectType());
         addIndex(nodeIndex);
 
-        for (SubIndex *odSubIndex : odIndex->subIndexes())
+        for (NodeSubIndex *odSubIndex : odIndex->subIndexes())
         {
             NodeSubIndex *nodeSubIndex;
             nodeSubIndex = nodeIndex->subIndex(odSubIndex->subIndex());
@@ -102,26 +105,34 @@ bool NodeOd::loadEds(const QString &fileName)
             {
                 nodeSubIndex = new NodeSubIndex(odSubIndex->subIndex());
             }
+            nodeSubIndex->shareMetaData(*odSubIndex);
+            if (odTemplate->hasNodeId(odSubIndex))
+            {
+                nodeSubIndex->setDefaultValue(odTemplate->defaultValue(odSubIndex, _node->nodeId()));  // detaches only this object
+            }
             if (!nodeSubIndex->value().isValid())
             {
-                nodeSubIndex->setValue(odSubIndex->value());
+                nodeSubIndex->setValue(nodeSubIndex->defaultValue());
             }
-            nodeSubIndex->setDefaultValue(odSubIndex->value());
-            nodeSubIndex->setName(odSubIndex->name());
-            nodeSubIndex->setAccessType(static_cast<NodeSubIndex::AccessType>(odSubIndex->accessType()));
-            nodeSubIndex->setDataType(static_cast<NodeSubIndex::DataType>(odSubIndex->dataType()));
-            nodeSubIndex->setLowLimit(odSubIndex->lowLimit());
-            nodeSubIndex->setHighLimit(odSubIndex->highLimit());
             nodeIndex->addSubIndex(nodeSubIndex);
-
-            nodeSubIndex->setQ1516(IndexDb::isQ1516(nodeSubIndex->objectId(), _node->profileNumber()));
-            nodeSubIndex->setScale(IndexDb::scale(nodeSubIndex->objectId(), _node->profileNumber()));
-            nodeSubIndex->setUnit(IndexDb::unit(nodeSubIndex->objectId(), _node->profileNumber()));
         }
     }
 
-    delete deviceDescription;
-    delete deviceConfiguration;
+    // interpretation of the template is based on the EDS profile, apply the node one if it differs
+    quint16 profileNumber = _node->profileNumber();
+    if (profileNumber != odTemplate->profileNumber())
+    {
+        for (NodeIndex *odIndex : odTemplate->indexes())
+        {
+            for (NodeSubIndex *odSubIndex : odIndex->subIndexes())
+            {
+                NodeSubIndex *nodeSubIndex = subIndex(odIndex->index(), odSubIndex->subIndex());
+                nodeSubIndex->setQ1516(IndexDb::isQ1516(nodeSubIndex->objectId(), profileNumber));
+                nodeSubIndex->setScale(IndexDb::scale(nodeSubIndex->objectId(), profileNumber));
+                nodeSubIndex->setUnit(IndexDb::unit(nodeSubIndex->objectId(), profileNumber));
+            }
+        }
+    }
 
     return true;
 }
@@ -230,8 +241,45 @@ NodeIndex *NodeOd::index(quint16 index) const
  */
 void NodeOd::addIndex(NodeIndex *index)
 {
+    NodeIndex *previousIndex = _nodeIndexes.value(index->index(), nullptr);
+    if (previousIndex != nullptr && previousIndex != index)
+    {
+        // the replaced index keeps its values on its own
+        QWriteLocker locker(&_valuesLock);
+        for (NodeSubIndex *nodeSubIndex : previousIndex->subIndexes())
+        {
+            nodeSubIndex->detach();
+        }
+        previousIndex->_nodeOd = nullptr;
+    }
+
     _nodeIndexes.insert(index->index(), index);
     index->_nodeOd = this;
+
+    for (NodeSubIndex *nodeSubIndex : index->subIndexes())
+    {
+        insertObject(index->index(), nodeSubIndex);
+    }
+}
+
+/**
+ * @brief moves the value of a sub-index to its slot, a previous sub-index with the same number
+ * is detached and keeps its value
+ */
+void NodeOd::insertObject(quint16 index, NodeSubIndex *nodeSubIndex)
+{
+    QWriteLocker locker(&_valuesLock);
+    int slot = _values.slot(index, nodeSubIndex->subIndex());
+    if (slot >= 0)
+    {
+        NodeSubIndex *previousSubIndex = _values.view(slot);
+        if (previousSubIndex == nodeSubIndex)
+        {
+            return;
+        }
+        previousSubIndex->detach();
+    }
+    nodeSubIndex->attach(&_values, index);
 }
 
 /**
@@ -253,21 +301,18 @@ bool NodeOd::indexExist(const quint16 index) const
     return _nodeIndexes.contains(index);
 }
 
+/**
+ * @brief sub-index lookup, the object belongs to the bus thread. From another thread, read values
+ * with value(), errorObject() and lastModification() which hold the values lock
+ */
 NodeSubIndex *NodeOd::subIndex(quint16 index, quint8 subIndex) const
 {
-    NodeIndex *nodeIndex = this->index(index);
-    if (nodeIndex == nullptr)
+    int slot = _values.slot(index, subIndex);
+    if (slot < 0)
     {
         return nullptr;
     }
-
-    NodeSubIndex *nodeSubIndex = nodeIndex->subIndex(subIndex);
-    if (nodeSubIndex == nullptr)
-    {
-        return nullptr;
-    }
-
-    return nodeSubIndex;
+    return _values.view(slot);
 }
 
 NodeSubIndex *NodeOd::subIndex(const NodeObjectId &id) const
@@ -277,35 +322,23 @@ NodeSubIndex *NodeOd::subIndex(const NodeObjectId &id) const
 
 bool NodeOd::subIndexExist(quint16 index, quint8 subIndex) const
 {
-    NodeIndex *nodeIndex = this->index(index);
-    if (nodeIndex == nullptr)
-    {
-        return false;
-    }
-
-    NodeSubIndex *nodeSubIndex = nodeIndex->subIndex(subIndex);
-    return (nodeSubIndex != nullptr);
+    return (this->subIndex(index, subIndex) != nullptr);
 }
 
 int NodeOd::subIndexCount() const
 {
-    int count = 0;
-    for (NodeIndex *index : _nodeIndexes)
-    {
-        count += index->subIndexesCount();
-    }
-    return count;
+    return _values.count();
 }
 
 void NodeOd::setErrorObject(quint16 index, quint8 subIndex, quint32 error) const
 {
-    NodeSubIndex *nodeSubIndex = this->subIndex(index, subIndex);
-    if (nodeSubIndex == nullptr)
+    QWriteLocker locker(&_valuesLock);
+    int slot = _values.slot(index, subIndex);
+    if (slot < 0)
     {
         return;
     }
-
-    nodeSubIndex->setError(error);
+    _values.view(slot)->setError(error);
 }
 
 quint32 NodeOd::errorObject(const NodeObjectId &id) const
@@ -315,13 +348,13 @@ quint32 NodeOd::errorObject(const NodeObjectId &id) const
 
 quint32 NodeOd::errorObject(quint16 index, quint8 subIndex) const
 {
-    NodeSubIndex *nodeSubIndex = this->subIndex(index, subIndex);
-    if (nodeSubIndex == nullptr)
+    QReadLocker locker(&_valuesLock);
+    int slot = _values.slot(index, subIndex);
+    if (slot < 0)
     {
         return 0;
     }
-
-    return nodeSubIndex->error();
+    return _values.error(slot);
 }
 
 QVariant NodeOd::value(const NodeObjectId &id) const
@@ -331,13 +364,13 @@ QVariant NodeOd::value(const NodeObjectId &id) const
 
 QVariant NodeOd::value(quint16 index, quint8 subIndex) const
 {
-    NodeSubIndex *nodeSubIndex = this->subIndex(index, subIndex);
-    if (nodeSubIndex == nullptr)
+    QReadLocker locker(&_valuesLock);
+    int slot = _values.slot(index, subIndex);
+    if (slot < 0)
     {
         return QVariant();
     }
-
-    return nodeSubIndex->value();
+    return _values.value(slot);
 }
 
 QMetaType::Type NodeOd::dataTypeCiaToQt(NodeSubIndex::DataType type)
@@ -442,55 +475,54 @@ QDateTime NodeOd::lastModification(const NodeObjectId &id) const
 
 QDateTime NodeOd::lastModification(quint16 index, quint8 subIndex) const
 {
-    NodeSubIndex *nodeSubIndex = this->subIndex(index, subIndex);
-    if (nodeSubIndex == nullptr)
+    QReadLocker locker(&_valuesLock);
+    int slot = _values.slot(index, subIndex);
+    if (slot < 0)
     {
         return QDateTime();
     }
-
-    return nodeSubIndex->lastModification();
+    return _values.lastModification(slot);
 }
 
 void NodeOd::subscribe(NodeOdSubscriber *object, quint16 notifyIndex, quint8 notifySubIndex)
 {
     Subscriber subscriber;
+    subscriber.key = (static_cast<quint32>(notifyIndex) << 8) + notifySubIndex;
     subscriber.object = object;
-    subscriber.notifyIndex = notifyIndex;
-    subscriber.notifySubIndex = notifySubIndex;
-    quint32 key = (static_cast<quint32>(notifyIndex) << 8) + notifySubIndex;
-    _subscribers.insert(key, subscriber);
+    QMutexLocker locker(&_subscribersMutex);
+    QVector<Subscriber>::iterator it = std::upper_bound(_subscribers.begin(),
+                                                        _subscribers.end(),
+                                                        subscriber.key,
+                                                        [](quint32 key, const Subscriber &other)
+                                                        {
+                                                            return key < other.key;
+                                                        });
+    _subscribers.insert(it, subscriber);
 }
 
 void NodeOd::unsubscribe(NodeOdSubscriber *object)
 {
-    QMultiMap<quint32, Subscriber>::iterator itSub = _subscribers.begin();
-    while (itSub != _subscribers.end())
-    {
-        if (itSub.value().object == object)
-        {
-            itSub = _subscribers.erase(itSub);
-        }
-        else
-        {
-            ++itSub;
-        }
-    }
+    QMutexLocker locker(&_subscribersMutex);
+    QVector<Subscriber>::iterator it = std::remove_if(_subscribers.begin(),
+                                                      _subscribers.end(),
+                                                      [object](const Subscriber &subscriber)
+                                                      {
+                                                          return subscriber.object == object;
+                                                      });
+    _subscribers.erase(it, _subscribers.end());
 }
 
 void NodeOd::unsubscribe(NodeOdSubscriber *object, quint16 notifyIndex, quint8 notifySubIndex)
 {
-    QMultiMap<quint32, Subscriber>::iterator itSub = _subscribers.begin();
-    while (itSub != _subscribers.end())
-    {
-        if ((*itSub).object == object && (*itSub).notifyIndex == notifyIndex && (*itSub).notifySubIndex == notifySubIndex)
-        {
-            itSub = _subscribers.erase(itSub);
-        }
-        else
-        {
-            ++itSub;
-        }
-    }
+    quint32 key = (static_cast<quint32>(notifyIndex) << 8) + notifySubIndex;
+    QMutexLocker locker(&_subscribersMutex);
+    QVector<Subscriber>::iterator it = std::remove_if(_subscribers.begin(),
+                                                      _subscribers.end(),
+                                                      [object, key](const Subscriber &subscriber)
+                                                      {
+                                                          return subscriber.key == key && subscriber.object == object;
+                                                      });
+    _subscribers.erase(it, _subscribers.end());
 }
 
 void NodeOd::updateObjectFromDevice(quint16 index, quint8 subindex, const QVariant &value, NodeOd::FlagsRequest flags, const QDateTime &modificationDate)
@@ -501,6 +533,19 @@ void NodeOd::updateObjectFromDevice(quint16 index, quint8 subindex, const QVaria
         return;
     }
 
+    updateObjectFromDevice(nodeSubIndex, value, flags, modificationDate);
+}
+
+/**
+ * @brief Same as updateObjectFromDevice with an already resolved sub-index, used by the PDO
+ * mapping plans to avoid the index and sub-index lookups
+ */
+void NodeOd::updateObjectFromDevice(NodeSubIndex *nodeSubIndex, const QVariant &value, NodeOd::FlagsRequest flags, const QDateTime &modificationDate)
+{
+    quint16 index = nodeSubIndex->index();
+    quint8 subindex = nodeSubIndex->subIndex();
+
+    _valuesLock.lockForWrite();
     if ((flags & NodeOd::Error) == 0)
     {
         nodeSubIndex->clearError();
@@ -510,15 +555,28 @@ void NodeOd::updateObjectFromDevice(quint16 index, quint8 subindex, const QVaria
     {
         nodeSubIndex->setError(static_cast<quint32>(value.toUInt()));
     }
+    _valuesLock.unlock();
 
-    quint32 key = (static_cast<quint32>(index) << 8) + subindex;
-    notifySubscribers(key, index, subindex, flags);  // notify subscribers to index/subindex
+    // journals are disabled until a consumer sets their capacity
+    CanOpenBus *bus = _node->bus();
+    NodeOdJournal *busJournal = (bus != nullptr && bus->odJournal()->capacity() > 0) ? bus->odJournal() : nullptr;
+    if (_journal->capacity() > 0 || busJournal != nullptr)
+    {
+        NodeObjectId objId(_node->busId(), _node->nodeId(), index, subindex);
+        qint64 stamp = modificationDate.isValid() ? modificationDate.toMSecsSinceEpoch() : QDateTime::currentMSecsSinceEpoch();
+        _journal->append(objId, value, stamp, flags);
+        if (busJournal != nullptr)
+        {
+            busJournal->append(objId, value, stamp, flags);
+        }
+    }
 
-    key = (static_cast<quint32>(index) << 8) + 0xFFU;
-    notifySubscribers(key, index, subindex, flags);  // notify subscribers to index with all subindex
+    notifySubscribers(index, subindex, flags);
+}
 
-    key = (static_cast<quint32>(0xFFFFU) << 8) + 0xFFU;
-    notifySubscribers(key, index, subindex, flags);  // notify subscribers to the full od
+NodeOdJournal *NodeOd::journal() const
+{
+    return _journal;
 }
 
 void NodeOd::createMandatoryObjects()
@@ -706,15 +764,46 @@ const QMap<QString, QString> &NodeOd::edsFileInfos() const
     return _edsFileInfos;
 }
 
-void NodeOd::notifySubscribers(quint32 key, quint16 notifyIndex, quint8 notifySubIndex, NodeOd::FlagsRequest flags)
+void NodeOd::notifySubscribers(quint16 notifyIndex, quint8 notifySubIndex, NodeOd::FlagsRequest flags)
 {
-    QList<Subscriber> interrestedSubscribers = _subscribers.values(key);
-    QList<Subscriber>::const_iterator subscriber = interrestedSubscribers.cbegin();
-    while (subscriber != interrestedSubscribers.cend())
+    // subscribers to index/subindex, to index with all subindex and to the full od
+    const quint32 keys[] = {(static_cast<quint32>(notifyIndex) << 8) + notifySubIndex,
+                            (static_cast<quint32>(notifyIndex) << 8) + 0xFFU,
+                            (static_cast<quint32>(0xFFFFU) << 8) + 0xFFU};
+    NodeObjectId objId(_node->busId(), _node->nodeId(), notifyIndex, notifySubIndex);
+    QThread *currentThread = QThread::currentThread();
+
+    // coalesced subscribers and subscribers living in another thread are notified through their
+    // notifier, while locked so that an unsubscribed object never receives a notification afterwards
+    QVarLengthArray<NodeOdSubscriber *, 16> immediateSubscribers;
+    _subscribersMutex.lock();
+    for (quint32 key : keys)
+    {
+        QVector<Subscriber>::const_iterator subscriber = std::lower_bound(_subscribers.cbegin(),
+                                                                          _subscribers.cend(),
+                                                                          key,
+                                                                          [](const Subscriber &other, quint32 key)
+                                                                          {
+                                                                              return other.key < key;
+                                                                          });
+        while (subscriber != _subscribers.cend() && (*subscriber).key == key)
+        {
+            NodeOdSubscriber *nodeOdSubscriber = (*subscriber).object;
+            if (nodeOdSubscriber->_subscriberThread == currentThread && nodeOdSubscriber->_notifyMode == NodeOdSubscriber::NotifyImmediate)
+            {
+                immediateSubscribers.append(nodeOdSubscriber);
+            }
+            else
+            {
+                NodeOdNotifier::post(nodeOdSubscriber->_subscriberThread, nodeOdSubscriber->_notifyInterval, nodeOdSubscriber, objId, flags);
+            }
+            ++subscriber;
+        }
+    }
+    _subscribersMutex.unlock();
+
+    for (NodeOdSubscriber *nodeOdSubscriber : qAsConst(immediateSubscribers))
     {
-        NodeOdSubscriber *nodeOdSubscriber = (*subscriber).object;
-        NodeObjectId objId(_node->busId(), _node->nodeId(), notifyIndex, notifySubIndex);
         nodeOdSubscriber->notifySubscriber(objId, flags);
-        ++subscriber;
     }
 }
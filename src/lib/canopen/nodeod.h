@@ -24,14 +24,20 @@
 #include <QObject>
 
 #include <QMap>
-#include <QMultiMap>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QVector>
 
 #include "nodeindex.h"
 #include "nodeobjectid.h"
+#include "nodeodvalues.h"
 #include "services/sdo.h"
 
 class Node;
+class NodeOdJournal;
 class NodeOdSubscriber;
+class NodeOdTemplate;
 
 class CANOPEN_EXPORT NodeOd : public QObject
 {
@@ -97,6 +103,10 @@ public:
     void unsubscribe(NodeOdSubscriber *object, quint16 notifyIndex, quint8 notifySubIndex);
     void
     updateObjectFromDevice(quint16 index, quint8 subindex, const QVariant &value, NodeOd::FlagsRequest flags, const QDateTime &modificationDate = QDateTime());
+    void updateObjectFromDevice(NodeSubIndex *nodeSubIndex, const QVariant &value, NodeOd::FlagsRequest flags, const QDateTime &modificationDate = QDateTime());
+
+    // change journal, disabled until NodeOdJournal::setCapacity(), pulled with changesSince()
+    NodeOdJournal *journal() const;
 
     // default objects
     void createMandatoryObjects();
@@ -105,17 +115,28 @@ public:
 private:
     Node *_node;
     QMap<quint16, NodeIndex *> _nodeIndexes;
+
+    // values of all the sub-indexes in packed slots, directly indexed by (index, sub-index)
+    NodeOdValues _values;
+    friend class NodeIndex;
+    void insertObject(quint16 index, NodeSubIndex *nodeSubIndex);
+
     QString _edsFileName;
     QMap<QString, QString> _edsFileInfos;
+    QSharedPointer<const NodeOdTemplate> _odTemplate;  // keeps the shared metadata cached while the node lives
+    mutable QReadWriteLock _valuesLock;  // values and slots are written by the bus thread and read by views
 
+    // subscriptions sorted by index << 8 | subIndex, 0xFF sub-index and 0xFFFF index are wildcards
     struct Subscriber
     {
+        quint32 key;
         NodeOdSubscriber *object;
-        quint16 notifyIndex;
-        quint8 notifySubIndex;
     };
-    QMultiMap<quint32, Subscriber> _subscribers;
-    void notifySubscribers(quint32 key, quint16 notifyIndex, quint8 notifySubIndex, NodeOd::FlagsRequest flags);
+    QVector<Subscriber> _subscribers;
+    QMutex _subscribersMutex;
+
+    NodeOdJournal *_journal;
+    void notifySubscribers(quint16 notifyIndex, quint8 notifySubIndex, NodeOd::FlagsRequest flags);
 };
 
 #endif  // NODEOD_H
@@ -0,0 +1,177 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "nodeodjournal.h"
+
+NodeOdJournal::NodeOdJournal(int capacity)
+{
+    capacity = qMax(0, capacity);
+    _capacity.storeRelease(capacity);
+    _entries.resize(capacity);
+    _head = 0;
+    _count = 0;
+    _lastSeq = 0;
+}
+
+/**
+ * @brief Records a change, the oldest one is dropped when the journal is full
+ * @return sequence number of the change, starting at 1, or 0 if the journal is disabled
+ */
+qint64 NodeOdJournal::append(const NodeObjectId &objId, const QVariant &value, qint64 stamp, NodeOd::FlagsRequest flags)
+{
+    if (_capacity.loadAcquire() == 0)
+    {
+        return 0;
+    }
+
+    QMutexLocker locker(&_mutex);
+    if (_entries.isEmpty())
+    {
+        return 0;
+    }
+    int pos = (_head + _count) % _entries.count();
+    if (_count == _entries.count())
+    {
+        _head = (_head + 1) % _entries.count();
+    }
+    else
+    {
+        _count++;
+    }
+
+    Change &change = _entries[pos];
+    change.seq = ++_lastSeq;
+    change.objId = objId;
+    change.value = value;
+    change.stamp = stamp;
+    change.flags = flags;
+    return _lastSeq;
+}
+
+/**
+ * @brief Drops all the changes, sequence numbers keep increasing
+ */
+void NodeOdJournal::clear()
+{
+    QMutexLocker locker(&_mutex);
+    for (Change &change : _entries)
+    {
+        change.value = QVariant();
+    }
+    _head = 0;
+    _count = 0;
+}
+
+/**
+ * @brief sequence of the oldest change still in the journal, lastSeq() + 1 if empty
+ */
+qint64 NodeOdJournal::firstSeq() const
+{
+    QMutexLocker locker(&_mutex);
+    return _lastSeq - _count + 1;
+}
+
+/**
+ * @brief sequence of the last change, 0 if nothing was recorded yet
+ */
+qint64 NodeOdJournal::lastSeq() const
+{
+    QMutexLocker locker(&_mutex);
+    return _lastSeq;
+}
+
+int NodeOdJournal::count() const
+{
+    QMutexLocker locker(&_mutex);
+    return _count;
+}
+
+/**
+ * @brief Returns the changes recorded after seq, oldest first
+ * @param seq last sequence already processed by the caller, 0 for all the journal
+ * @param maxCount maximum number of changes returned, -1 for no limit
+ * @param lost set to true if changes after seq were already dropped from the journal
+ */
+QVector<NodeOdJournal::Change> NodeOdJournal::changesSince(qint64 seq, int maxCount, bool *lost) const
+{
+    QVector<Change> changes;
+    QMutexLocker locker(&_mutex);
+
+    qint64 firstSeq = _lastSeq - _count + 1;
+    if (lost != nullptr)
+    {
+        *lost = (seq + 1 < firstSeq);
+    }
+    qint64 from = qMax(seq + 1, firstSeq);
+    if (from > _lastSeq)
+    {
+        return changes;
+    }
+
+    int size = static_cast<int>(_lastSeq - from + 1);
+    if (maxCount >= 0 && size > maxCount)
+    {
+        size = maxCount;
+    }
+    changes.reserve(size);
+    int pos = (_head + static_cast<int>(from - firstSeq)) % _entries.count();
+    for (int i = 0; i < size; i++)
+    {
+        changes.append(_entries.at(pos));
+        pos = (pos + 1) % _entries.count();
+    }
+    return changes;
+}
+
+int NodeOdJournal::capacity() const
+{
+    return _capacity.loadAcquire();
+}
+
+/**
+ * @brief Resizes the journal, the newest changes are kept, 0 disables and frees it
+ */
+void NodeOdJournal::setCapacity(int capacity)
+{
+    capacity = qMax(0, capacity);
+    QMutexLocker locker(&_mutex);
+    if (capacity == _entries.count())
+    {
+        return;
+    }
+    _capacity.storeRelease(capacity);
+    if (capacity == 0 || _entries.isEmpty())
+    {
+        QVector<Change>(capacity).swap(_entries);
+        _head = 0;
+        _count = 0;
+        return;
+    }
+
+    int count = qMin(_count, capacity);
+    QVector<Change> entries(capacity);
+    int pos = (_head + _count - count) % _entries.count();
+    for (int i = 0; i < count; i++)
+    {
+        entries[i] = _entries.at(pos);
+        pos = (pos + 1) % _entries.count();
+    }
+    _entries.swap(entries);
+    _head = 0;
+    _count = count;
+}
@@ -0,0 +1,76 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NODEODJOURNAL_H
+#define NODEODJOURNAL_H
+
+#include "canopen_global.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QVariant>
+#include <QVector>
+
+#include "nodeobjectid.h"
+#include "nodeod.h"
+
+/**
+ * @brief Bounded journal of object dictionary changes with monotonic sequence numbers
+ *
+ * Each value or error update is kept in a fixed capacity ring with its sequence number. A
+ * consumer keeps the last sequence it processed and pulls all the newer changes in one call,
+ * without subscribing to each object. The journal is disabled with a capacity of 0 until a
+ * consumer calls setCapacity(), nothing is allocated or locked on append in that case. All
+ * methods are thread safe, the journal is filled by the bus thread and read from any thread.
+ */
+class CANOPEN_EXPORT NodeOdJournal
+{
+public:
+    NodeOdJournal(int capacity = 0);
+
+    struct Change
+    {
+        qint64 seq;
+        NodeObjectId objId;
+        QVariant value;  // error code for NodeOd::Error changes
+        qint64 stamp;    // ms since epoch
+        NodeOd::FlagsRequest flags;
+    };
+
+    qint64 append(const NodeObjectId &objId, const QVariant &value, qint64 stamp, NodeOd::FlagsRequest flags);
+    void clear();
+
+    qint64 firstSeq() const;
+    qint64 lastSeq() const;
+    int count() const;
+    QVector<Change> changesSince(qint64 seq, int maxCount = -1, bool *lost = nullptr) const;
+
+    // retention
+    int capacity() const;
+    void setCapacity(int capacity);
+
+private:
+    mutable QMutex _mutex;
+    QAtomicInt _capacity;
+    QVector<Change> _entries;
+    int _head;
+    int _count;
+    qint64 _lastSeq;
+};
+
+#endif  // NODEODJOURNAL_H
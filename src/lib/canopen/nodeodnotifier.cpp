@@ -0,0 +1,186 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "nodeodnotifier.h"
+
+#include <QThread>
+
+#include "nodeodsubscriber.h"
+
+QMutex NodeOdNotifier::_notifiersMutex;
+QHash<QPair<QThread *, int>, NodeOdNotifier *> NodeOdNotifier::_notifiers;
+
+NodeOdNotifier::NodeOdNotifier(int interval)
+{
+    _deliverIndex = 0;
+
+    _interval = interval;
+    _intervalTimer = new QTimer(this);
+    _intervalTimer->setSingleShot(true);
+    connect(_intervalTimer, &QTimer::timeout, this, &NodeOdNotifier::deliver);
+}
+
+/**
+ * @brief Queues a notification for a subscriber living in thread
+ * @param interval minimum time between two deliveries in ms, 0 to deliver on each event loop tick
+ */
+void NodeOdNotifier::post(QThread *thread, int interval, NodeOdSubscriber *subscriber, const NodeObjectId &objId, NodeOd::FlagsRequest flags)
+{
+    // locked while posting, the notifier cannot be released meanwhile
+    QMutexLocker locker(&_notifiersMutex);
+    NodeOdNotifier *notifier = NodeOdNotifier::notifier(thread, interval);
+    if (notifier != nullptr)
+    {
+        notifier->post(subscriber, objId, flags);
+    }
+}
+
+/**
+ * @brief Drops the notifications not yet delivered to a subscriber, if thread has a notifier
+ */
+void NodeOdNotifier::cancel(QThread *thread, int interval, NodeOdSubscriber *subscriber)
+{
+    QMutexLocker locker(&_notifiersMutex);
+    NodeOdNotifier *notifier = _notifiers.value(qMakePair(thread, interval), nullptr);
+    if (notifier != nullptr)
+    {
+        notifier->cancel(subscriber);
+    }
+}
+
+/**
+ * @brief Returns the notifier of thread for a coalescing interval, created on first use, nullptr
+ * if thread already finished. Called with _notifiersMutex locked
+ */
+NodeOdNotifier *NodeOdNotifier::notifier(QThread *thread, int interval)
+{
+    QPair<QThread *, int> key(thread, interval);
+    NodeOdNotifier *notifier = _notifiers.value(key, nullptr);
+    if (notifier == nullptr)
+    {
+        if (thread == nullptr || thread->isFinished())
+        {
+            return nullptr;
+        }
+        notifier = new NodeOdNotifier(interval);
+        notifier->moveToThread(thread);
+        connect(thread, &QThread::finished, notifier, &NodeOdNotifier::release, Qt::DirectConnection);
+        _notifiers.insert(key, notifier);
+    }
+    return notifier;
+}
+
+int NodeOdNotifier::interval() const
+{
+    return _interval;
+}
+
+/**
+ * @brief Queues a notification, repeated notifications of an object not yet delivered are merged
+ */
+void NodeOdNotifier::post(NodeOdSubscriber *subscriber, const NodeObjectId &objId, NodeOd::FlagsRequest flags)
+{
+    QMutexLocker locker(&_mutex);
+    QPair<NodeOdSubscriber *, quint64> key(subscriber, objId.key());
+    QHash<QPair<NodeOdSubscriber *, quint64>, int>::const_iterator it = _pendingIndexes.constFind(key);
+    if (it != _pendingIndexes.constEnd() && _pending.at(it.value()).flags == flags)
+    {
+        return;
+    }
+
+    bool wasEmpty = _pending.isEmpty();
+    _pendingIndexes.insert(key, _pending.count());
+    _pending.append({subscriber, objId, flags});
+    if (wasEmpty)
+    {
+        QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Drops the notifications not yet delivered to a subscriber being destroyed
+ */
+void NodeOdNotifier::cancel(NodeOdSubscriber *subscriber)
+{
+    QMutexLocker locker(&_mutex);
+    for (Notification &notification : _pending)
+    {
+        if (notification.subscriber == subscriber)
+        {
+            notification.subscriber = nullptr;
+        }
+    }
+    for (int i = _deliverIndex; i < _delivering.count(); i++)
+    {
+        if (_delivering.at(i).subscriber == subscriber)
+        {
+            _delivering[i].subscriber = nullptr;
+        }
+    }
+}
+
+void NodeOdNotifier::deliver()
+{
+    // notifications posted meanwhile keep being merged until the interval elapsed
+    if (_interval > 0 && _lastDelivery.isValid())
+    {
+        qint64 remaining = _interval - _lastDelivery.elapsed();
+        if (remaining > 0)
+        {
+            _intervalTimer->start(static_cast<int>(remaining));
+            return;
+        }
+    }
+    _lastDelivery.start();
+
+    _mutex.lock();
+    _delivering.swap(_pending);
+    _pending.clear();
+    _pendingIndexes.clear();
+    _deliverIndex = 0;
+
+    while (_deliverIndex < _delivering.count())
+    {
+        Notification notification = _delivering.at(_deliverIndex);
+        _deliverIndex++;
+        if (notification.subscriber == nullptr)
+        {
+            continue;
+        }
+
+        // a subscriber may unsubscribe or delete another one from its callback
+        _mutex.unlock();
+        notification.subscriber->notifySubscriber(notification.objId, notification.flags);
+        _mutex.lock();
+    }
+    _delivering.clear();
+    _deliverIndex = 0;
+    _mutex.unlock();
+}
+
+/**
+ * @brief Deletes the notifier when its thread finished, called in that thread. deleteLater() would
+ * never run without its event loop
+ */
+void NodeOdNotifier::release()
+{
+    QMutexLocker locker(&_notifiersMutex);
+    _notifiers.remove(qMakePair(thread(), _interval));
+    locker.unlock();
+    delete this;
+}
@@ -0,0 +1,87 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NODEODNOTIFIER_H
+#define NODEODNOTIFIER_H
+
+#include "canopen_global.h"
+
+#include <QObject>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QTimer>
+#include <QVector>
+
+#include "nodeobjectid.h"
+#include "nodeod.h"
+
+class NodeOdSubscriber;
+class QThread;
+
+/**
+ * @brief Delivers object dictionary notifications to subscribers living in another thread
+ *
+ * One notifier exists per thread with subscribers and per coalescing interval. Notifications posted
+ * from the bus thread, or from coalesced subscribers, are merged and delivered by batch in the
+ * subscriber thread event loop, at most once per interval if one is set. Notifiers are looked up
+ * by thread on each use and never cached, a notifier is deleted when its thread finishes.
+ */
+class CANOPEN_EXPORT NodeOdNotifier : public QObject
+{
+    Q_OBJECT
+public:
+    static void post(QThread *thread, int interval, NodeOdSubscriber *subscriber, const NodeObjectId &objId, NodeOd::FlagsRequest flags);
+    static void cancel(QThread *thread, int interval, NodeOdSubscriber *subscriber);
+
+    int interval() const;
+
+protected slots:
+    void deliver();
+    void release();
+
+private:
+    NodeOdNotifier(int interval);
+    static NodeOdNotifier *notifier(QThread *thread, int interval);
+
+    void post(NodeOdSubscriber *subscriber, const NodeObjectId &objId, NodeOd::FlagsRequest flags);
+    void cancel(NodeOdSubscriber *subscriber);
+
+    struct Notification
+    {
+        NodeOdSubscriber *subscriber;
+        NodeObjectId objId;
+        NodeOd::FlagsRequest flags;
+    };
+    QMutex _mutex;
+    QVector<Notification> _pending;
+    QHash<QPair<NodeOdSubscriber *, quint64>, int> _pendingIndexes;
+    QVector<Notification> _delivering;
+    int _deliverIndex;
+
+    int _interval;  // ms
+    QTimer *_intervalTimer;
+    QElapsedTimer _lastDelivery;
+
+    static QMutex _notifiersMutex;
+    static QHash<QPair<QThread *, int>, NodeOdNotifier *> _notifiers;
+};
+
+#endif  // NODEODNOTIFIER_H
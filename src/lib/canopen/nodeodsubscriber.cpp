@@ -19,15 +19,22 @@
 #include "nodeodsubscriber.h"
 
 #include "node.h"
+#include "nodeodnotifier.h"
+
+#include <QThread>
 
 NodeOdSubscriber::NodeOdSubscriber()
 {
     _nodeInterrest = nullptr;
+    _subscriberThread = QThread::currentThread();
+    _notifyMode = NotifyImmediate;
+    _notifyInterval = 0;
 }
 
 NodeOdSubscriber::~NodeOdSubscriber()
 {
     unRegisterFullOd();
+    NodeOdNotifier::cancel(_subscriberThread, _notifyInterval, this);
 }
 
 void NodeOdSubscriber::notifySubscriber(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
@@ -35,6 +42,48 @@ void NodeOdSubscriber::notifySubscriber(const NodeObjectId &objId, NodeOd::Flags
     this->odNotify(objId, flags);
 }
 
+QThread *NodeOdSubscriber::subscriberThread() const
+{
+    return _subscriberThread;
+}
+
+/**
+ * @brief Sets the thread where notifications are delivered, the constructing thread by default
+ *
+ * Notifications from a node living in another thread are posted to this thread event loop.
+ * Subscribers owning other subscribers forward the new thread to them.
+ */
+void NodeOdSubscriber::setSubscriberThread(QThread *thread)
+{
+    NodeOdNotifier::cancel(_subscriberThread, _notifyInterval, this);
+    _subscriberThread = thread;
+}
+
+NodeOdSubscriber::NotifyMode NodeOdSubscriber::notifyMode() const
+{
+    return _notifyMode;
+}
+
+int NodeOdSubscriber::notifyInterval() const
+{
+    return _notifyInterval;
+}
+
+/**
+ * @brief Sets how object updates are delivered, immediately by default
+ *
+ * In coalesced mode, updates of an object are merged until the next event loop tick of the
+ * subscriber thread, or until notifyInterval ms elapsed since the previous delivery. Views
+ * refreshed at screen rate should use it, latency sensitive subscribers keep the immediate mode.
+ * Pending notifications are dropped, to be called before registering objects.
+ */
+void NodeOdSubscriber::setNotifyMode(NotifyMode notifyMode, int notifyInterval)
+{
+    NodeOdNotifier::cancel(_subscriberThread, _notifyInterval, this);
+    _notifyMode = notifyMode;
+    _notifyInterval = (notifyMode == NotifyCoalesced) ? qMax(0, notifyInterval) : 0;
+}
+
 Node *NodeOdSubscriber::nodeInterrest() const
 {
     return _nodeInterrest;
@@ -29,6 +29,7 @@
 #include "services/sdo.h"
 
 class Node;
+class QThread;
 
 class CANOPEN_EXPORT NodeOdSubscriber
 {
@@ -40,6 +41,18 @@ public:
 
     QList<NodeObjectId> objIdList() const;
 
+    QThread *subscriberThread() const;
+    virtual void setSubscriberThread(QThread *thread);
+
+    enum NotifyMode
+    {
+        NotifyImmediate,  // notified on each object update
+        NotifyCoalesced   // at most one notification per object and per event loop tick or interval
+    };
+    NotifyMode notifyMode() const;
+    int notifyInterval() const;
+    void setNotifyMode(NotifyMode notifyMode, int notifyInterval = 0);
+
 protected:
     Node *nodeInterrest() const;
     void setNodeInterrest(Node *nodeInterrest);
@@ -65,6 +78,9 @@ private:
     friend class NodeOd;
 
     Node *_nodeInterrest;
+    QThread *_subscriberThread;  // thread where notifications are delivered
+    NotifyMode _notifyMode;
+    int _notifyInterval;         // ms, 0 for each event loop tick
     QSet<quint64> _indexSubIndexList;
     QList<NodeObjectId> _objIdList;
     void registerKey(const NodeObjectId &objId);
@@ -0,0 +1,192 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "nodeodtemplate.h"
+
+#include "indexdb.h"
+#include "model/devicedescription.h"
+#include "parser/edsparser.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWeakPointer>
+
+// Templates stay alive as long as one node uses them
+static QHash<QString, QWeakPointer<const NodeOdTemplate>> templateCache;
+static QMutex templateCacheMutex;
+
+NodeOdTemplate::NodeOdTemplate(const QString &fileName, const DeviceDescription *deviceDescription)
+    : _fileName(fileName),
+      _fileInfos(deviceDescription->fileInfos()),
+      _profileNumber(0)
+{
+    for (Index *odIndex : deviceDescription->indexes())
+    {
+        NodeIndex *nodeIndex = new NodeIndex(odIndex->index());
+        nodeIndex->setName(odIndex->name());
+        nodeIndex->setObjectType(static_cast<NodeIndex::ObjectType>(odIndex->objectType()));
+
+        for (SubIndex *odSubIndex : odIndex->subIndexes())
+        {
+            NodeSubIndex *nodeSubIndex = new NodeSubIndex(odSubIndex->subIndex());
+            nodeSubIndex->setDefaultValue(odSubIndex->value());
+            nodeSubIndex->setName(odSubIndex->name());
+            nodeSubIndex->setAccessType(static_cast<NodeSubIndex::AccessType>(odSubIndex->accessType()));
+            nodeSubIndex->setDataType(static_cast<NodeSubIndex::DataType>(odSubIndex->dataType()));
+            nodeSubIndex->setLowLimit(odSubIndex->lowLimit());
+            nodeSubIndex->setHighLimit(odSubIndex->highLimit());
+            nodeIndex->addSubIndex(nodeSubIndex);
+
+            if (odSubIndex->hasNodeId())
+            {
+                _nodeIdObjects.insert((static_cast<quint32>(odIndex->index()) << 8) | odSubIndex->subIndex());
+            }
+        }
+        _indexes.append(nodeIndex);
+    }
+
+    for (NodeIndex *nodeIndex : qAsConst(_indexes))
+    {
+        if (nodeIndex->index() == 0x1000 && nodeIndex->subIndexExist(0))
+        {
+            _profileNumber = static_cast<quint16>(nodeIndex->subIndex(0)->defaultValue().toUInt() & 0x0000FFFFU);
+        }
+    }
+
+    for (NodeIndex *nodeIndex : qAsConst(_indexes))
+    {
+        for (NodeSubIndex *nodeSubIndex : nodeIndex->subIndexes())
+        {
+            NodeObjectId objectId(nodeIndex->index(), nodeSubIndex->subIndex());
+            nodeSubIndex->setQ1516(IndexDb::isQ1516(objectId, _profileNumber));
+            nodeSubIndex->setScale(IndexDb::scale(objectId, _profileNumber));
+            nodeSubIndex->setUnit(IndexDb::unit(objectId, _profileNumber));
+        }
+    }
+}
+
+NodeOdTemplate::~NodeOdTemplate()
+{
+    qDeleteAll(_indexes);
+}
+
+/**
+ * @brief returns the template of an EDS file, parsed only if no node uses
+ * the same file revision yet
+ * @param fileName EDS file path
+ * @return shared template, null if the file cannot be parsed
+ */
+QSharedPointer<const NodeOdTemplate> NodeOdTemplate::fromEds(const QString &fileName)
+{
+    QFileInfo fileInfo(fileName);
+    QString mfileName = fileInfo.canonicalFilePath();
+    if (mfileName.isEmpty())
+    {
+        return QSharedPointer<const NodeOdTemplate>();
+    }
+    QString key = mfileName + '@' + QString::number(fileInfo.lastModified().toMSecsSinceEpoch()) + ':' + QString::number(fileInfo.size());
+
+    QMutexLocker locker(&templateCacheMutex);
+    QSharedPointer<const NodeOdTemplate> odTemplate = templateCache.value(key).toStrongRef();
+    if (!odTemplate.isNull())
+    {
+        return odTemplate;
+    }
+
+    EdsParser parser;
+    DeviceDescription *deviceDescription = parser.parse(mfileName);
+    if (deviceDescription == nullptr)
+    {
+        return QSharedPointer<const NodeOdTemplate>();
+    }
+    odTemplate = QSharedPointer<const NodeOdTemplate>(new NodeOdTemplate(mfileName, deviceDescription));
+    delete deviceDescription;
+
+    // drop entries of released templates
+    QHash<QString, QWeakPointer<const NodeOdTemplate>>::iterator it = templateCache.begin();
+    while (it != templateCache.end())
+    {
+        if (it.value().isNull())
+        {
+            it = templateCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    templateCache.insert(key, odTemplate);
+
+    return odTemplate;
+}
+
+const QString &NodeOdTemplate::fileName() const
+{
+    return _fileName;
+}
+
+const QMap<QString, QString> &NodeOdTemplate::fileInfos() const
+{
+    return _fileInfos;
+}
+
+/**
+ * @brief profile number of the 0x1000 default value, used for q15.16, scale and unit
+ */
+quint16 NodeOdTemplate::profileNumber() const
+{
+    return _profileNumber;
+}
+
+const QList<NodeIndex *> &NodeOdTemplate::indexes() const
+{
+    return _indexes;
+}
+
+/**
+ * @brief $NODEID relative default value
+ * @param subIndex template sub-index
+ * @return true if the default value depends on the node id
+ */
+bool NodeOdTemplate::hasNodeId(const NodeSubIndex *subIndex) const
+{
+    return _nodeIdObjects.contains((static_cast<quint32>(subIndex->index()) << 8) | subIndex->subIndex());
+}
+
+/**
+ * @brief default value of a template sub-index for a node, $NODEID resolved
+ * the same way as DeviceConfiguration::fromDeviceDescription
+ */
+QVariant NodeOdTemplate::defaultValue(const NodeSubIndex *subIndex, quint8 nodeId) const
+{
+    if (!hasNodeId(subIndex))
+    {
+        return subIndex->defaultValue();
+    }
+
+    QString value = subIndex->defaultValue().toString();
+    uint8_t base = 10;
+    if (value.startsWith(QStringLiteral("0x")))
+    {
+        base = 16;
+    }
+    return value.toUInt(nullptr, base) + nodeId;
+}
@@ -0,0 +1,67 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NODEODTEMPLATE_H
+#define NODEODTEMPLATE_H
+
+#include "canopen_global.h"
+
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QSharedPointer>
+
+#include "nodeindex.h"
+
+class DeviceDescription;
+
+/**
+ * @brief Immutable object dictionary built once per EDS file revision
+ *
+ * Nodes loaded from the same EDS share the metadata of the template objects,
+ * only values, errors and modification dates stay per node.
+ */
+class CANOPEN_EXPORT NodeOdTemplate
+{
+public:
+    ~NodeOdTemplate();
+
+    static QSharedPointer<const NodeOdTemplate> fromEds(const QString &fileName);
+
+    const QString &fileName() const;
+    const QMap<QString, QString> &fileInfos() const;
+    quint16 profileNumber() const;
+
+    const QList<NodeIndex *> &indexes() const;
+
+    bool hasNodeId(const NodeSubIndex *subIndex) const;
+    QVariant defaultValue(const NodeSubIndex *subIndex, quint8 nodeId) const;
+
+private:
+    NodeOdTemplate(const QString &fileName, const DeviceDescription *deviceDescription);
+    Q_DISABLE_COPY(NodeOdTemplate)
+
+    QString _fileName;
+    QMap<QString, QString> _fileInfos;
+    quint16 _profileNumber;
+
+    QList<NodeIndex *> _indexes;
+    QSet<quint32> _nodeIdObjects;  // index << 8 | subIndex of $NODEID relative defaults
+};
+
+#endif  // NODEODTEMPLATE_H
@@ -0,0 +1,395 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "nodeodvalues.h"
+
+#include "nodesubindex.h"
+
+#include <cstring>
+#include <limits>
+
+const qint64 NodeOdValues::INVALID_STAMP = std::numeric_limits<qint64>::min();
+
+NodeOdValues::NodeOdValues()
+{
+    _count = 0;
+    _compactedWaste = 0;
+}
+
+static NodeOdValues *createEmptyValues()
+{
+    NodeOdValues *values = new NodeOdValues();
+    values->allocate();
+    return values;
+}
+
+/**
+ * @brief shared store, slot 0 is always cleared, created once in a thread safe way
+ */
+NodeOdValues *NodeOdValues::empty()
+{
+    static NodeOdValues *values = createEmptyValues();
+    return values;
+}
+
+/**
+ * @brief slot of a sub-index, two table accesses without search
+ * @return slot number, -1 if the sub-index does not exist
+ */
+int NodeOdValues::slot(quint16 index, quint8 subIndex) const
+{
+    if (_pages.isEmpty())
+    {
+        return -1;
+    }
+    int page = _pages.at(index >> 8);
+    if (page < 0)
+    {
+        return -1;
+    }
+
+    const IndexRange &range = _ranges.at(page + (index & 0xFF));
+    if (subIndex >= range.count)
+    {
+        return -1;
+    }
+    int slot = range.first + subIndex;
+    if (_views.at(slot) == nullptr)
+    {
+        return -1;
+    }
+    return slot;
+}
+
+NodeSubIndex *NodeOdValues::view(int slot) const
+{
+    return _views.at(slot);
+}
+
+/**
+ * @brief number of sub-indexes attached
+ */
+int NodeOdValues::count() const
+{
+    return _count;
+}
+
+/**
+ * @brief allocates a slot outside of the index table, for a sub-index not attached to a node
+ */
+int NodeOdValues::allocate()
+{
+    int slot = _slots.count();
+    resizeSlots(slot + 1);
+    return slot;
+}
+
+/**
+ * @brief binds view to the slot of (index, subIndex), replaces the previous view of this slot
+ *
+ * The slots of an index are grown in place if it is the last one of the array, otherwise they are
+ * moved at the end and the views of the moved slots are updated.
+ * @return slot number
+ */
+int NodeOdValues::attach(quint16 index, quint8 subIndex, NodeSubIndex *view)
+{
+    // slots released or left behind by moved indexes are reclaimed once they are worth it
+    int waste = _slots.count() - _count - _compactedWaste;
+    if (waste > qMax(_count / 2, static_cast<int>(COMPACT_MIN_WASTE)))
+    {
+        compact();
+    }
+
+    IndexRange &range = this->range(index);
+    if (subIndex >= range.count)
+    {
+        int count = subIndex + 1;
+        int size = _slots.count();
+        if (range.count > 0 && range.first + range.count == size)
+        {
+            resizeSlots(range.first + count);
+        }
+        else
+        {
+            resizeSlots(size + count);
+            for (int i = 0; i < range.count; i++)
+            {
+                moveSlot(range.first + i, size + i);
+            }
+            range.first = size;
+        }
+        range.count = count;
+    }
+
+    int slot = range.first + subIndex;
+    if (_views.at(slot) == nullptr)
+    {
+        _count++;
+    }
+    _views[slot] = view;
+    return slot;
+}
+
+/**
+ * @brief frees a slot, the sub-index is not found anymore
+ */
+void NodeOdValues::release(int slot)
+{
+    if (_views.at(slot) != nullptr)
+    {
+        _views[slot] = nullptr;
+        _count--;
+    }
+    if (_slots.at(slot).variant)
+    {
+        _variants.remove(slot);
+    }
+    clearSlot(slot);
+}
+
+/**
+ * @brief copies value, error and modification date of otherSlot in other to slot
+ */
+void NodeOdValues::copySlot(int slot, const NodeOdValues &other, int otherSlot)
+{
+    const Slot &source = other._slots.at(otherSlot);
+    if (source.variant)
+    {
+        _variants.insert(slot, other._variants.value(otherSlot));
+    }
+    else if (_slots.at(slot).variant)
+    {
+        _variants.remove(slot);
+    }
+    _slots[slot] = source;
+}
+
+QVariant NodeOdValues::value(int slot) const
+{
+    const Slot &valueSlot = _slots.at(slot);
+    if (valueSlot.variant)
+    {
+        return _variants.value(slot);
+    }
+    if (valueSlot.type == QMetaType::UnknownType)
+    {
+        return QVariant();
+    }
+    return QVariant(valueSlot.type, &valueSlot.data);
+}
+
+/**
+ * @brief stores value, inline if numeric, in the side table otherwise
+ */
+void NodeOdValues::setValue(int slot, const QVariant &value)
+{
+    Slot &valueSlot = _slots[slot];
+    int type = value.userType();
+    if (isInlineType(type))
+    {
+        if (valueSlot.variant)
+        {
+            _variants.remove(slot);
+            valueSlot.variant = false;
+        }
+        valueSlot.data = 0;
+        memcpy(&valueSlot.data, value.constData(), static_cast<size_t>(QMetaType::sizeOf(type)));
+        valueSlot.type = static_cast<quint16>(type);
+    }
+    else if (!value.isValid())
+    {
+        if (valueSlot.variant)
+        {
+            _variants.remove(slot);
+            valueSlot.variant = false;
+        }
+        valueSlot.type = QMetaType::UnknownType;
+    }
+    else
+    {
+        _variants.insert(slot, value);
+        valueSlot.variant = true;
+        valueSlot.type = QMetaType::UnknownType;
+    }
+}
+
+quint32 NodeOdValues::error(int slot) const
+{
+    return _slots.at(slot).error;
+}
+
+void NodeOdValues::setError(int slot, quint32 error)
+{
+    _slots[slot].error = error;
+}
+
+QDateTime NodeOdValues::lastModification(int slot) const
+{
+    qint64 stamp = _slots.at(slot).stamp;
+    if (stamp == INVALID_STAMP)
+    {
+        return QDateTime();
+    }
+    return QDateTime::fromMSecsSinceEpoch(stamp);
+}
+
+void NodeOdValues::setLastModification(int slot, const QDateTime &modificationDate)
+{
+    _slots[slot].stamp = modificationDate.isValid() ? modificationDate.toMSecsSinceEpoch() : INVALID_STAMP;
+}
+
+NodeOdValues::IndexRange &NodeOdValues::range(quint16 index)
+{
+    if (_pages.isEmpty())
+    {
+        _pages.fill(-1, 0x100);
+    }
+
+    int page = _pages.at(index >> 8);
+    if (page < 0)
+    {
+        page = _ranges.count();
+        _ranges.resize(page + 0x100);
+        for (int i = page; i < _ranges.count(); i++)
+        {
+            _ranges[i].first = 0;
+            _ranges[i].count = 0;
+        }
+        _pages[index >> 8] = page;
+    }
+    return _ranges[page + (index & 0xFF)];
+}
+
+void NodeOdValues::resizeSlots(int size)
+{
+    int previousSize = _slots.count();
+    _slots.resize(size);
+    _views.resize(size);
+    for (int slot = previousSize; slot < size; slot++)
+    {
+        clearSlot(slot);
+        _views[slot] = nullptr;
+    }
+}
+
+void NodeOdValues::clearSlot(int slot)
+{
+    Slot &valueSlot = _slots[slot];
+    valueSlot.data = 0;
+    valueSlot.stamp = INVALID_STAMP;
+    valueSlot.error = 0;
+    valueSlot.type = QMetaType::UnknownType;
+    valueSlot.variant = false;
+}
+
+void NodeOdValues::moveSlot(int from, int to)
+{
+    _slots[to] = _slots.at(from);
+    if (_slots.at(from).variant)
+    {
+        _variants.insert(to, _variants.take(from));
+    }
+    clearSlot(from);
+
+    NodeSubIndex *view = _views.at(from);
+    _views[to] = view;
+    _views[from] = nullptr;
+    if (view != nullptr)
+    {
+        view->_slot = to;
+    }
+}
+
+/**
+ * @brief packs the ranges of all indexes at the start of the array, the released sub-indexes at
+ * the end of a range are removed from it, the views of the moved slots are updated
+ */
+void NodeOdValues::compact()
+{
+    QVector<Slot> slots;
+    QVector<NodeSubIndex *> views;
+    QHash<int, QVariant> variants;
+    slots.reserve(_count);
+    views.reserve(_count);
+
+    for (int page : qAsConst(_pages))
+    {
+        if (page < 0)
+        {
+            continue;
+        }
+        for (int i = page; i < page + 0x100; i++)
+        {
+            IndexRange &range = _ranges[i];
+            int count = range.count;
+            while (count > 0 && _views.at(range.first + count - 1) == nullptr)
+            {
+                count--;
+            }
+
+            int first = slots.count();
+            for (int subIndex = 0; subIndex < count; subIndex++)
+            {
+                int from = range.first + subIndex;
+                int to = first + subIndex;
+                slots.append(_slots.at(from));
+                views.append(_views.at(from));
+                if (_slots.at(from).variant)
+                {
+                    variants.insert(to, _variants.value(from));
+                }
+                if (_views.at(from) != nullptr)
+                {
+                    _views.at(from)->_slot = to;
+                }
+            }
+            range.first = (count > 0) ? first : 0;
+            range.count = count;
+        }
+    }
+
+    _slots.swap(slots);
+    _views.swap(views);
+    _variants.swap(variants);
+    _compactedWaste = _slots.count() - _count;
+}
+
+bool NodeOdValues::isInlineType(int type)
+{
+    switch (type)
+    {
+        case QMetaType::Bool:
+        case QMetaType::Char:
+        case QMetaType::SChar:
+        case QMetaType::UChar:
+        case QMetaType::Short:
+        case QMetaType::UShort:
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::Long:
+        case QMetaType::ULong:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Float:
+        case QMetaType::Double:
+            return true;
+
+        default:
+            return false;
+    }
+}
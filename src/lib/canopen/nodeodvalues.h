@@ -0,0 +1,103 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NODEODVALUES_H
+#define NODEODVALUES_H
+
+#include "canopen_global.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QVariant>
+#include <QVector>
+
+class NodeSubIndex;
+
+/**
+ * @brief Packed value storage of an object dictionary, with a direct (index, sub-index) lookup
+ *
+ * Values, errors and modification stamps live in one array of fixed size slots. Numeric values
+ * are stored inline with their QMetaType type, strings and domains in a side table. The
+ * sub-indexes of an index use consecutive slots (first slot + sub-index), the first slot is found
+ * through a two level table on the high and low bytes of the index. NodeSubIndex objects are
+ * views on their slot.
+ */
+class CANOPEN_EXPORT NodeOdValues
+{
+public:
+    NodeOdValues();
+
+    // store of one cleared slot shared by the detached sub-indexes without value, never written
+    static NodeOdValues *empty();
+
+    // lookup
+    int slot(quint16 index, quint8 subIndex) const;
+    NodeSubIndex *view(int slot) const;
+    int count() const;
+
+    // slots, allocate() is only for stores without index table
+    int allocate();
+    int attach(quint16 index, quint8 subIndex, NodeSubIndex *view);
+    void release(int slot);
+    void copySlot(int slot, const NodeOdValues &other, int otherSlot);
+
+    QVariant value(int slot) const;
+    void setValue(int slot, const QVariant &value);
+    quint32 error(int slot) const;
+    void setError(int slot, quint32 error);
+    QDateTime lastModification(int slot) const;
+    void setLastModification(int slot, const QDateTime &modificationDate);
+
+private:
+    struct Slot
+    {
+        quint64 data;  // inline numeric value, raw bytes of type
+        qint64 stamp;  // last modification in ms since epoch, INVALID_STAMP if not set
+        quint32 error;
+        quint16 type;  // QMetaType::Type of an inline value, UnknownType otherwise
+        bool variant;  // value stored in _variants
+    };
+    QVector<Slot> _slots;
+    QVector<NodeSubIndex *> _views;  // nullptr for free slots
+    QHash<int, QVariant> _variants;
+    int _count;
+    int _compactedWaste;  // unused slots left by the last compaction, holes of sparse indexes
+
+    struct IndexRange
+    {
+        int first;
+        int count;
+    };
+    QVector<int> _pages;          // index >> 8 to the first range of the page in _ranges, -1 if none
+    QVector<IndexRange> _ranges;  // 256 ranges per page
+    IndexRange &range(quint16 index);
+    void resizeSlots(int size);
+    void clearSlot(int slot);
+    void moveSlot(int from, int to);
+    void compact();
+
+    enum
+    {
+        COMPACT_MIN_WASTE = 256  // unused slots reclaimable before a compaction is worth it
+    };
+
+    static const qint64 INVALID_STAMP;
+    static bool isInlineType(int type);
+};
+
+#endif  // NODEODVALUES_H
@@ -20,39 +20,74 @@
 
 #include "nodeindex.h"
 #include "nodeod.h"
+#include "nodeodvalues.h"
+
+/**
+ * @brief Object metadata, identical for every node loaded from the same EDS
+ */
+class NodeSubIndexMetaData : public QSharedData
+{
+public:
+    NodeSubIndexMetaData()
+        : accessType(NodeSubIndex::NOACESS),
+          dataType(NodeSubIndex::NONE),
+          q1516(false),
+          scale(1.0),
+          coalescedWrites(false)
+    {
+    }
+
+    QString name;
+    NodeSubIndex::AccessType accessType;
+    NodeSubIndex::DataType dataType;
+
+    QVariant defaultValue;
+    QVariant lowLimit;
+    QVariant highLimit;
+
+    // TODO add enum for interpretation
+    bool q1516;
+    double scale;
+    QString unit;
+
+    // queued SDO writes can be merged, only for setpoints without side effects
+    bool coalescedWrites;
+};
+
+// QVariant operator== converts types, a setter must detach on a type change too
+static bool sameVariant(const QVariant &a, const QVariant &b)
+{
+    return a.userType() == b.userType() && a == b;
+}
 
 NodeSubIndex::NodeSubIndex(quint8 subIndex)
+    : _meta(new NodeSubIndexMetaData())
 {
     _nodeIndex = nullptr;
 
     _subIndex = subIndex;
-    _accessType = NOACESS;
-    _dataType = NONE;
 
-    _error = 0;
-    _q1516 = false;
-    _scale = 1.0;
+    _attached = false;
+    _values = NodeOdValues::empty();
+    _slot = 0;
 }
 
 NodeSubIndex::NodeSubIndex(const NodeSubIndex &other)
+    : _meta(other._meta)
 {
     _nodeIndex = nullptr;
 
     _subIndex = other.subIndex();
-    _name = other.name();
-    _accessType = other.accessType();
-
-    _value = other._value;
-    _defaultValue = other._defaultValue;
-    _dataType = other._dataType;
-
-    _lowLimit = other._lowLimit;
-    _highLimit = other._highLimit;
 
-    _lastModification = other._lastModification;
-
-    _error = 0;
-    _q1516 = false;
+    _attached = false;
+    _values = NodeOdValues::empty();
+    _slot = 0;
+    if (other._values != NodeOdValues::empty())
+    {
+        ownValues();
+        _values->copySlot(_slot, *other._values, other._slot);
+        _values->setError(_slot, 0);
+    }
 }
 
 /**
@@ -60,6 +95,14 @@ NodeSubIndex::NodeSubIndex(const NodeSubIndex &other)
  */
 NodeSubIndex::~NodeSubIndex()
 {
+    if (_attached)
+    {
+        _values->release(_slot);
+    }
+    else if (_values != NodeOdValues::empty())
+    {
+        delete _values;
+    }
 }
 
 quint8 NodeSubIndex::busId() const
@@ -127,7 +170,7 @@ uint8_t NodeSubIndex::subIndex() const
 }
 
 /**
- * @brief sub-index number setter
+ * @brief sub-index number setter, only for a sub-index not yet added to a node
  * @param 8 bits sub-index number
  */
 void NodeSubIndex::setSubIndex(uint8_t subIndex)
@@ -141,7 +184,7 @@ void NodeSubIndex::setSubIndex(uint8_t subIndex)
  */
 const QString &NodeSubIndex::name() const
 {
-    return _name;
+    return _meta->name;
 }
 
 /**
@@ -150,7 +193,11 @@ const QString &NodeSubIndex::name() const
  */
 void NodeSubIndex::setName(const QString &name)
 {
-    _name = name;
+    if (_meta.constData()->name == name)
+    {
+        return;
+    }
+    _meta->name = name;
 }
 
 /**
@@ -161,15 +208,15 @@ QString NodeSubIndex::fullName() const
 {
     if (_nodeIndex == nullptr)
     {
-        return _name;
+        return _meta->name;
     }
 
-    if (_nodeIndex->name() == _name)
+    if (_nodeIndex->name() == _meta->name)
     {
-        return _name;
+        return _meta->name;
     }
 
-    return _nodeIndex->name() + '.' + _name;
+    return _nodeIndex->name() + '.' + _meta->name;
 }
 
 /**
@@ -178,7 +225,7 @@ QString NodeSubIndex::fullName() const
  */
 NodeSubIndex::AccessType NodeSubIndex::accessType() const
 {
-    return _accessType;
+    return _meta->accessType;
 }
 
 /**
@@ -187,7 +234,11 @@ NodeSubIndex::AccessType NodeSubIndex::accessType() const
  */
 void NodeSubIndex::setAccessType(AccessType accessType)
 {
-    _accessType = accessType;
+    if (_meta.constData()->accessType == accessType)
+    {
+        return;
+    }
+    _meta->accessType = accessType;
 }
 
 /**
@@ -196,7 +247,7 @@ void NodeSubIndex::setAccessType(AccessType accessType)
  */
 bool NodeSubIndex::isReadable() const
 {
-    return (_accessType & READ) != 0;
+    return (_meta->accessType & READ) != 0;
 }
 
 /**
@@ -205,7 +256,7 @@ bool NodeSubIndex::isReadable() const
  */
 bool NodeSubIndex::isWritable() const
 {
-    return (_accessType & WRITE) != 0;
+    return (_meta->accessType & WRITE) != 0;
 }
 
 /**
@@ -214,7 +265,7 @@ bool NodeSubIndex::isWritable() const
  */
 bool NodeSubIndex::hasTPDOAccess() const
 {
-    return (_accessType & TPDO) != 0;
+    return (_meta->accessType & TPDO) != 0;
 }
 
 /**
@@ -223,26 +274,26 @@ bool NodeSubIndex::hasTPDOAccess() const
  */
 bool NodeSubIndex::hasRPDOAccess() const
 {
-    return (_accessType & RPDO) != 0;
+    return (_meta->accessType & RPDO) != 0;
 }
 
 QString NodeSubIndex::accessString() const
 {
     QString acces;
 
-    if ((_accessType & READ) != 0)
+    if ((_meta->accessType & READ) != 0)
     {
         acces += QStringLiteral("R");
     }
-    if ((_accessType & WRITE) != 0)
+    if ((_meta->accessType & WRITE) != 0)
     {
         acces += QStringLiteral("W");
     }
-    if ((_accessType & TPDO) != 0)
+    if ((_meta->accessType & TPDO) != 0)
     {
         acces += QStringLiteral(" TPDO");
     }
-    if ((_accessType & RPDO) != 0)
+    if ((_meta->accessType & RPDO) != 0)
     {
         acces += QStringLiteral(" RPDO");
     }
@@ -251,22 +302,23 @@ QString NodeSubIndex::accessString() const
 }
 
 /**
- * @brief _value getter
+ * @brief value getter, built from the value slot
  * @return return sub-index value
  */
-const QVariant &NodeSubIndex::value() const
+QVariant NodeSubIndex::value() const
 {
-    return _value;
+    return _values->value(_slot);
 }
 
 /**
- * @brief _value setter
+ * @brief value setter
  * @param new sub-index value
  */
 void NodeSubIndex::setValue(const QVariant &value, const QDateTime &modificationDate)
 {
-    _value.setValue(value);
-    _lastModification = modificationDate;
+    ownValues();
+    _values->setValue(_slot, value);
+    _values->setLastModification(_slot, modificationDate);
 }
 
 /**
@@ -275,7 +327,7 @@ void NodeSubIndex::setValue(const QVariant &value, const QDateTime &modification
  */
 const QVariant &NodeSubIndex::defaultValue() const
 {
-    return _defaultValue;
+    return _meta->defaultValue;
 }
 
 /**
@@ -284,7 +336,11 @@ const QVariant &NodeSubIndex::defaultValue() const
  */
 void NodeSubIndex::setDefaultValue(const QVariant &value)
 {
-    _defaultValue.setValue(value);
+    if (sameVariant(_meta.constData()->defaultValue, value))
+    {
+        return;
+    }
+    _meta->defaultValue = value;
 }
 
 /**
@@ -293,8 +349,9 @@ void NodeSubIndex::setDefaultValue(const QVariant &value)
  */
 void NodeSubIndex::resetValue(const QDateTime &modificationDate)
 {
-    _value.setValue(_defaultValue);
-    _lastModification = modificationDate;
+    ownValues();
+    _values->setValue(_slot, _meta.constData()->defaultValue);
+    _values->setLastModification(_slot, modificationDate);
 }
 
 /**
@@ -303,7 +360,7 @@ void NodeSubIndex::resetValue(const QDateTime &modificationDate)
  */
 quint32 NodeSubIndex::error() const
 {
-    return _error;
+    return _values->error(_slot);
 }
 
 /**
@@ -312,7 +369,8 @@ quint32 NodeSubIndex::error() const
  */
 void NodeSubIndex::setError(quint32 error)
 {
-    _error = error;
+    ownValues();
+    _values->setError(_slot, error);
 }
 
 /**
@@ -321,7 +379,11 @@ void NodeSubIndex::setError(quint32 error)
  */
 void NodeSubIndex::clearError()
 {
-    _error = 0;
+    if (_values == NodeOdValues::empty())
+    {
+        return;
+    }
+    _values->setError(_slot, 0);
 }
 
 /**
@@ -330,7 +392,7 @@ void NodeSubIndex::clearError()
  */
 NodeSubIndex::DataType NodeSubIndex::dataType() const
 {
-    return _dataType;
+    return _meta->dataType;
 }
 
 /**
@@ -339,7 +401,11 @@ NodeSubIndex::DataType NodeSubIndex::dataType() const
  */
 void NodeSubIndex::setDataType(DataType dataType)
 {
-    _dataType = dataType;
+    if (_meta.constData()->dataType == dataType)
+    {
+        return;
+    }
+    _meta->dataType = dataType;
 }
 
 /**
@@ -409,7 +475,7 @@ QString NodeSubIndex::dataTypeStr(DataType dataType)
 
 bool NodeSubIndex::isNumeric() const
 {
-    switch (_dataType)
+    switch (_meta->dataType)
     {
         case INTEGER8:
         case INTEGER16:
@@ -438,7 +504,7 @@ bool NodeSubIndex::isNumeric() const
 
 QMetaType::Type NodeSubIndex::metaType() const
 {
-    return NodeOd::dataTypeCiaToQt(_dataType);
+    return NodeOd::dataTypeCiaToQt(_meta->dataType);
 }
 
 /**
@@ -447,7 +513,7 @@ QMetaType::Type NodeSubIndex::metaType() const
  */
 const QVariant &NodeSubIndex::lowLimit() const
 {
-    return _lowLimit;
+    return _meta->lowLimit;
 }
 
 /**
@@ -456,7 +522,11 @@ const QVariant &NodeSubIndex::lowLimit() const
  */
 void NodeSubIndex::setLowLimit(const QVariant &lowLimit)
 {
-    _lowLimit = lowLimit;
+    if (sameVariant(_meta.constData()->lowLimit, lowLimit))
+    {
+        return;
+    }
+    _meta->lowLimit = lowLimit;
 }
 
 /**
@@ -465,7 +535,7 @@ void NodeSubIndex::setLowLimit(const QVariant &lowLimit)
  */
 bool NodeSubIndex::hasLowLimit() const
 {
-    return _lowLimit.isValid();
+    return _meta->lowLimit.isValid();
 }
 
 /**
@@ -474,7 +544,7 @@ bool NodeSubIndex::hasLowLimit() const
  */
 const QVariant &NodeSubIndex::highLimit() const
 {
-    return _highLimit;
+    return _meta->highLimit;
 }
 
 /**
@@ -483,7 +553,11 @@ const QVariant &NodeSubIndex::highLimit() const
  */
 void NodeSubIndex::setHighLimit(const QVariant &highLimit)
 {
-    _highLimit = highLimit;
+    if (sameVariant(_meta.constData()->highLimit, highLimit))
+    {
+        return;
+    }
+    _meta->highLimit = highLimit;
 }
 
 /**
@@ -492,7 +566,7 @@ void NodeSubIndex::setHighLimit(const QVariant &highLimit)
  */
 bool NodeSubIndex::hasHighLimit() const
 {
-    return _highLimit.isValid();
+    return _meta->highLimit.isValid();
 }
 
 /**
@@ -501,7 +575,7 @@ bool NodeSubIndex::hasHighLimit() const
  */
 int NodeSubIndex::byteLength() const
 {
-    switch (_dataType)
+    switch (_meta->dataType)
     {
         case NodeSubIndex::NONE:
             break;
@@ -564,7 +638,7 @@ int NodeSubIndex::byteLength() const
 
 int NodeSubIndex::bitLength() const
 {
-    switch (_dataType)
+    switch (_meta->dataType)
     {
         case NodeSubIndex::NONE:
             break;
@@ -629,7 +703,7 @@ int NodeSubIndex::bitLength() const
 
 double NodeSubIndex::minType() const
 {
-    switch (_dataType)
+    switch (_meta->dataType)
     {
         case NodeSubIndex::INTEGER8:
             return -((int64_t)1 << 7);
@@ -678,7 +752,7 @@ double NodeSubIndex::minType() const
 
 double NodeSubIndex::maxType() const
 {
-    switch (_dataType)
+    switch (_meta->dataType)
     {
         case NodeSubIndex::INTEGER8:
             return ((int64_t)1 << 7) - 1;
@@ -741,35 +815,141 @@ double NodeSubIndex::maxType() const
 
 bool NodeSubIndex::isQ1516() const
 {
-    return _q1516;
+    return _meta->q1516;
 }
 
 void NodeSubIndex::setQ1516(bool q1516)
 {
-    _q1516 = q1516;
+    if (_meta.constData()->q1516 == q1516)
+    {
+        return;
+    }
+    _meta->q1516 = q1516;
 }
 
 double NodeSubIndex::scale() const
 {
-    return _scale;
+    return _meta->scale;
 }
 
 void NodeSubIndex::setScale(double scale)
 {
-    _scale = scale;
+    if (_meta.constData()->scale == scale)
+    {
+        return;
+    }
+    _meta->scale = scale;
 }
 
 QString NodeSubIndex::unit() const
 {
-    return _unit;
+    return _meta->unit;
 }
 
 void NodeSubIndex::setUnit(const QString &unit)
 {
-    _unit = unit;
+    if (_meta.constData()->unit == unit)
+    {
+        return;
+    }
+    _meta->unit = unit;
+}
+
+/**
+ * @brief Returns true if a queued SDO write of this object takes the value of a newer one instead of
+ * queuing both, false by default to keep every write in order
+ */
+bool NodeSubIndex::hasCoalescedWrites() const
+{
+    return _meta->coalescedWrites;
+}
+
+void NodeSubIndex::setCoalescedWrites(bool coalescedWrites)
+{
+    if (_meta.constData()->coalescedWrites == coalescedWrites)
+    {
+        return;
+    }
+    _meta->coalescedWrites = coalescedWrites;
+}
+
+QDateTime NodeSubIndex::lastModification() const
+{
+    return _values->lastModification(_slot);
+}
+
+/**
+ * @brief shares the metadata of prototype instead of copying it, the first
+ * metadata setter called on this sub-index will detach it
+ * @param prototype sub-index, usualy from an EDS template
+ */
+void NodeSubIndex::shareMetaData(const NodeSubIndex &prototype)
+{
+    _meta = prototype._meta;
+}
+
+/**
+ * @brief metadata sharing state
+ * @return true if both sub-indexes use the same metadata instance
+ */
+bool NodeSubIndex::sharesMetaData(const NodeSubIndex &other) const
+{
+    return _meta.constData() == other._meta.constData();
+}
+
+/**
+ * @brief moves the value to the slot of (index, sub-index) in the node values
+ */
+void NodeSubIndex::attach(NodeOdValues *values, quint16 index)
+{
+    if (_attached && _values == values && values->slot(index, _subIndex) == _slot)
+    {
+        return;
+    }
+
+    int slot = values->attach(index, _subIndex, this);  // may move the slot of this view
+    values->copySlot(slot, *_values, _slot);
+    if (_attached)
+    {
+        _values->release(_slot);
+    }
+    else if (_values != NodeOdValues::empty())
+    {
+        delete _values;
+    }
+    _values = values;
+    _slot = slot;
+    _attached = true;
+}
+
+/**
+ * @brief moves the value out of the node values, to a slot owned by this sub-index
+ */
+void NodeSubIndex::detach()
+{
+    if (!_attached)
+    {
+        return;
+    }
+
+    NodeOdValues *values = new NodeOdValues();
+    int slot = values->allocate();
+    values->copySlot(slot, *_values, _slot);
+    _values->release(_slot);
+    _values = values;
+    _slot = slot;
+    _attached = false;
 }
 
-const QDateTime &NodeSubIndex::lastModification() const
+/**
+ * @brief gives an own slot to a detached sub-index still using the shared empty store
+ */
+void NodeSubIndex::ownValues()
 {
-    return _lastModification;
+    if (_values != NodeOdValues::empty())
+    {
+        return;
+    }
+    _values = new NodeOdValues();
+    _slot = _values->allocate();
 }
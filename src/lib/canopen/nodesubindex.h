@@ -21,6 +21,7 @@
 
 #include "canopen_global.h"
 
+#include <QSharedDataPointer>
 #include <QTime>
 #include <QVariant>
 
@@ -29,12 +30,19 @@
 class Node;
 class NodeOd;
 class NodeIndex;
+class NodeOdValues;
+class NodeSubIndexMetaData;
 
+/**
+ * @brief Sub-index view, value, error and modification date live in the packed slots of the node
+ * object dictionary (NodeOdValues), metadata are shared between nodes
+ */
 class CANOPEN_EXPORT NodeSubIndex
 {
 public:
     NodeSubIndex(quint8 subIndex);
     NodeSubIndex(const NodeSubIndex &other);
+    NodeSubIndex &operator=(const NodeSubIndex &other) = delete;
     ~NodeSubIndex();
 
     quint8 busId() const;
@@ -69,7 +77,7 @@ public:
     bool hasRPDOAccess() const;
     QString accessString() const;
 
-    const QVariant &value() const;
+    QVariant value() const;
     void setValue(const QVariant &value, const QDateTime &modificationDate = QDateTime());
 
     const QVariant &defaultValue() const;
@@ -139,31 +147,35 @@ public:
     QString unit() const;
     void setUnit(const QString &unit);
 
-    const QDateTime &lastModification() const;
+    // SDO writes scheduling
+    bool hasCoalescedWrites() const;
+    void setCoalescedWrites(bool coalescedWrites);
+
+    QDateTime lastModification() const;
+
+    // Metadata sharing
+    void shareMetaData(const NodeSubIndex &prototype);
+    bool sharesMetaData(const NodeSubIndex &other) const;
 
 private:
     friend class NodeIndex;
+    friend class NodeOd;
+    friend class NodeOdValues;
     NodeIndex *_nodeIndex;
 
     quint8 _subIndex;
-    QString _name;
-    AccessType _accessType;
-
-    QVariant _value;
-    QVariant _defaultValue;
-    DataType _dataType;
-
-    quint32 _error;
-
-    QVariant _lowLimit;
-    QVariant _highLimit;
-
-    QDateTime _lastModification;
-
-    // TODO add enum for interpretation
-    bool _q1516;
-    double _scale;
-    QString _unit;
+    bool _attached;
+
+    // value slot, in the node values once attached, in an own store before or in the shared empty
+    // store until a value is set
+    NodeOdValues *_values;
+    int _slot;
+    void attach(NodeOdValues *values, quint16 index);
+    void detach();
+    void ownValues();
+
+    // name, types, limits and interpretation, copy-on-write shared between nodes
+    QSharedDataPointer<NodeSubIndexMetaData> _meta;
 };
 
 #endif  // NODESUBINDEX_H
@@ -47,8 +47,8 @@ void ModeCstca::setCwDefaultflag()
 
 void ModeCstca::readRealTimeObjects()
 {
-    _nodeProfile402->node()->readObject(_torqueDemandObjectId);
-    _nodeProfile402->node()->readObject(_torqueActualValueObjectId);
+    _nodeProfile402->node()->readObject(_torqueDemandObjectId, SDO::PriorityControl);
+    _nodeProfile402->node()->readObject(_torqueActualValueObjectId, SDO::PriorityControl);
 }
 
 void ModeCstca::readAllObjects()
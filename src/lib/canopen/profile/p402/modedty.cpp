@@ -102,7 +102,7 @@ void ModeDty::setCwDefaultflag()
 
 void ModeDty::readRealTimeObjects()
 {
-    _nodeProfile402->node()->readObject(_demandObjectId);
+    _nodeProfile402->node()->readObject(_demandObjectId, SDO::PriorityControl);
 }
 
 void ModeDty::readAllObjects()
@@ -152,8 +152,8 @@ void ModePc::odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
 
 void ModePc::readRealTimeObjects()
 {
-    _nodeProfile402->node()->readObject(_positionDemandValueObjectId);
-    _nodeProfile402->node()->readObject(_positionActualValueObjectId);
+    _nodeProfile402->node()->readObject(_positionDemandValueObjectId, SDO::PriorityControl);
+    _nodeProfile402->node()->readObject(_positionActualValueObjectId, SDO::PriorityControl);
 }
 
 void ModePc::readAllObjects()
@@ -106,8 +106,8 @@ void ModeTc::odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
 
 void ModeTc::readRealTimeObjects()
 {
-    _nodeProfile402->node()->readObject(_torqueDemandObjectId);
-    _nodeProfile402->node()->readObject(_torqueActualValueObjectId);
+    _nodeProfile402->node()->readObject(_torqueDemandObjectId, SDO::PriorityControl);
+    _nodeProfile402->node()->readObject(_torqueActualValueObjectId, SDO::PriorityControl);
 }
 
 void ModeTc::readAllObjects()
@@ -46,8 +46,8 @@ void ModeTq::setCwDefaultflag()
 
 void ModeTq::readRealTimeObjects()
 {
-    _nodeProfile402->node()->readObject(_torqueDemandObjectId);
-    _nodeProfile402->node()->readObject(_torqueActualValueObjectId);
+    _nodeProfile402->node()->readObject(_torqueDemandObjectId, SDO::PriorityControl);
+    _nodeProfile402->node()->readObject(_torqueActualValueObjectId, SDO::PriorityControl);
 }
 
 void ModeTq::readAllObjects()
@@ -228,8 +228,8 @@ void ModeVl::setCwDefaultflag()
 
 void ModeVl::readRealTimeObjects()
 {
-    _nodeProfile402->node()->readObject(_velocityDemandObjectId);
-    _nodeProfile402->node()->readObject(_velocityActualObjectId);
+    _nodeProfile402->node()->readObject(_velocityDemandObjectId, SDO::PriorityControl);
+    _nodeProfile402->node()->readObject(_velocityActualObjectId, SDO::PriorityControl);
 }
 
 void ModeVl::readAllObjects()
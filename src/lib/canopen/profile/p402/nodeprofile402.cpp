@@ -107,7 +107,8 @@ NodeProfile402::NodeProfile402(Node *node, quint8 axis)
 
     _nodeProfileState = State::NODEPROFILE_STOPED;
 
-    connect(&_nodeProfleTimer, &QTimer::timeout, this, &NodeProfile402::readRealTimeObjects);
+    _nodeProfleTimer = new QTimer(this);
+    connect(_nodeProfleTimer, &QTimer::timeout, this, &NodeProfile402::readRealTimeObjects);
 
     setNodeInterrest(node);
 
@@ -903,14 +904,14 @@ void NodeProfile402::readModeOfOperationDisplay()
 
 void NodeProfile402::start(int msec)
 {
-    _nodeProfleTimer.start(msec);
+    _nodeProfleTimer->start(msec);
     _nodeProfileState = State::NODEPROFILE_STARTED;
     emit stateChanged();
 }
 
 void NodeProfile402::stop()
 {
-    _nodeProfleTimer.stop();
+    _nodeProfleTimer->stop();
     _nodeProfileState = State::NODEPROFILE_STOPED;
     emit stateChanged();
 }
@@ -922,7 +923,7 @@ bool NodeProfile402::status() const
 
 void NodeProfile402::readRealTimeObjects() const
 {
-    _node->readObject(_statusWordObjectId);
+    _node->readObject(_statusWordObjectId, SDO::PriorityControl);
     if (_modeCurrent != OperationMode::NoMode)
     {
         _modes[_modeCurrent]->readRealTimeObjects();
@@ -967,6 +968,19 @@ void NodeProfile402::reset()
     _modes[CP]->setCwDefaultflag();
 }
 
+/**
+ * @brief Moves the modes with the profile, they are subscribers on their own
+ */
+void NodeProfile402::setSubscriberThread(QThread *thread)
+{
+    NodeProfile::setSubscriberThread(thread);
+    for (Mode *mode : qAsConst(_modes))
+    {
+        mode->moveToThread(thread);
+        mode->setSubscriberThread(thread);
+    }
+}
+
 void NodeProfile402::odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
 {
     if (objId == _modesOfOperationObjectId)
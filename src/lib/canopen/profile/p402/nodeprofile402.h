@@ -168,7 +168,7 @@ private:
 
     // STATE
     State _nodeProfileState;
-    QTimer _nodeProfleTimer;
+    QTimer *_nodeProfleTimer;
 
     enum StateState
     {
@@ -216,6 +216,7 @@ public:
 
 public:
     void odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags) override;
+    void setSubscriberThread(QThread *thread) override;
 };
 
 #endif  // NODEPROFILE402_H
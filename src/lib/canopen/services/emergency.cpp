@@ -20,9 +20,8 @@
 
 #include "node.h"
 
-#include <QDataStream>
 #include <QDebug>
-#include <QIODevice>
+#include <QtEndian>
 
 Emergency::Emergency(Node *node)
     : Service(node)
@@ -43,17 +42,17 @@ QString Emergency::type() const
 
 void Emergency::parseFrame(const QCanBusFrame &frame)
 {
-    uint16_t errorCode;
-    uint8_t errorClass;
+    uint16_t errorCode = 0;
+    uint8_t errorClass = 0;
     QByteArray errorDesc;
 
-    QByteArray payload = frame.payload();
-    QDataStream request(&payload, QIODevice::ReadOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-
-    request >> errorCode;
-    request >> errorClass;
-    errorDesc = payload.mid(3);
+    const uchar *payload = reinterpret_cast<const uchar *>(frame.payloadData());
+    if (frame.payloadSize() >= 3)
+    {
+        errorCode = qFromLittleEndian<quint16>(payload);
+        errorClass = payload[2];
+        errorDesc = QByteArray(frame.payloadData() + 3, frame.payloadSize() - 3);
+    }
     qDebug().noquote().nospace() << "Emergency from node " << _node->nodeId() << " code 0x" << QString::number(errorCode, 16).toUpper().rightJustified(4, '0')
                                  << " in class " << errorClass << errorDesc;
 
@@ -48,9 +48,9 @@ QString ErrorControl::type() const
 
 void ErrorControl::parseFrame(const QCanBusFrame &frame)
 {
-    if (frame.payload().size() == 1)
+    if (frame.payloadSize() == 1)
     {
-        if (static_cast<uint8_t>(frame.payload().at(0)) == 0x0)
+        if (static_cast<uint8_t>(frame.payloadData()[0]) == 0x0)
         {
             // BootUp
             _node->setStatus(Node::Status::INIT);
@@ -128,9 +128,9 @@ void ErrorControl::lifeGuardingEvent()
 
 void ErrorControl::manageErrorControl(const QCanBusFrame &frame)
 {
-    if (frame.payload().size() == 1)
+    if (frame.payloadSize() == 1)
     {
-        bool actualToggleBit = (frame.payload().at(0) >> 7) != 0;
+        bool actualToggleBit = (frame.payloadData()[0] >> 7) != 0;
         if (_oldToggleBit == actualToggleBit)
         {
             // ERROR TogleBit -> connection lost
@@ -138,7 +138,7 @@ void ErrorControl::manageErrorControl(const QCanBusFrame &frame)
         }
         _oldToggleBit = actualToggleBit;
 
-        switch (frame.payload().at(0) & 0x7F)
+        switch (frame.payloadData()[0] & 0x7F)
         {
             case 4:  // Stopped
                 _node->setStatus(Node::Status::STOPPED);
@@ -36,11 +36,15 @@ NodeDiscover::NodeDiscover(CanOpenBus *bus)
     }
 
     _exploreBusNodeId = 0;
-    connect(&_exploreBusTimer, &QTimer::timeout, this, &NodeDiscover::exploreBusNext);
+    _exploreBusTimer = new QTimer(this);
+    connect(_exploreBusTimer, &QTimer::timeout, this, &NodeDiscover::exploreBusNext);
 
-    _exploreNodeState = -1;
     _exploreNodeCurrentId = 0;
-    connect(&_exploreNodeTimer, &QTimer::timeout, this, &NodeDiscover::exploreNodeNext);
+    _exploreNodeTimer = new QTimer(this);
+    _exploreNodeTimer->setSingleShot(true);
+    connect(_exploreNodeTimer, &QTimer::timeout, this, &NodeDiscover::exploreNodeNext);
+    _exploreNodeWatcher = new QFutureWatcher<NodeObjectResult>(this);
+    connect(_exploreNodeWatcher, &QFutureWatcher<NodeObjectResult>::finished, this, &NodeDiscover::exploreNodeFinished);
 }
 
 NodeDiscover::~NodeDiscover()
@@ -61,9 +65,9 @@ void NodeDiscover::parseFrame(const QCanBusFrame &frame)
         {
             Node *node = new Node(nodeId);
 
-            if (frame.payload().size() == 1)
+            if (frame.payloadSize() == 1)
             {
-                switch (frame.payload().at(0) & 0x7F)
+                switch (frame.payloadData()[0] & 0x7F)
                 {
                     case 0:  // Bootup
                         node->setStatus(Node::Status::INIT);
@@ -104,18 +108,16 @@ void NodeDiscover::exploreBus()
         return;
     }
     _exploreBusNodeId = 1;
-    _exploreBusTimer.start(8);
+    _exploreBusTimer->start(8);
 }
 
 void NodeDiscover::exploreNode(quint8 nodeId)
 {
     _nodeIdToExplore.enqueue(nodeId);
 
-    if (_exploreNodeState == -1)
+    if (_exploreNodeCurrentId == 0 && !_exploreNodeTimer->isActive())
     {
-        _exploreNodeCurrentId = _nodeIdToExplore.dequeue();
-        _exploreNodeState = 0;
-        _exploreNodeTimer.start(20);
+        _exploreNodeTimer->start(20);
     }
 }
 
@@ -129,7 +131,7 @@ void NodeDiscover::exploreBusNext()
     if (_exploreBusNodeId > 127)
     {
         _exploreBusNodeId = 0;
-        _exploreBusTimer.stop();
+        _exploreBusTimer->stop();
         emit exploreFinished();
         return;
     }
@@ -144,51 +146,59 @@ void NodeDiscover::exploreBusNext()
 
 void NodeDiscover::exploreNodeNext()
 {
+    if (_nodeIdToExplore.isEmpty())
+    {
+        return;
+    }
+
+    _exploreNodeCurrentId = _nodeIdToExplore.dequeue();
+    Node *node = bus()->node(_exploreNodeCurrentId);
+    if (node == nullptr)
+    {
+        _exploreNodeCurrentId = 0;
+        _exploreNodeTimer->start(20);
+        return;
+    }
+
     QList<NodeObjectId> objectsId{{0x1000, 0x0}, {0x1018, 0x1}, {0x1018, 0x2}, {0x1018, 0x3}};
+    _exploreNodeWatcher->setFuture(node->readObjects(objectsId));
+}
+
+void NodeDiscover::exploreNodeFinished()
+{
+    const QList<NodeObjectResult> results = _exploreNodeWatcher->future().results();
+    bool done = (results.count() == 4);
+    for (const NodeObjectResult &result : results)
+    {
+        done = done && result.isDone();
+    }
 
     Node *node = bus()->node(_exploreNodeCurrentId);
-    if (_exploreNodeState >= objectsId.size()
-        && (node->nodeOd()->value(objectsId[_exploreNodeState - 1]).isValid() || node->nodeOd()->errorObject(objectsId[_exploreNodeState - 1]) != 0))
+    if (node != nullptr)
     {
-        // explore node finished
-        Node *node = bus()->node(_exploreNodeCurrentId);
-        QString file = OdDb::file(node->nodeOd()->value(0x1000).toUInt(),
-                                  node->nodeOd()->value(0x1018, 1).toUInt(),
-                                  node->nodeOd()->value(0x1018, 2).toUInt(),
-                                  node->nodeOd()->value(0x1018, 3).toUInt());
-
-        // load object eds
-        if (!file.isEmpty())
+        if (done)
         {
-            node->nodeOd()->loadEds(file);
-            node->reset();
-            NodeProfileFactory::profileFactory(node);
-        }
+            // explore node finished
+            QString file = OdDb::file(results[0].value().toUInt(), results[1].value().toUInt(), results[2].value().toUInt(), results[3].value().toUInt());
 
-        if (_nodeIdToExplore.isEmpty())
-        {
-            _exploreNodeState = -1;
-            _exploreNodeTimer.stop();
+            // load object eds
+            if (!file.isEmpty())
+            {
+                node->nodeOd()->loadEds(file);
+                node->reset();
+                NodeProfileFactory::profileFactory(node);
+            }
         }
         else
         {
-            _exploreNodeCurrentId = _nodeIdToExplore.dequeue();
-            _exploreNodeState = 0;
+            // explored again after the other nodes
+            _nodeIdToExplore.enqueue(_exploreNodeCurrentId);
         }
     }
-    else
+
+    _exploreNodeCurrentId = 0;
+    if (!_nodeIdToExplore.isEmpty())
     {
-        if ((_exploreNodeState >= 1
-             && (!node->nodeOd()->value(objectsId[_exploreNodeState - 1]).isValid() || node->nodeOd()->errorObject(objectsId[_exploreNodeState - 1]) != 0)))
-        {
-            _nodeIdToExplore.enqueue(_exploreNodeCurrentId);
-            _exploreNodeCurrentId = _nodeIdToExplore.dequeue();
-            _exploreNodeState = 0;
-        }
-        else
-        {
-            node->readObject(objectsId[_exploreNodeState]);
-            _exploreNodeState++;
-        }
+        _exploreNodeTimer->start(20);
     }
 }
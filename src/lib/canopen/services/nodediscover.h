@@ -23,6 +23,9 @@
 
 #include "service.h"
 
+#include "nodeobjectresult.h"
+
+#include <QFutureWatcher>
 #include <QQueue>
 #include <QTimer>
 
@@ -42,17 +45,18 @@ signals:
 protected slots:
     void exploreBusNext();
     void exploreNodeNext();
+    void exploreNodeFinished();
 
 protected:
     // explorer bus
     quint8 _exploreBusNodeId;
-    QTimer _exploreBusTimer;
+    QTimer *_exploreBusTimer;
 
     // explorer node
     QQueue<quint8> _nodeIdToExplore;
     quint8 _exploreNodeCurrentId;
-    QTimer _exploreNodeTimer;
-    int _exploreNodeState;
+    QTimer *_exploreNodeTimer;
+    QFutureWatcher<NodeObjectResult> *_exploreNodeWatcher;
 
     // Service interface
 public:
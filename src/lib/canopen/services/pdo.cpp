@@ -41,6 +41,7 @@ PDO::PDO(Node *node, quint8 number)
     _stateMapping = STATE_FREE;
 
     _objectIdFsm = 0;
+    _mappingPlanBitSize = 0;
 
     _waitingConf.transType = 0;
     _waitingConf.eventTimer = 0;
@@ -64,6 +65,8 @@ void PDO::reset()
     _stateMapping = STATE_FREE;
 
     _currentMappedObjectsId.clear();
+    _mappingPlan.clear();
+    _mappingPlanBitSize = 0;
     _objectToMap.clear();
     createListObjectMapped();
 }
@@ -432,6 +435,8 @@ bool PDO::createListObjectMapped()
         clearDataWaiting();
     }
     _currentMappedObjectsId.clear();
+    _mappingPlan.clear();
+    _mappingPlanBitSize = 0;
     NodeObjectId objectMapping(_objectMappingId, 0);
     quint8 numberEntries = static_cast<quint8>(_node->nodeOd()->value(objectMapping).toUInt());
 
@@ -442,11 +447,40 @@ bool PDO::createListObjectMapped()
         quint32 mapping = _node->nodeOd()->value(objectId).toUInt();
         quint8 subIndexMapping = (mapping & PDO_SUBINDEX_MASK) >> 8;
         quint16 indexMapping = mapping >> 16;
+        quint8 bitSize = mapping & PDO_DATASIZE_MASK;
 
         if (checkIndex(indexMapping))
         {
             NodeObjectId object(_node->busId(), _node->nodeId(), indexMapping, subIndexMapping, _node->nodeOd()->dataType(indexMapping, subIndexMapping));
             _currentMappedObjectsId.append(object);
+
+            MappingSlot slot;
+            slot.nodeSubIndex = _node->nodeOd()->subIndex(indexMapping, subIndexMapping);
+            slot.type = QMetaType::UnknownType;
+            slot.isSigned = false;
+            if (slot.nodeSubIndex != nullptr)
+            {
+                slot.type = mappingSlotType(slot.nodeSubIndex->dataType(), &slot.isSigned);
+                if (bitSize == 0)
+                {
+                    bitSize = static_cast<quint8>(slot.nodeSubIndex->bitLength());
+                }
+            }
+            if (slot.type == QMetaType::UnknownType)
+            {
+                slot.nodeSubIndex = nullptr;  // only skipped, like a dummy entry
+            }
+            if (bitSize == 0 || bitSize > 64 || _mappingPlanBitSize + bitSize > maxMappingBitSize())
+            {
+                setError(ERROR_EXCEED_PDO_LENGTH);
+                _mappingPlan.clear();
+                _mappingPlanBitSize = 0;
+                break;
+            }
+            slot.bitOffset = static_cast<quint8>(_mappingPlanBitSize);
+            slot.bitSize = bitSize;
+            _mappingPlan.append(slot);
+            _mappingPlanBitSize += bitSize;
         }
     }
 
@@ -455,6 +489,7 @@ bool PDO::createListObjectMapped()
         numberEntries = static_cast<quint8>(_currentMappedObjectsId.size());
         _node->nodeOd()->index(objectMapping.index())->subIndex(objectMapping.subIndex())->setValue(numberEntries);
     }
+    mappingPlanChanged();
     emit mappingChanged();
     return true;
 }
@@ -463,6 +498,58 @@ bool PDO::checkIndex(quint16 index)
 {
     return index != 0;
 }
+
+/**
+ * @brief QVariant type used to store a mapped object in the od
+ * Types without an exact Qt type (24, 40, 48 and 56 bits) use the next larger integer.
+ * @param dataType CiA type of the object
+ * @param isSigned set to true if the raw value has to be sign extended
+ * @return type, QMetaType::UnknownType if the object cannot be mapped
+ */
+QMetaType::Type PDO::mappingSlotType(NodeSubIndex::DataType dataType, bool *isSigned)
+{
+    *isSigned = false;
+    switch (dataType)
+    {
+        case NodeSubIndex::INTEGER8:
+        case NodeSubIndex::INTEGER16:
+        case NodeSubIndex::INTEGER32:
+        case NodeSubIndex::INTEGER64:
+            *isSigned = true;
+            return NodeOd::dataTypeCiaToQt(dataType);
+
+        case NodeSubIndex::INTEGER24:
+            *isSigned = true;
+            return QMetaType::Int;
+
+        case NodeSubIndex::INTEGER40:
+        case NodeSubIndex::INTEGER48:
+        case NodeSubIndex::INTEGER56:
+            *isSigned = true;
+            return QMetaType::LongLong;
+
+        case NodeSubIndex::UNSIGNED24:
+            return QMetaType::UInt;
+
+        case NodeSubIndex::UNSIGNED40:
+        case NodeSubIndex::UNSIGNED48:
+        case NodeSubIndex::UNSIGNED56:
+            return QMetaType::ULongLong;
+
+        case NodeSubIndex::BOOLEAN:
+        case NodeSubIndex::UNSIGNED8:
+        case NodeSubIndex::UNSIGNED16:
+        case NodeSubIndex::UNSIGNED32:
+        case NodeSubIndex::UNSIGNED64:
+        case NodeSubIndex::REAL32:
+        case NodeSubIndex::REAL64:
+            return NodeOd::dataTypeCiaToQt(dataType);
+
+        default:
+            break;
+    }
+    return QMetaType::UnknownType;
+}
 /**
  * @brief management response from device after processMapping
  */
@@ -604,6 +691,10 @@ void PDO::clearDataWaiting()
 {
 }
 
+void PDO::mappingPlanChanged()
+{
+}
+
 void PDO::odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
 {
     if ((objId.index() == _objectCommId) && (objId.subIndex() == 0x01))
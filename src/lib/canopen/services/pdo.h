@@ -132,6 +132,19 @@ protected:
     QList<NodeObjectId> _currentMappedObjectsId;
     QList<NodeObjectId> _objectToMap;
 
+    // mapping compiled when read, frames are decoded or encoded without od lookup
+    struct MappingSlot
+    {
+        NodeSubIndex *nodeSubIndex;  // target object, nullptr for dummy entries which are only skipped
+        QMetaType::Type type;        // type of the QVariant stored in the object
+        quint8 bitOffset;            // first bit in the frame, little endian bit order
+        quint8 bitSize;
+        bool isSigned;
+    };
+    QVector<MappingSlot> _mappingPlan;
+    int _mappingPlanBitSize;
+    static QMetaType::Type mappingSlotType(NodeSubIndex::DataType dataType, bool *isSigned);
+
     enum CommParam
     {
         PDO_COMM_NUMBER = 0x00,
@@ -161,6 +174,7 @@ private:
 
     bool checkIndex(quint16 index);
     virtual void clearDataWaiting();
+    virtual void mappingPlanChanged();
 
     // Service interface
 public:
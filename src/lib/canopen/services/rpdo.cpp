@@ -19,9 +19,10 @@
 #include "rpdo.h"
 
 #include "canopenbus.h"
-#include <QDataStream>
 #include <QDebug>
-#include <QIODevice>
+#include <QtEndian>
+
+#include <cstring>
 
 RPDO::RPDO(Node *node, quint8 number)
     : PDO(node, number)
@@ -40,6 +41,13 @@ RPDO::RPDO(Node *node, quint8 number)
                        {_node->busId(), _node->nodeId(), _objectCommId, PDO_COMM_TRANSMISSION_TYPE},
                        {_node->busId(), _node->nodeId(), _objectCommId, PDO_COMM_INHIBIT_TIME},
                        {_node->busId(), _node->nodeId(), _objectCommId, PDO_COMM_EVENT_TIMER}};
+
+    _encodedData = 0;
+    _inhibitTimer = new QTimer(this);
+    _inhibitTimer->setTimerType(Qt::PreciseTimer);
+    _inhibitTimer->setSingleShot(true);
+    connect(_inhibitTimer, &QTimer::timeout, this, &RPDO::sendInhibitedData);
+    connect(_node, &Node::statusChanged, this, &RPDO::updateNodeStatus);
 }
 
 QString RPDO::type() const
@@ -87,46 +95,61 @@ quint8 RPDO::transmissionType()
     return static_cast<quint8>(_node->nodeOd()->value(object).toUInt());
 }
 
+/**
+ * @brief Event-driven RPDOs are sent on each write, without waiting for the next SYNC
+ */
+bool RPDO::isEventDriven()
+{
+    return transmissionType() >= RPDO_EVENT_MS;
+}
+
 void RPDO::receiveSync()
 {
-    if ((_currentMappedObjectsId.isEmpty()) || (!isEnabled()))
+    if ((_mappingPlan.isEmpty()) || (!isEnabled()))
     {
         return;
     }
 
-    // Update data of object in NodeOd after a sync
-    for (const NodeObjectId &objectIterator : qAsConst(_currentMappedObjectsId))
+    // Update data of object in NodeOd after a sync, locked and notified like received PDOs
+    NodeOd *nodeOd = _node->nodeOd();
+    for (int slot = 0; slot < _slotValues.size(); slot++)
     {
-        if (_dataObjectCurrentMapped.contains(objectIterator.key()) && _node->nodeOd()->indexExist(objectIterator.index())
-            && _node->nodeOd()->subIndexExist(objectIterator.index(), objectIterator.subIndex()))
+        NodeSubIndex *nodeSubIndex = _mappingPlan.at(slot).nodeSubIndex;
+        if (_slotValues.at(slot).isValid() && nodeSubIndex != nullptr)
         {
-            _node->nodeOd()->index(objectIterator.index())->subIndex(objectIterator.subIndex())->setValue(_dataObjectCurrentMapped.value(objectIterator.key()));
+            nodeOd->updateObjectFromDevice(nodeSubIndex, _slotValues.at(slot), NodeOd::Pdo);
         }
     }
 }
 
 /**
- * @brief Save data of object before send
+ * @brief Save data of object before send, event-driven RPDOs are sent immediately or at the end of the inhibit time
  * @param index
  * @param subindex
  * @param data
  */
 void RPDO::write(const NodeObjectId &object, const QVariant &data)
 {
-    if ((_currentMappedObjectsId.isEmpty()) || (!isEnabled()))
+    if ((_mappingPlan.isEmpty()) || (!isEnabled()))
     {
         return;
     }
 
-    for (const NodeObjectId &objectIterator : qAsConst(_currentMappedObjectsId))
+    for (int slot = 0; slot < _slotValues.size(); slot++)
     {
-        if (objectIterator.index() == object.index() && objectIterator.subIndex() == object.subIndex())
+        const MappingSlot &mappingSlot = _mappingPlan.at(slot);
+        if (mappingSlot.nodeSubIndex == nullptr)
+        {
+            continue;
+        }
+        if (mappingSlot.nodeSubIndex->index() == object.index() && mappingSlot.nodeSubIndex->subIndex() == object.subIndex())
         {
-            if (_dataObjectCurrentMapped.contains(objectIterator.key()))
+            _slotValues[slot] = data;
+            encodeSlot(mappingSlot, data);
+            if (isEventDriven())
             {
-                _dataObjectCurrentMapped.remove(objectIterator.key());
+                sendEventData();
             }
-            _dataObjectCurrentMapped.insert(object.key(), data);
             return;
         }
     }
@@ -137,38 +160,55 @@ void RPDO::write(const NodeObjectId &object, const QVariant &data)
  */
 void RPDO::clearDataWaiting()
 {
-    _dataObjectCurrentMapped.clear();
+    _slotValues.fill(QVariant(), _mappingPlan.size());
+    _inhibitTimer->stop();
 }
 
 /**
- * @brief Prepares the data before the sync signal
+ * @brief Sends the data before the sync signal, the payload is already encoded. Event-driven RPDOs
+ * are only sent on writes, with their inhibit time
  */
 void RPDO::prepareAndSendData()
 {
-    if ((_currentMappedObjectsId.isEmpty()) || (!isEnabled()) || _node->status() != Node::STARTED)
+    if ((_mappingPlan.isEmpty()) || (!isEnabled()) || _node->status() != Node::STARTED || isEventDriven())
     {
         return;
     }
 
-    QDataStream request(&_rpdoDataToSendReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
+    sendData();
+}
 
-    for (const NodeObjectId &objectIterator : qAsConst(_currentMappedObjectsId))
+/**
+ * @brief Sends an event-driven RPDO, delayed until the end of the inhibit time if needed
+ */
+void RPDO::sendEventData()
+{
+    if (_inhibitTimer->isActive())
     {
-        quint8 size = static_cast<quint8>(QMetaType::sizeOf(objectIterator.dataType()));
-        if (size > 8)
-        {
-            setError(ERROR_EXCEED_PDO_LENGTH);
-        }
-        if (_dataObjectCurrentMapped.contains(objectIterator.key()))
-        {
-            convertQVariantToQDataStream(request, _dataObjectCurrentMapped.value(objectIterator.key()), _node->nodeOd()->dataType(objectIterator));
-        }
-        else
+        return;  // the last values are sent at the end of the inhibit time
+    }
+
+    qint64 inhibitTimeUs = qRound64(inhibitTimeMs() * 1000.0);
+    if (inhibitTimeUs > 0 && _lastTransmission.isValid())
+    {
+        qint64 elapsedUs = _lastTransmission.nsecsElapsed() / 1000;
+        if (elapsedUs < inhibitTimeUs)
         {
-            convertQVariantToQDataStream(request, _node->nodeOd()->value(objectIterator), _node->nodeOd()->dataType(objectIterator));
+            _inhibitTimer->start(static_cast<int>((inhibitTimeUs - elapsedUs + 999) / 1000));
+            return;
         }
     }
+
+    sendInhibitedData();
+}
+
+void RPDO::sendInhibitedData()
+{
+    if ((_mappingPlan.isEmpty()) || _node->status() != Node::STARTED)
+    {
+        return;
+    }
+
     sendData();
 }
 
@@ -182,72 +222,141 @@ bool RPDO::sendData()
         return false;
     }
 
+    char payload[8];
+    qToLittleEndian(_encodedData, payload);
+
     QCanBusFrame frame;
     frame.setFrameId(_cobId);
-    frame.setPayload(_rpdoDataToSendReqPayload);
+    frame.setPayload(payload, (_mappingPlanBitSize + 7) / 8);
+    _lastTransmission.start();
     return bus()->writeFrame(frame);
 }
 
 /**
- * @brief Convert QVariant To QDataStream
- * @param request -> value converted
- * @param data value to convert
- * @param data QMetaType
+ * @brief Encodes the value of one mapped object in the payload
+ * @param slot mapping of the object
+ * @param value
  */
-void RPDO::convertQVariantToQDataStream(QDataStream &request, const QVariant &data, QMetaType::Type type)
+void RPDO::encodeSlot(const MappingSlot &slot, const QVariant &value)
 {
-    switch (type)
+    quint64 raw = 0;
+    switch (slot.type)
     {
-        case QMetaType::Long:
-        case QMetaType::LongLong:
-        case QMetaType::Int:
-            request << data.value<int>();
-            break;
-
-        case QMetaType::ULong:
-        case QMetaType::ULongLong:
-        case QMetaType::UInt:
-            request << data.value<unsigned int>();
+        case QMetaType::Float:
+        {
+            float f = value.toFloat();
+            quint32 bits;
+            memcpy(&bits, &f, sizeof(bits));
+            raw = bits;
             break;
+        }
 
         case QMetaType::Double:
-            request << data.value<double>();
+        {
+            double d = value.toDouble();
+            memcpy(&raw, &d, sizeof(raw));
             break;
+        }
 
-        case QMetaType::Short:
-            request << data.value<short>();
+        case QMetaType::UnknownType:
             break;
 
-        case QMetaType::Char:
-            request << data.value<char>();
+        default:
+            if (slot.isSigned)
+            {
+                raw = static_cast<quint64>(value.toLongLong());
+            }
+            else
+            {
+                raw = value.toULongLong();
+            }
             break;
+    }
 
-        case QMetaType::UShort:
-            request << data.value<unsigned short>();
-            break;
+    quint64 mask = (slot.bitSize < 64) ? ((Q_UINT64_C(1) << slot.bitSize) - 1) : ~Q_UINT64_C(0);
+    _encodedData = (_encodedData & ~(mask << slot.bitOffset)) | ((raw & mask) << slot.bitOffset);
+}
 
-        case QMetaType::UChar:
-            request << data.value<unsigned char>();
-            break;
+/**
+ * @brief Encodes the whole payload from the od, values written and not yet sent are kept
+ */
+void RPDO::encodeFromOd()
+{
+    for (int slot = 0; slot < _mappingPlan.size(); slot++)
+    {
+        const MappingSlot &mappingSlot = _mappingPlan.at(slot);
+        if (_slotValues.at(slot).isValid())
+        {
+            encodeSlot(mappingSlot, _slotValues.at(slot));
+        }
+        else if (mappingSlot.nodeSubIndex != nullptr)
+        {
+            encodeSlot(mappingSlot, mappingSlot.nodeSubIndex->value());
+        }
+    }
+}
 
-        case QMetaType::Float:
-            request << data.value<float>();
-            break;
+/**
+ * @brief Encodes the whole payload from the od when the mapping is compiled
+ */
+void RPDO::mappingPlanChanged()
+{
+    for (const NodeObjectId &objId : qAsConst(_mappedObjects))
+    {
+        unRegisterObjId(objId);
+    }
+    _mappedObjects.clear();
 
-        case QMetaType::SChar:
-            request << data.value<signed char>();
-            break;
+    _encodedData = 0;
+    _slotValues.fill(QVariant(), _mappingPlan.size());
+    for (const MappingSlot &slot : qAsConst(_mappingPlan))
+    {
+        if (slot.nodeSubIndex != nullptr)
+        {
+            NodeObjectId objId(slot.nodeSubIndex->index(), slot.nodeSubIndex->subIndex());
+            if (objId.index() != _objectCommId && objId.index() != _objectMappingId && !_mappedObjects.contains(objId))
+            {
+                _mappedObjects.append(objId);
+                registerObjId(objId);
+            }
+        }
+    }
+    encodeFromOd();
+}
 
-        case QMetaType::QString:
-            request << data;
-            break;
+/**
+ * @brief The payload is refreshed from the od when the node starts, values may have been changed
+ * by SDO before
+ */
+void RPDO::updateNodeStatus(Node::Status status)
+{
+    if (status == Node::STARTED)
+    {
+        encodeFromOd();
+    }
+}
 
-        case QMetaType::QByteArray:
-            request << data;
-            break;
+void RPDO::odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags)
+{
+    PDO::odNotify(objId, flags);
 
-        default:
-            break;
+    // a mapped object read or written by SDO, the od value replaces the encoded one
+    if ((flags & (NodeOd::Read | NodeOd::Write)) == 0 || (flags & (NodeOd::Error | NodeOd::Pdo)) != 0)
+    {
+        return;
+    }
+    for (int slot = 0; slot < _mappingPlan.size(); slot++)
+    {
+        const MappingSlot &mappingSlot = _mappingPlan.at(slot);
+        if (mappingSlot.nodeSubIndex == nullptr)
+        {
+            continue;
+        }
+        if (mappingSlot.nodeSubIndex->index() == objId.index() && mappingSlot.nodeSubIndex->subIndex() == objId.subIndex())
+        {
+            _slotValues[slot] = QVariant();
+            encodeSlot(mappingSlot, mappingSlot.nodeSubIndex->value());
+        }
     }
 }
 
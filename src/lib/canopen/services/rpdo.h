@@ -23,10 +23,14 @@
 
 #include "pdo.h"
 
+#include "node.h"
 #include "nodeobjectid.h"
 #include "nodeod.h"
 #include "nodeodsubscriber.h"
 
+#include <QElapsedTimer>
+#include <QTimer>
+
 class CANOPEN_EXPORT RPDO : public PDO
 {
     Q_OBJECT
@@ -42,6 +46,7 @@ public:
     };
     bool setTransmissionType(quint8 type);
     quint8 transmissionType();
+    bool isEventDriven();
 
     void write(const NodeObjectId &object, const QVariant &data);
     void clearDataWaiting() override;
@@ -49,12 +54,20 @@ public:
 protected slots:
     void receiveSync();
     void prepareAndSendData();
+    void sendInhibitedData();
+    void updateNodeStatus(Node::Status status);
 
 private:
-    QMap<quint64, QVariant> _dataObjectCurrentMapped;
-    QByteArray _rpdoDataToSendReqPayload;
+    QVector<QVariant> _slotValues;  // values written, by mapping slot
+    quint64 _encodedData;           // payload kept encoded, only changed slots are encoded again
+    QTimer *_inhibitTimer;
+    QElapsedTimer _lastTransmission;
+    QList<NodeObjectId> _mappedObjects;  // registered to follow od changes of mapped objects
     bool sendData();
-    void convertQVariantToQDataStream(QDataStream &request, const QVariant &data, QMetaType::Type type);
+    void sendEventData();
+    void encodeSlot(const MappingSlot &slot, const QVariant &value);
+    void encodeFromOd();
+    void mappingPlanChanged() override;
 
     // Service interface
 public:
@@ -66,6 +79,10 @@ public:
 public:
     bool isTPDO() const override;
     bool isRPDO() const override;
+
+    // NodeOdSubscriber interface
+protected:
+    void odNotify(const NodeObjectId &objId, NodeOd::FlagsRequest flags) override;
 };
 
 #endif  // RPDO_H
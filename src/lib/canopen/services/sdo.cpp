@@ -19,11 +19,15 @@
 #include "sdo.h"
 
 #include "canopenbus.h"
+#include "sdoscheduler.h"
 
 #include <QDataStream>
 #include <QDebug>
 #include <QIODevice>
 #include <QThread>
+#include <QtEndian>
+
+#include <cstring>
 
 enum CCS : quint8  // CCS : Client Command Specifier from Client to Server
 {
@@ -95,14 +99,24 @@ enum FlagBlock : quint8
     BLOCK_SEQNO_MASK = 0x7F      // Max segment by sub-block
 };
 
+static const int SDO_REQUEST_POOL_SIZE = 32;  // finished requests kept by each channel for reuse
+
 SDO::SDO(Node *node)
+    : SDO(node, 0x600 + node->nodeId(), 0x580 + node->nodeId())
+{
+}
+
+/**
+ * @brief Additional client channel, connected to a server SDO of the node with the given COB-IDs
+ */
+SDO::SDO(Node *node, quint32 cobIdClientToServer, quint32 cobIdServerToClient)
     : Service(node)
 {
     _nodeId = node->nodeId();
-    _cobIdClientToServer = 0x600;
-    _cobIdServerToClient = 0x580;
-    _cobIds.append(_cobIdClientToServer + _nodeId);
-    _cobIds.append(_cobIdServerToClient + _nodeId);
+    _cobIdClientToServer = cobIdClientToServer;
+    _cobIdServerToClient = cobIdServerToClient;
+    _cobIds.append(_cobIdClientToServer);
+    _cobIds.append(_cobIdServerToClient);
 
     _timeoutTimer = new QTimer(this);
     connect(_timeoutTimer, &QTimer::timeout, this, &SDO::timeout);
@@ -112,16 +126,42 @@ SDO::SDO(Node *node)
 
     _status = SDO_STATE_FREE;
     _currentRequest = nullptr;
+    _scheduler = nullptr;
 
     _maxErrorAttempt = 3;
     _blockDownloadIntervalMs = 1;
     _timeoutMs = 1800;
+    _minTimeoutMs = 20;
+    _statisticsClock.start();
+    _initiatePending = false;
+    _retransmission = false;
+    _rttSampleValid = false;
+    resetRttStatistics();
 }
 
 SDO::~SDO()
 {
+    // out of the wait queue first, a slot released would otherwise be granted to this client
+    if (bus() != nullptr)
+    {
+        bus()->sdoScheduler()->removeSdo(this);
+    }
+    releaseSlot();
     delete _timeoutTimer;
-    qDeleteAll(_requestQueue);
+    for (const QQueue<RequestSdo *> &requestQueue : _requestQueues)
+    {
+        for (RequestSdo *request : requestQueue)
+        {
+            cancelRequest(request);
+        }
+        qDeleteAll(requestQueue);
+    }
+    if (_currentRequest != nullptr)
+    {
+        cancelRequest(_currentRequest);
+        delete _currentRequest;
+    }
+    qDeleteAll(_requestPool);
 }
 
 QString SDO::type() const
@@ -145,11 +185,11 @@ quint32 SDO::cobIdServerToClient() const
  */
 void SDO::parseFrame(const QCanBusFrame &frame)
 {
-    if (frame.frameId() == _cobIdClientToServer + _nodeId)
+    if (frame.frameId() == _cobIdClientToServer)
     {
         processingFrameFromClient(frame);
     }
-    else if (frame.frameId() == _cobIdServerToClient + _nodeId)
+    else if (frame.frameId() == _cobIdServerToClient)
     {
         processingFrameFromServer(frame);
     }
@@ -162,9 +202,28 @@ void SDO::parseFrame(const QCanBusFrame &frame)
 void SDO::reset()
 {
     _timeoutTimer->stop();
-    qDeleteAll(_requestQueue);
-    _requestQueue.clear();
+    _subBlockDownloadTimer->stop();
+    for (QQueue<RequestSdo *> &requestQueue : _requestQueues)
+    {
+        for (RequestSdo *request : requestQueue)
+        {
+            cancelRequest(request);
+            releaseRequest(request);
+        }
+        requestQueue.clear();
+    }
+    if (_currentRequest != nullptr)
+    {
+        cancelRequest(_currentRequest);
+    }
+    _pendingUploads.clear();
+    _pendingDownloads.clear();
     _status = SDO_STATE_FREE;
+    if (bus() != nullptr)
+    {
+        bus()->sdoScheduler()->removeSdo(this);
+    }
+    releaseSlot();
 }
 
 /**
@@ -187,7 +246,7 @@ void SDO::processingFrameFromServer(const QCanBusFrame &frame)
         return;
     }
 
-    if (frame.payload().size() != 8)
+    if (frame.payloadSize() != 8)
     {
         sendErrorSdoToDevice(SDOAbortCodes::CO_SDO_ABORT_CODE_GENERAL_ERROR);
         return;
@@ -198,9 +257,19 @@ void SDO::processingFrameFromServer(const QCanBusFrame &frame)
         return;
     }
 
-    quint8 scs = static_cast<quint8>(frame.payload().at(0) & SDO_CSS_MASK);
+    quint8 scs = static_cast<quint8>(frame.payloadData()[0] & SDO_CSS_MASK);
 
     _timeoutTimer->stop();
+    if (_rttTimer.isValid())
+    {
+        if (_rttSampleValid)
+        {
+            addRttSample(_rttTimer.nsecsElapsed() / 1000);
+        }
+        _rttTimer.invalidate();
+    }
+    _initiatePending = false;
+    _retransmission = false;
     switch (scs)
     {
         case SCS::SDO_SCS_SERVER_UPLOAD_INITIATE:
@@ -229,7 +298,7 @@ void SDO::processingFrameFromServer(const QCanBusFrame &frame)
 
         case SCS::SDO_SCS_CLIENT_ABORT:
         {
-            SDOAbortCodes error = static_cast<SDOAbortCodes>(arrangeDataUpload(frame.payload().mid(4, 4), QMetaType::Type::UInt).toUInt());
+            SDOAbortCodes error = static_cast<SDOAbortCodes>(qFromLittleEndian<quint32>(frame.payloadData() + 4));
             qDebug() << "ABORT received : Index :" << QString::number(indexFromFrame(frame), 16).toUpper()
                      << ", SubIndex :" << QString::number(subIndexFromFrame(frame), 16).toUpper() << ", abort :" << QString::number(error, 16).toUpper()
                      << sdoAbort(error);
@@ -244,7 +313,72 @@ void SDO::processingFrameFromServer(const QCanBusFrame &frame)
 
 bool SDO::hasRequestPending() const
 {
-    return (!_requestQueue.isEmpty());
+    for (const QQueue<RequestSdo *> &requestQueue : _requestQueues)
+    {
+        if (!requestQueue.isEmpty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Returns true if a request on the object is queued or running
+ */
+bool SDO::hasRequestOn(quint16 index, quint8 subindex) const
+{
+    quint32 key = (static_cast<quint32>(index) << 8) | subindex;
+    if (_pendingUploads.contains(key) || _pendingDownloads.contains(key))
+    {
+        return true;
+    }
+    return (_status == SDO_STATE_NOT_FREE && _currentRequest != nullptr && _currentRequest->index == index && _currentRequest->subIndex == subindex);
+}
+
+/**
+ * @brief Returns true if a download is queued or running, used to keep reads after writes
+ */
+bool SDO::hasDownloadPending() const
+{
+    if (!_pendingDownloads.isEmpty())
+    {
+        return true;
+    }
+    if (_status != SDO_STATE_NOT_FREE || _currentRequest == nullptr)
+    {
+        return false;
+    }
+    switch (_currentRequest->state)
+    {
+        case STATE_DOWNLOAD:
+        case STATE_DOWNLOAD_SEGMENT:
+        case STATE_BLOCK_DOWNLOAD:
+        case STATE_BLOCK_DOWNLOAD_END_SUB:
+        case STATE_BLOCK_DOWNLOAD_END:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Number of requests queued or running
+ */
+int SDO::load() const
+{
+    return queueDepth() + ((_status == SDO_STATE_NOT_FREE) ? 1 : 0);
+}
+
+int SDO::queueDepth() const
+{
+    return _pendingUploads.count() + _pendingDownloads.count();
+}
+
+int SDO::queueDepth(Priority priority) const
+{
+    return _requestQueues[priority].count();
 }
 
 qint32 SDO::currentRequestStay() const
@@ -343,26 +477,31 @@ QString SDO::sdoAbort(SDOAbortCodes error) const
  * @param data
  * @return 0->ok 1->nok
  */
-bool SDO::uploadData(quint16 index, quint8 subindex, QMetaType::Type dataType)
+bool SDO::uploadData(quint16 index, quint8 subindex, QMetaType::Type dataType, Priority priority, const QSharedPointer<SdoBatch> &batch, int slot)
 {
-    bool existing = false;
-    for (RequestSdo *req : qAsConst(_requestQueue))
+    quint32 key = (static_cast<quint32>(index) << 8) | subindex;
+    RequestSdo *pending = _pendingUploads.value(key, nullptr);
+    if (pending != nullptr)
     {
-        if (req->index == index && req->subIndex == subindex)
-        {
-            existing = true;
-        }
+        // already queued, only raised to a more urgent class
+        addWaiter(pending, batch, slot);
+        enqueueRequest(pending, priority);
     }
-
-    if (!existing)
+    else
     {
-        RequestSdo *request = new RequestSdo();
+        RequestSdo *request = allocRequest();
         request->index = index;
         request->subIndex = subindex;
         request->dataType = dataType;
         request->size = static_cast<quint32>(QMetaType::sizeOf(QMetaType::Type(dataType)));
         request->state = STATE_UPLOAD;
-        _requestQueue.enqueue(request);
+        request->download = false;
+        request->queuedUs = _statisticsClock.nsecsElapsed() / 1000;
+        request->priority = PriorityCount;
+        request->standalone = false;
+        addWaiter(request, batch, slot);
+        enqueueRequest(request, priority);
+        _pendingUploads.insert(key, request);
     }
 
     nextRequest();
@@ -376,30 +515,66 @@ bool SDO::uploadData(quint16 index, quint8 subindex, QMetaType::Type dataType)
  * @param data
  * @return 0->ok 1->nok
  */
-bool SDO::downloadData(quint16 index, quint8 subindex, const QVariant &data)
+bool SDO::downloadData(quint16 index, quint8 subindex, const QVariant &data, Priority priority, const QSharedPointer<SdoBatch> &batch, int slot)
 {
-    RequestSdo *request = new RequestSdo();
+    RequestSdo *request = allocRequest();
     request->index = index;
     request->subIndex = subindex;
 
     request->data = data;
     request->dataType = QMetaType::Type(data.type());
     request->state = STATE_DOWNLOAD;
+    request->download = true;
+    request->queuedUs = _statisticsClock.nsecsElapsed() / 1000;
 
-    if (request->dataType != QMetaType::Type::QByteArray)
+    if (request->dataType == QMetaType::Type::QByteArray)
     {
-        QDataStream req(&request->dataByte, QIODevice::WriteOnly);
-        req.setByteOrder(QDataStream::LittleEndian);
-        arrangeDataDownload(req, data);
+        request->dataByte = data.toByteArray();
+        request->size = static_cast<quint32>(request->dataByte.size());
+    }
+    else
+    {
+        int inlineSize = arrangeExpeditedDownload(request->inlineData, data);
+        if (inlineSize > 0)
+        {
+            request->inlineSize = static_cast<quint8>(inlineSize);
+        }
+        else
+        {
+            QDataStream req(&request->dataByte, QIODevice::WriteOnly);
+            req.setByteOrder(QDataStream::LittleEndian);
+            arrangeDataDownload(req, data);
+        }
         request->size = static_cast<quint32>(QMetaType::sizeOf(QMetaType::Type(data.type())));
     }
+
+    // a queued write only takes the new value if the object opted in and the write keeps its place
+    quint32 key = (static_cast<quint32>(index) << 8) | subindex;
+    RequestSdo *pending = nullptr;
+    if (hasCoalescedWrites(index, subindex))
+    {
+        pending = _pendingDownloads.value(key, nullptr);
+    }
+    if (pending != nullptr && priority >= pending->priority)
+    {
+        pending->data = request->data;
+        pending->dataType = request->dataType;
+        pending->dataByte = request->dataByte;
+        memcpy(pending->inlineData, request->inlineData, sizeof(request->inlineData));
+        pending->inlineSize = request->inlineSize;
+        pending->size = request->size;
+        releaseRequest(request);
+        addWaiter(pending, batch, slot);
+    }
     else
     {
-        request->dataByte = data.toByteArray();
-        request->size = static_cast<quint32>(request->dataByte.size());
+        request->priority = PriorityCount;
+        request->standalone = false;
+        addWaiter(request, batch, slot);
+        enqueueDownload(request, priority);
+        _pendingDownloads.insert(key, request);
     }
 
-    _requestQueue.enqueue(request);
     nextRequest();
     return true;
 }
@@ -441,12 +616,7 @@ bool SDO::uploadDispatcher()
  */
 quint16 SDO::indexFromFrame(const QCanBusFrame &frame)
 {
-    quint16 index = 0;
-    QByteArray sdoWriteReqPayload = frame.payload().mid(1, 2);
-    QDataStream request(&sdoWriteReqPayload, QIODevice::ReadOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request >> index;
-    return index;
+    return qFromLittleEndian<quint16>(frame.payloadData() + 1);
 }
 
 /**
@@ -456,7 +626,7 @@ quint16 SDO::indexFromFrame(const QCanBusFrame &frame)
  */
 quint8 SDO::subIndexFromFrame(const QCanBusFrame &frame)
 {
-    return static_cast<quint8>(frame.payload().at(3));
+    return static_cast<quint8>(frame.payloadData()[3]);
 }
 
 /**
@@ -466,8 +636,8 @@ quint8 SDO::subIndexFromFrame(const QCanBusFrame &frame)
  */
 bool SDO::sdoUploadInitiate(const QCanBusFrame &frame)
 {
-    quint8 transferType = (static_cast<quint8>(frame.payload().at(0) & Flag::SDO_E_MASK)) >> 1;
-    quint8 sizeIndicator = static_cast<quint8>(frame.payload().at(0) & Flag::SDO_S_SIZE_MASK);
+    quint8 transferType = (static_cast<quint8>(frame.payloadData()[0] & Flag::SDO_E_MASK)) >> 1;
+    quint8 sizeIndicator = static_cast<quint8>(frame.payloadData()[0] & Flag::SDO_S_SIZE_MASK);
     quint8 cmd = 0;
     quint16 index = indexFromFrame(frame);
     quint8 subindex = subIndexFromFrame(frame);
@@ -482,13 +652,17 @@ bool SDO::sdoUploadInitiate(const QCanBusFrame &frame)
     {
         if (sizeIndicator == 1)  // data set size is indicated
         {
-            _currentRequest->stay = (4 - (((frame.payload().at(0)) & SDO_N_NUMBER_INIT_MASK) >> 2));
-            _currentRequest->dataByte.append(frame.payload().mid(4, static_cast<quint8>(_currentRequest->stay)));
+            _currentRequest->stay = (4 - (((frame.payloadData()[0]) & SDO_N_NUMBER_INIT_MASK) >> 2));
         }
         else
         {
             // d contains unspecified number of bytes to be uploaded.
+            _currentRequest->stay = 4;
         }
+        // unused bytes are zeroed, the value is decoded in place by endRequest
+        memset(_currentRequest->inlineData, 0, sizeof(_currentRequest->inlineData));
+        memcpy(_currentRequest->inlineData, frame.payloadData() + 4, _currentRequest->stay);
+        _currentRequest->inlineSize = static_cast<quint8>(_currentRequest->stay);
         endRequest();
     }
     else if (transferType == Flag::SDO_E_NORMAL)
@@ -498,10 +672,7 @@ bool SDO::sdoUploadInitiate(const QCanBusFrame &frame)
             // NOT USED -> ERROR d is reserved for further use.
         }
 
-        QByteArray sdoWriteReqPayload = frame.payload().mid(4, 4);
-        QDataStream request(&sdoWriteReqPayload, QIODevice::ReadOnly);
-        request.setByteOrder(QDataStream::LittleEndian);
-        request >> _currentRequest->size;
+        _currentRequest->size = qFromLittleEndian<quint32>(frame.payloadData() + 4);
         _currentRequest->stay = _currentRequest->size;
 
         cmd = CCS::SDO_CCS_CLIENT_UPLOAD_SEGMENT;
@@ -531,7 +702,7 @@ bool SDO::sdoUploadSegment(const QCanBusFrame &frame)
 {
     quint8 cmd = 0;
     quint8 size = 0;
-    quint8 toggle = static_cast<quint8>((frame.payload().at(0) & SDO_TOGGLE_MASK));
+    quint8 toggle = static_cast<quint8>((frame.payloadData()[0] & SDO_TOGGLE_MASK));
 
     if (_currentRequest->state != STATE_UPLOAD_SEGMENT)
     {
@@ -546,12 +717,12 @@ bool SDO::sdoUploadSegment(const QCanBusFrame &frame)
         return false;
     }
 
-    size = (SDO_SG_SIZE - (((frame.payload().at(0)) & SDO_N_NUMBER_SEG_MASK) >> 1));
+    size = (SDO_SG_SIZE - (((frame.payloadData()[0]) & SDO_N_NUMBER_SEG_MASK) >> 1));
 
-    _currentRequest->dataByte.append(frame.payload().mid(1, size));
+    _currentRequest->dataByte.append(frame.payloadData() + 1, size);
     _currentRequest->stay -= size;
 
-    if ((frame.payload().at(0) & SDO_C_MORE_MASK) == SDO_C_MORE)  // no more segments to be uploaded
+    if ((frame.payloadData()[0] & SDO_C_MORE_MASK) == SDO_C_MORE)  // no more segments to be uploaded
     {
         _currentRequest->state = STATE_UPLOAD;
         endRequest();
@@ -580,7 +751,7 @@ bool SDO::sdoBlockUpload(const QCanBusFrame &frame)
     quint16 index = indexFromFrame(frame);
     quint8 subindex = subIndexFromFrame(frame);
 
-    quint8 ss = static_cast<quint8>(frame.payload().at(0) & SS::SDO_SCS_SERVER_BLOCK_UPLOAD_SS_END_RESP);
+    quint8 ss = static_cast<quint8>(frame.payloadData()[0] & SS::SDO_SCS_SERVER_BLOCK_UPLOAD_SS_END_RESP);
     if ((ss == SS::SDO_SCS_SERVER_BLOCK_UPLOAD_SS_INIT_RESP) && (_currentRequest->state == STATE_UPLOAD))
     {
         if ((index != _currentRequest->index) || (subindex != _currentRequest->subIndex))
@@ -588,9 +759,9 @@ bool SDO::sdoBlockUpload(const QCanBusFrame &frame)
             sendErrorSdoToDevice(CO_SDO_ABORT_CODE_CMD_NOT_VALID);
             return false;
         }
-        if (static_cast<quint8>(frame.payload().at(0) & BLOCK_SIZE) == BLOCK_SIZE)
+        if (static_cast<quint8>(frame.payloadData()[0] & BLOCK_SIZE) == BLOCK_SIZE)
         {
-            QByteArray sdoWriteReqPayload = frame.payload().mid(4, 4);
+            QByteArray sdoWriteReqPayload = QByteArray(frame.payloadData() + 4, 4);
             QDataStream request(&sdoWriteReqPayload, QIODevice::ReadOnly);
             request.setByteOrder(QDataStream::LittleEndian);
             request >> _currentRequest->size;
@@ -614,7 +785,7 @@ bool SDO::sdoBlockUpload(const QCanBusFrame &frame)
     }
     else if ((ss == SS::SDO_SCS_SERVER_BLOCK_UPLOAD_SS_END_RESP) && (_currentRequest->state == STATE_BLOCK_UPLOAD_END))
     {
-        quint8 n = (frame.payload().at(0) & BLOCK_N_NUMBER_MASK) >> 2;
+        quint8 n = (frame.payloadData()[0] & BLOCK_N_NUMBER_MASK) >> 2;
         if (n != _currentRequest->stay)
         {
             sendErrorSdoToDevice(CO_SDO_ABORT_CODE_INVALID_BLOCK_SIZE);
@@ -648,7 +819,7 @@ bool SDO::sdoBlockUploadSubBlock(const QCanBusFrame &frame)
     quint8 moreBlockSegments = 0;
     quint8 reveiveSeqno = 0;
 
-    reveiveSeqno = frame.payload().at(0) & BLOCK_SEQNO_MASK;
+    reveiveSeqno = frame.payloadData()[0] & BLOCK_SEQNO_MASK;
     if ((_currentRequest->seqno != reveiveSeqno) && (!_currentRequest->error))
     {
         // ERROR SEQUENCE NUMBER
@@ -660,10 +831,10 @@ bool SDO::sdoBlockUploadSubBlock(const QCanBusFrame &frame)
     else if (!_currentRequest->error)
     {
         _currentRequest->ackseq = _currentRequest->seqno;
-        _currentRequest->dataByteBySegment.append(frame.payload().mid(1, SDO_SG_SIZE));
+        _currentRequest->dataByteBySegment.append(frame.payloadData() + 1, SDO_SG_SIZE);
     }
 
-    moreBlockSegments = (frame.payload().at(0) & BLOCK_C_MORE_SEG);
+    moreBlockSegments = (frame.payloadData()[0] & BLOCK_C_MORE_SEG);
     if ((_currentRequest->seqno >= _currentRequest->blksize) || (moreBlockSegments == BLOCK_C_MORE_SEG))
     {
         if (!_currentRequest->error)
@@ -729,17 +900,23 @@ bool SDO::downloadDispatcher()
     {
         cmd = CCS::SDO_CCS_CLIENT_BLOCK_DOWNLOAD;
         cmd |= FlagBlock::BLOCK_SIZE;
+        cmd |= FlagBlock::BLOCK_CRC;
 
-        QByteArray size;
-        QDataStream req(&size, QIODevice::WriteOnly);
-        req.setByteOrder(QDataStream::LittleEndian);
-        arrangeDataDownload(req, QVariant(static_cast<quint32>(_currentRequest->size)));
+        if (_currentRequest->inlineSize > 0)
+        {
+            // block transfers work on dataByte
+            _currentRequest->dataByte = QByteArray(_currentRequest->inlineData, _currentRequest->inlineSize);
+            _currentRequest->inlineSize = 0;
+        }
 
-        sendSdoRequest(cmd, _currentRequest->index, _currentRequest->subIndex, size);
+        char size[4];
+        qToLittleEndian(_currentRequest->size, size);
+        sendSdoRequest(cmd, _currentRequest->index, _currentRequest->subIndex, size, 4);
 
         _currentRequest->seqno = 1;
         _currentRequest->stay = _currentRequest->size;
         _currentRequest->attemptCount = 0;
+        _currentRequest->crc = false;
     }
     else
     {
@@ -750,7 +927,14 @@ bool SDO::downloadDispatcher()
             cmd |= Flag::SDO_S_SIZE;
             cmd |= ((4 - _currentRequest->size) << 2) & SDO_N_NUMBER_INIT_MASK;
 
-            sendSdoRequest(cmd, _currentRequest->index, _currentRequest->subIndex, _currentRequest->dataByte);
+            if (_currentRequest->inlineSize > 0)
+            {
+                sendSdoRequest(cmd, _currentRequest->index, _currentRequest->subIndex, _currentRequest->inlineData, _currentRequest->inlineSize);
+            }
+            else
+            {
+                sendSdoRequest(cmd, _currentRequest->index, _currentRequest->subIndex, _currentRequest->dataByte.constData(), _currentRequest->dataByte.size());
+            }
             _currentRequest->state = STATE_DOWNLOAD;
         }
         else  // normal transfer
@@ -758,12 +942,9 @@ bool SDO::downloadDispatcher()
             cmd = CCS::SDO_CCS_CLIENT_DOWNLOAD_INITIATE;
             cmd |= Flag::SDO_S_SIZE;
 
-            QByteArray size;
-            QDataStream req(&size, QIODevice::WriteOnly);
-            req.setByteOrder(QDataStream::LittleEndian);
-            arrangeDataDownload(req, QVariant(static_cast<quint32>(_currentRequest->size)));
-
-            sendSdoRequest(cmd, _currentRequest->index, _currentRequest->subIndex, size);
+            char size[4];
+            qToLittleEndian(_currentRequest->size, size);
+            sendSdoRequest(cmd, _currentRequest->index, _currentRequest->subIndex, size, 4);
             _currentRequest->stay = _currentRequest->size;
             _currentRequest->state = STATE_DOWNLOAD_SEGMENT;
         }
@@ -846,7 +1027,7 @@ bool SDO::sdoDownloadSegment(const QCanBusFrame &frame)
         return false;
     }
 
-    toggle = static_cast<quint8>((frame.payload().at(0) & SDO_TOGGLE_MASK));
+    toggle = static_cast<quint8>((frame.payloadData()[0] & SDO_TOGGLE_MASK));
     if (toggle != _currentRequest->toggle)
     {
         sendErrorSdoToDevice(CO_SDO_ABORT_CODE_BIT_NOT_ALTERNATED);
@@ -888,7 +1069,7 @@ bool SDO::sdoBlockDownload(const QCanBusFrame &frame)
     quint16 index = 0;
     quint8 subindex = 0;
 
-    quint8 ss = static_cast<quint8>(frame.payload().at(0) & SS::SDO_SCS_SERVER_BLOCK_DOWNLOAD_SS_MASK);
+    quint8 ss = static_cast<quint8>(frame.payloadData()[0] & SS::SDO_SCS_SERVER_BLOCK_DOWNLOAD_SS_MASK);
 
     if (_currentRequest == nullptr)
     {
@@ -907,39 +1088,47 @@ bool SDO::sdoBlockDownload(const QCanBusFrame &frame)
             return false;
         }
 
-        _currentRequest->blksize = static_cast<quint8>(frame.payload().at(4));
-        if (_currentRequest->blksize > BLOCK_BLOCK_SIZE)
+        _currentRequest->blksize = static_cast<quint8>(frame.payloadData()[4]);
+        if (_currentRequest->blksize == 0 || _currentRequest->blksize > BLOCK_BLOCK_SIZE)
         {
             sendErrorSdoToDevice(CO_SDO_ABORT_CODE_INVALID_BLOCK_SIZE);
             return false;
         }
+        _currentRequest->crc = ((frame.payloadData()[0] & FlagBlock::BLOCK_CRC) != 0);
 
         _currentRequest->state = STATE_BLOCK_DOWNLOAD;
         _currentRequest->seqno = 1;
-        _subBlockDownloadTimer->start(_blockDownloadIntervalMs);
+        _currentRequest->burstSize = _currentRequest->blksize;
         _timeoutTimer->stop();
+        sdoBlockDownloadSubBlock();
     }
     else if (ss == SS::SDO_SCS_SERVER_BLOCK_DOWNLOAD_SS_RESP)
     {
-        _currentRequest->blksize = static_cast<quint8>(frame.payload().at(2));
-        if (_currentRequest->blksize > BLOCK_BLOCK_SIZE)
+        _currentRequest->blksize = static_cast<quint8>(frame.payloadData()[2]);
+        if (_currentRequest->blksize == 0 || _currentRequest->blksize > BLOCK_BLOCK_SIZE)
         {
             sendErrorSdoToDevice(CO_SDO_ABORT_CODE_INVALID_BLOCK_SIZE);
             return false;
         }
 
-        quint8 ackseq = static_cast<quint8>(frame.payload().at(1));
-        if (ackseq > BLOCK_BLOCK_SIZE)
+        quint8 ackseq = static_cast<quint8>(frame.payloadData()[1]);
+        if (ackseq > BLOCK_BLOCK_SIZE || ackseq > _currentRequest->seqno - 1)
         {
             sendErrorSdoToDevice(CO_SDO_ABORT_CODE_INVALID_SEQ_NUMBER);
             return false;
         }
         if (ackseq != (_currentRequest->seqno - 1))
         {
-            // ERROR sequence detection from server -> Re-Send block
+            // segments lost by the server -> re-send them from ackseq + 1, in smaller bursts
             qDebug() << ">>SDO::sdoBlockDownload, Error sequence detection from server, ackseq : " << ackseq << "attempt:" << _currentRequest->attemptCount;
-            _currentRequest->stay += (_currentRequest->seqno - 1) * SDO_SG_SIZE;
+            quint32 lostCount = static_cast<quint32>(_currentRequest->seqno - 1 - ackseq);
+            if (_currentRequest->state == STATE_BLOCK_DOWNLOAD_END)
+            {
+                lostCount--;  // stay already counts the last segment
+            }
+            _currentRequest->stay += lostCount * SDO_SG_SIZE;
             _currentRequest->state = STATE_BLOCK_DOWNLOAD;
+            _currentRequest->burstSize = qMax(1, _currentRequest->burstSize / 2);
             _currentRequest->attemptCount++;
             if (_currentRequest->attemptCount == _maxErrorAttempt)
             {
@@ -948,12 +1137,17 @@ bool SDO::sdoBlockDownload(const QCanBusFrame &frame)
                 return false;
             }
         }
+        else
+        {
+            _currentRequest->burstSize = _currentRequest->burstSize * 2;
+        }
+        _currentRequest->burstSize = qMin<int>(_currentRequest->burstSize, _currentRequest->blksize);
 
         if (_currentRequest->state == STATE_BLOCK_DOWNLOAD)
         {
             _currentRequest->seqno = 1;
-            _subBlockDownloadTimer->start(_blockDownloadIntervalMs);
             _timeoutTimer->stop();
+            sdoBlockDownloadSubBlock();
         }
         else if (_currentRequest->state == STATE_BLOCK_DOWNLOAD_END)
         {
@@ -970,47 +1164,47 @@ bool SDO::sdoBlockDownload(const QCanBusFrame &frame)
 }
 
 /**
- * @brief Send a sub block
+ * @brief Sends the segments of the current sub block, burstSize at a time
+ *
+ * Segments are queued on the bus TX queue, which paces them to the driver. After the device
+ * lost segments, the sub block is split into smaller bursts spaced by blockDownloadIntervalMs.
  */
 void SDO::sdoBlockDownloadSubBlock()
 {
-    quint32 seek = 0;
-    QByteArray buffer;
-
-    if (_currentRequest == nullptr)
+    _subBlockDownloadTimer->stop();
+    if (_currentRequest == nullptr || _currentRequest->state != STATE_BLOCK_DOWNLOAD)
     {
-        _subBlockDownloadTimer->stop();
         return;
     }
 
-    if (_currentRequest->seqno <= _currentRequest->blksize)
+    int burstCount = 0;
+    while (_currentRequest->seqno <= _currentRequest->blksize && burstCount < _currentRequest->burstSize)
     {
-        seek = _currentRequest->size - _currentRequest->stay;
-        buffer.clear();
-        buffer = _currentRequest->dataByte.mid(static_cast<int32_t>(seek), SDO_SG_SIZE);
-
-        sendSdoRequest(true, _currentRequest->seqno, buffer);
-        _currentRequest->stay -= SDO_SG_SIZE;
-        _currentRequest->seqno++;
-
+        int seek = static_cast<int>(_currentRequest->size - _currentRequest->stay);
+        QByteArray buffer = _currentRequest->dataByte.mid(seek, SDO_SG_SIZE);
         if (_currentRequest->stay <= SDO_SG_SIZE)
         {
-            seek = _currentRequest->size - _currentRequest->stay;
-            buffer.clear();
-            buffer = _currentRequest->dataByte.mid(static_cast<int32_t>(seek), SDO_SG_SIZE);
-
+            // last segment, stay keeps its size for the end request
             sendSdoRequest(false, _currentRequest->seqno, buffer);
             _currentRequest->state = STATE_BLOCK_DOWNLOAD_END;
             _currentRequest->seqno++;
-            _subBlockDownloadTimer->stop();
             return;
         }
+
+        sendSdoRequest(true, _currentRequest->seqno, buffer);
+        _currentRequest->stay -= SDO_SG_SIZE;
+        _currentRequest->seqno++;
+        burstCount++;
+    }
+
+    if (_currentRequest->seqno > _currentRequest->blksize)
+    {
+        // sub block complete, waiting for the acknowledge
+        startTimeout(false);
     }
     else
     {
-        _subBlockDownloadTimer->stop();
-        _currentRequest->state = STATE_BLOCK_DOWNLOAD;
-        _timeoutTimer->start(_timeoutMs);
+        _subBlockDownloadTimer->start(_blockDownloadIntervalMs);
     }
 }
 
@@ -1024,9 +1218,43 @@ bool SDO::sdoBlockDownloadEnd()
     cmd |= CS::SDO_CCS_CLIENT_BLOCK_DOWNLOAD_CS_END_REQ;
     cmd |= (SDO_SG_SIZE - _currentRequest->stay) << 2;
     quint16 crc = 0;
+    if (_currentRequest->crc)
+    {
+        crc = crc16(_currentRequest->dataByte.constData(), static_cast<int>(_currentRequest->size));
+    }
     return sendSdoRequest(cmd, crc);
 }
 
+struct Crc16Table
+{
+    Crc16Table()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            quint16 value = static_cast<quint16>(i << 8);
+            for (int bit = 0; bit < 8; bit++)
+            {
+                value = (value & 0x8000) ? static_cast<quint16>((value << 1) ^ 0x1021) : static_cast<quint16>(value << 1);
+            }
+            values[i] = value;
+        }
+    }
+    quint16 values[256];
+};
+
+/**
+ * @brief CRC of SDO block transfers, CRC-16 CCITT (x^16 + x^12 + x^5 + 1), initial value 0
+ */
+quint16 SDO::crc16(const char *data, int size, quint16 crc)
+{
+    static const Crc16Table table;
+    for (int i = 0; i < size; i++)
+    {
+        crc = static_cast<quint16>((crc << 8) ^ table.values[((crc >> 8) ^ static_cast<quint8>(data[i])) & 0xFF]);
+    }
+    return crc;
+}
+
 /**
  * @brief Send error sdo to device
  * @param error SDO/CIA
@@ -1057,10 +1285,13 @@ void SDO::setErrorToObject(SDOAbortCodes error)
 
     _node->nodeOd()->updateObjectFromDevice(
         _currentRequest->index, _currentRequest->subIndex, QVariant(error), static_cast<NodeOd::FlagsRequest>(flags), QDateTime::currentDateTime());
+    completeRequest(_currentRequest, NodeObjectResult::Error, QVariant(), error);
+    recordStatistics(StatAbort, error);
 
     _status = SDO_STATE_FREE;
     _currentRequest->state = STATE_FREE;
     _timeoutTimer->stop();
+    _subBlockDownloadTimer->stop();
     nextRequest();
 }
 
@@ -1071,16 +1302,29 @@ void SDO::endRequest()
 {
     if (_currentRequest->state == STATE_UPLOAD)
     {
-        _node->nodeOd()->updateObjectFromDevice(_currentRequest->index,
-                                                _currentRequest->subIndex,
-                                                arrangeDataUpload(_currentRequest->dataByte, _currentRequest->dataType),
-                                                NodeOd::FlagsRequest::Read,
-                                                QDateTime::currentDateTime());
+        QVariant value;
+        if (_currentRequest->inlineSize > 0)
+        {
+            value = arrangeExpeditedUpload(_currentRequest->inlineData, _currentRequest->dataType);
+            if (!value.isValid())
+            {
+                value = arrangeDataUpload(QByteArray(_currentRequest->inlineData, _currentRequest->inlineSize), _currentRequest->dataType);
+            }
+        }
+        else
+        {
+            value = arrangeDataUpload(_currentRequest->dataByte, _currentRequest->dataType);
+        }
+        _node->nodeOd()->updateObjectFromDevice(_currentRequest->index, _currentRequest->subIndex, value, NodeOd::FlagsRequest::Read, QDateTime::currentDateTime());
+        completeRequest(_currentRequest, NodeObjectResult::Done, value);
+        recordStatistics(StatUpload);
     }
     else if (_currentRequest->state == STATE_DOWNLOAD)
     {
         _node->nodeOd()->updateObjectFromDevice(
             _currentRequest->index, _currentRequest->subIndex, _currentRequest->data, NodeOd::FlagsRequest::Write, QDateTime::currentDateTime());
+        completeRequest(_currentRequest, NodeObjectResult::Done, _currentRequest->data);
+        recordStatistics(StatDownload);
     }
 
     _status = SDO_STATE_FREE;
@@ -1100,12 +1344,58 @@ void SDO::nextRequest()
 
     if (_currentRequest != nullptr)
     {
-        delete _currentRequest;
+        cancelRequest(_currentRequest);
+        releaseRequest(_currentRequest);
+        _currentRequest = nullptr;
+    }
+
+    if (!hasRequestPending())
+    {
+        releaseSlot();
+        return;
     }
 
-    if (!_requestQueue.isEmpty())
+    // a slot of the bus scheduler is needed for each request
+    if (_scheduler != nullptr)
+    {
+        SdoScheduler *scheduler = _scheduler;
+        _scheduler = nullptr;
+        if (!scheduler->renew(this, nextPriority()))
+        {
+            return;
+        }
+        _scheduler = scheduler;
+    }
+    else if (bus() != nullptr)
     {
-        _currentRequest = _requestQueue.dequeue();
+        SdoScheduler *scheduler = bus()->sdoScheduler();
+        if (!scheduler->acquire(this, nextPriority()))
+        {
+            return;
+        }
+        _scheduler = scheduler;
+    }
+
+    startNextRequest();
+}
+
+void SDO::startNextRequest()
+{
+    while (hasRequestPending())
+    {
+        RequestSdo *request = takeNextRequest();
+        if (isRequestAborted(request))
+        {
+            cancelRequest(request);
+            releaseRequest(request);
+            continue;
+        }
+
+        _currentRequest = request;
+        _currentRequest->startedUs = _statisticsClock.nsecsElapsed() / 1000;
+        recordStatistics(StatQueueWait, _currentRequest->startedUs - _currentRequest->queuedUs);
+        _initiatePending = true;
+        _retransmission = false;
         if (_currentRequest->state == STATE_UPLOAD)
         {
             _status = SDO_STATE_NOT_FREE;
@@ -1116,11 +1406,210 @@ void SDO::nextRequest()
             _status = SDO_STATE_NOT_FREE;
             downloadDispatcher();
         }
+        return;
+    }
+    releaseSlot();
+}
+
+/**
+ * @brief Called by the bus scheduler when a slot is granted to this waiting client
+ */
+void SDO::resume(SdoScheduler *scheduler)
+{
+    _scheduler = scheduler;
+    if (_status != SDO_STATE_FREE || !hasRequestPending())
+    {
+        releaseSlot();
+        return;
+    }
+    startNextRequest();
+}
+
+void SDO::releaseSlot()
+{
+    if (_scheduler != nullptr)
+    {
+        SdoScheduler *scheduler = _scheduler;
+        _scheduler = nullptr;
+        scheduler->release(this);
+    }
+}
+
+// queues request in the priority class, or moves it to a more urgent one
+void SDO::enqueueRequest(RequestSdo *request, Priority priority)
+{
+    if (priority >= request->priority)
+    {
+        return;
+    }
+    if (request->priority != PriorityCount)
+    {
+        _requestQueues[request->priority].removeOne(request);
+    }
+    request->priority = priority;
+    _requestQueues[priority].enqueue(request);
+}
+
+// queues a download in the priority class, older downloads of less urgent classes are moved up with it
+// so that writes on a node are always done in the order they were requested
+void SDO::enqueueDownload(RequestSdo *request, Priority priority)
+{
+    for (int p = priority + 1; p < PriorityCount; p++)
+    {
+        QQueue<RequestSdo *> &queue = _requestQueues[p];
+        for (int i = 0; i < queue.count();)
+        {
+            RequestSdo *older = queue.at(i);
+            if (older->download)
+            {
+                queue.removeAt(i);
+                older->priority = priority;
+                _requestQueues[priority].enqueue(older);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+    request->priority = priority;
+    _requestQueues[priority].enqueue(request);
+}
+
+bool SDO::hasCoalescedWrites(quint16 index, quint8 subindex) const
+{
+    if (!_node->nodeOd()->subIndexExist(index, subindex))
+    {
+        return false;
+    }
+    return _node->nodeOd()->index(index)->subIndex(subindex)->hasCoalescedWrites();
+}
+
+SDO::Priority SDO::nextPriority() const
+{
+    for (int p = 0; p < PriorityCount; p++)
+    {
+        if (!_requestQueues[p].isEmpty())
+        {
+            return static_cast<Priority>(p);
+        }
+    }
+    return PriorityBackground;
+}
+
+void SDO::addWaiter(RequestSdo *request, const QSharedPointer<SdoBatch> &batch, int slot)
+{
+    if (batch.isNull())
+    {
+        request->standalone = true;
+        return;
+    }
+    request->waiters.append(RequestSdo::Waiter{batch, slot});
+}
+
+// true if only waited by batches given up after an error
+bool SDO::isRequestAborted(const RequestSdo *request) const
+{
+    if (request->standalone || request->waiters.isEmpty())
+    {
+        return false;
+    }
+    for (const RequestSdo::Waiter &waiter : request->waiters)
+    {
+        if (!waiter.batch->isAborted())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SDO::completeRequest(RequestSdo *request, NodeObjectResult::Status status, const QVariant &value, quint32 error)
+{
+    if (request->waiters.isEmpty())
+    {
+        return;
+    }
+    NodeObjectId objectId(_node->busId(), _node->nodeId(), request->index, request->subIndex, request->dataType);
+    NodeObjectResult result(objectId, status, value, error);
+    const QVector<RequestSdo::Waiter> waiters = request->waiters;
+    request->waiters.clear();
+    for (const RequestSdo::Waiter &waiter : waiters)
+    {
+        waiter.batch->complete(waiter.slot, result);
+    }
+}
+
+void SDO::cancelRequest(RequestSdo *request)
+{
+    completeRequest(request, NodeObjectResult::Cancelled);
+}
+
+SDO::RequestSdo *SDO::takeNextRequest()
+{
+    RequestSdo *request = _requestQueues[nextPriority()].dequeue();
+    quint32 key = (static_cast<quint32>(request->index) << 8) | request->subIndex;
+    if (request->state == STATE_UPLOAD)
+    {
+        _pendingUploads.remove(key);
     }
     else
     {
-        _currentRequest = nullptr;
+        _pendingDownloads.remove(key, request);
     }
+    return request;
+}
+
+/**
+ * @brief Takes a request from the pool of the channel, allocates one only if the pool is empty
+ */
+SDO::RequestSdo *SDO::allocRequest()
+{
+    if (_requestPool.isEmpty())
+    {
+        return new RequestSdo();
+    }
+    return _requestPool.takeLast();
+}
+
+/**
+ * @brief Gives back a finished request to the pool, all fields are cleared for the next use
+ */
+void SDO::releaseRequest(RequestSdo *request)
+{
+    if (_requestPool.size() >= SDO_REQUEST_POOL_SIZE)
+    {
+        delete request;
+        return;
+    }
+
+    request->state = STATE_FREE;
+    request->index = 0;
+    request->subIndex = 0;
+    request->dataByte.clear();
+    request->dataType = QMetaType::UnknownType;
+    request->data.clear();
+    request->inlineSize = 0;
+    request->stay = 0;
+    request->size = 0;
+    request->toggle = 0;
+    request->dataByteBySegment.clear();
+    request->blksize = 0;
+    request->moreBlockSegments = 0;
+    request->seqno = 0;
+    request->ackseq = 0;
+    request->burstSize = 0;
+    request->crc = false;
+    request->error = false;
+    request->attemptCount = 0;
+    request->retryCount = 0;
+    request->download = false;
+    request->queuedUs = 0;
+    request->startedUs = 0;
+    request->priority = PriorityCount;
+    request->waiters.clear();  // keeps its capacity
+    request->standalone = false;
+    _requestPool.append(request);
 }
 
 /**
@@ -1130,9 +1619,105 @@ void SDO::timeout()
 {
     uint32_t error = CO_SDO_ABORT_CODE_TIMED_OUT;
     sendSdoRequest(CCS::SDO_CCS_CLIENT_ABORT, _currentRequest->index, _currentRequest->subIndex, error);
+    recordStatistics(StatTimeout);
+
+    // exponential backoff until a new valid RTT sample
+    if (_backoffShift < MAX_BACKOFF_SHIFT)
+    {
+        _backoffShift++;
+    }
+
+    // nothing exchanged yet with the server, an upload can be started again. A download is never
+    // repeated, the device may have executed it and only its response was lost
+    if (_initiatePending && !_currentRequest->download && _currentRequest->retryCount + 1 < _maxErrorAttempt)
+    {
+        _currentRequest->retryCount++;
+        recordStatistics(StatRetry);
+        _retransmission = true;
+        _currentRequest->state = STATE_UPLOAD;
+        uploadDispatcher();
+        return;
+    }
+
     setErrorToObject(static_cast<SDOAbortCodes>(error));
 }
 
+void SDO::recordStatistics(StatisticsEvent event, qint64 value)
+{
+    QMutexLocker locker(&_statisticsMutex);
+    qint64 latencyUs = 0;
+    if (_currentRequest != nullptr)
+    {
+        latencyUs = _statisticsClock.nsecsElapsed() / 1000 - _currentRequest->startedUs;
+    }
+    switch (event)
+    {
+        case StatQueueWait:
+            _statistics.recordQueueWait(value);
+            break;
+
+        case StatUpload:
+            _statistics.recordRequest(false, _currentRequest->size, latencyUs);
+            break;
+
+        case StatDownload:
+            _statistics.recordRequest(true, _currentRequest->size, latencyUs);
+            break;
+
+        case StatAbort:
+            _statistics.recordAbort(static_cast<quint32>(value), latencyUs);
+            break;
+
+        case StatTimeout:
+            _statistics.recordTimeout();
+            break;
+
+        case StatRetry:
+            _statistics.recordRetry();
+            break;
+    }
+}
+
+/**
+ * @brief Starts the response timeout of an exchange
+ * @param rttSample false if the response delay is not a round trip time (after a burst)
+ */
+void SDO::startTimeout(bool rttSample)
+{
+    // Karn's rule, no sample on a retransmitted exchange
+    _rttSampleValid = rttSample && !_retransmission;
+    _rttTimer.start();
+
+    // a download may start a slow device operation (store, program control, flash commit on
+    // block end), the RTT derived timeout only shortens the initiate of uploads, which can be
+    // retried. Once started, a late segment would abort the whole transfer
+    int timeoutMs = currentTimeoutMs();
+    if (_currentRequest != nullptr && (_currentRequest->download || !_initiatePending))
+    {
+        timeoutMs = qMax(timeoutMs, _timeoutMs);
+    }
+    _timeoutTimer->start(timeoutMs);
+}
+
+/**
+ * @brief Smoothed RTT and variation update, as TCP does (RFC 6298)
+ */
+void SDO::addRttSample(qint64 rttUs)
+{
+    if (_rttSampleCount == 0)
+    {
+        _srttUs = rttUs;
+        _rttVarUs = rttUs / 2;
+    }
+    else
+    {
+        _rttVarUs = (3 * _rttVarUs + qAbs(_srttUs - rttUs)) / 4;
+        _srttUs = (7 * _srttUs + rttUs) / 8;
+    }
+    _rttSampleCount++;
+    _backoffShift = 0;
+}
+
 /**
  * @brief Management SDO upload initiate
  * @param cmd
@@ -1141,30 +1726,23 @@ void SDO::timeout()
  * @return bool value successful or not
  */
 bool SDO::sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex)
+
 {
     if (!bus()->canWrite())
     {
         return false;
     }
 
-    QByteArray sdoWriteReqPayload;
-    QDataStream request(&sdoWriteReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request << cmd;
-    request << index;
-    request << subindex;
-
-    // the frame must be a size of 8
-    for (int i = sdoWriteReqPayload.size(); i < 8; i++)
-    {
-        request << static_cast<quint8>(0);
-    }
+    char payload[8] = {};
+    payload[0] = static_cast<char>(cmd);
+    qToLittleEndian(index, payload + 1);
+    payload[3] = static_cast<char>(subindex);
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
-    frame.setPayload(sdoWriteReqPayload);
+    frame.setFrameId(_cobIdClientToServer);
+    frame.setPayload(payload, 8);
 
-    _timeoutTimer->start(_timeoutMs);
+    startTimeout();
     return bus()->writeFrame(frame);
 }
 
@@ -1174,28 +1752,21 @@ bool SDO::sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex)
  * @return bool value successful or not
  */
 bool SDO::sendSdoRequest(quint8 cmd)
+
 {
     if (!bus()->canWrite())
     {
         return false;
     }
 
-    QByteArray sdoWriteReqPayload;
-    QDataStream request(&sdoWriteReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request << cmd;
-
-    // the frame must be a size of 8
-    for (int i = sdoWriteReqPayload.size(); i < 8; i++)
-    {
-        request << static_cast<quint8>(0);
-    }
+    char payload[8] = {};
+    payload[0] = static_cast<char>(cmd);
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
-    frame.setPayload(sdoWriteReqPayload);
+    frame.setFrameId(_cobIdClientToServer);
+    frame.setPayload(payload, 8);
 
-    _timeoutTimer->start(_timeoutMs);
+    startTimeout();
     return bus()->writeFrame(frame);
 }
 
@@ -1204,35 +1775,29 @@ bool SDO::sendSdoRequest(quint8 cmd)
  * @param cmd
  * @param index
  * @param subindex
- * @param data
+ * @param data expedited value or size of the transfer
+ * @param size up to 4 bytes
  * @return bool value successful or not
  */
-bool SDO::sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, const QByteArray &data)
+bool SDO::sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, const char *data, int size)
+
 {
     if (!bus()->canWrite())
     {
         return false;
     }
 
-    QByteArray sdoWriteReqPayload;
-    QDataStream request(&sdoWriteReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request << cmd;
-    request << index;
-    request << subindex;
-    request.writeRawData(data.data(), data.size());
-
-    // the frame must be a size of 8
-    for (int i = sdoWriteReqPayload.size(); i < 8; i++)
-    {
-        request << static_cast<quint8>(0);
-    }
+    char payload[8] = {};
+    payload[0] = static_cast<char>(cmd);
+    qToLittleEndian(index, payload + 1);
+    payload[3] = static_cast<char>(subindex);
+    memcpy(payload + 4, data, static_cast<size_t>(qMin(size, 4)));
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
-    frame.setPayload(sdoWriteReqPayload);
+    frame.setFrameId(_cobIdClientToServer);
+    frame.setPayload(payload, 8);
 
-    _timeoutTimer->start(_timeoutMs);
+    startTimeout();
     return bus()->writeFrame(frame);
 }
 
@@ -1260,42 +1825,35 @@ bool SDO::sendSdoRequest(quint8 cmd, const QByteArray &data)
     }
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
+    frame.setFrameId(_cobIdClientToServer);
     frame.setPayload(sdoWriteReqPayload);
-    _timeoutTimer->start(_timeoutMs);
+    startTimeout();
     return bus()->writeFrame(frame);
 }
 
 /**
  * @brief Management SDO block download end
  * @param cmd
- * @param crc NOT USED = 0
+ * @param crc CRC of the data, 0 if not negotiated
  * @return bool value successful or not
  */
 bool SDO::sendSdoRequest(quint8 cmd, quint16 crc)
+
 {
     if (!bus()->canWrite())
     {
         return false;
     }
 
-    QByteArray sdoWriteReqPayload;
-    QDataStream request(&sdoWriteReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request << cmd;
-    request << crc;
-
-    // the frame must be a size of 8
-    for (int i = sdoWriteReqPayload.size(); i < 8; i++)
-    {
-        request << static_cast<quint8>(0);
-    }
+    char payload[8] = {};
+    payload[0] = static_cast<char>(cmd);
+    qToLittleEndian(crc, payload + 1);
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
-    frame.setPayload(sdoWriteReqPayload);
+    frame.setFrameId(_cobIdClientToServer);
+    frame.setPayload(payload, 8);
 
-    _timeoutTimer->start(_timeoutMs);
+    startTimeout();
     return bus()->writeFrame(frame);
 }
 
@@ -1309,32 +1867,25 @@ bool SDO::sendSdoRequest(quint8 cmd, quint16 crc)
  * @return bool value successful or not
  */
 bool SDO::sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, quint8 blksize, quint8 pst)
+
 {
     if (!bus()->canWrite())
     {
         return false;
     }
 
-    QByteArray sdoWriteReqPayload;
-    QDataStream request(&sdoWriteReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request << cmd;
-    request << index;
-    request << subindex;
-    request << blksize;
-    request << pst;
-
-    // the frame must be a size of 8
-    for (int i = sdoWriteReqPayload.size(); i < 8; i++)
-    {
-        request << static_cast<quint8>(0);
-    }
+    char payload[8] = {};
+    payload[0] = static_cast<char>(cmd);
+    qToLittleEndian(index, payload + 1);
+    payload[3] = static_cast<char>(subindex);
+    payload[4] = static_cast<char>(blksize);
+    payload[5] = static_cast<char>(pst);
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
-    frame.setPayload(sdoWriteReqPayload);
+    frame.setFrameId(_cobIdClientToServer);
+    frame.setPayload(payload, 8);
 
-    _timeoutTimer->start(_timeoutMs);
+    startTimeout();
     return bus()->writeFrame(frame);
 }
 
@@ -1346,28 +1897,21 @@ bool SDO::sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, quint8 blks
  * @bool return value successful or not
  */
 bool SDO::sendSdoRequest(quint8 cmd, quint8 ackseq, quint8 blksize)
+
 {
     if (!bus()->canWrite())
     {
         return false;
     }
 
-    QByteArray sdoWriteReqPayload;
-    QDataStream request(&sdoWriteReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request << cmd;
-    request << ackseq;
-    request << blksize;
-
-    // the frame must be a size of 8
-    for (int i = sdoWriteReqPayload.size(); i < 8; i++)
-    {
-        request << static_cast<quint8>(0);
-    }
+    char payload[8] = {};
+    payload[0] = static_cast<char>(cmd);
+    payload[1] = static_cast<char>(ackseq);
+    payload[2] = static_cast<char>(blksize);
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
-    frame.setPayload(sdoWriteReqPayload);
+    frame.setFrameId(_cobIdClientToServer);
+    frame.setPayload(payload, 8);
 
     return bus()->writeFrame(frame);
 }
@@ -1392,7 +1936,7 @@ bool SDO::sendSdoRequest(bool moreSegments, quint8 seqno, const QByteArray &segD
 
     if (!moreSegments)
     {
-        _timeoutTimer->start(_timeoutMs);
+        startTimeout(false);
         seqno |= 0x80;
         request << static_cast<quint8>(seqno);
     }
@@ -1407,7 +1951,7 @@ bool SDO::sendSdoRequest(bool moreSegments, quint8 seqno, const QByteArray &segD
     {
         sdoWriteReqPayload.append(static_cast<char>(0));
     }
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
+    frame.setFrameId(_cobIdClientToServer);
     frame.setPayload(sdoWriteReqPayload);
 
     return bus()->writeFrame(frame);
@@ -1422,25 +1966,24 @@ bool SDO::sendSdoRequest(bool moreSegments, quint8 seqno, const QByteArray &segD
  * @bool return value successful or not
  */
 bool SDO::sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, quint32 error)
+
 {
     if (!bus()->canWrite())
     {
         return false;
     }
 
-    QByteArray sdoWriteReqPayload;
-    QDataStream request(&sdoWriteReqPayload, QIODevice::WriteOnly);
-    request.setByteOrder(QDataStream::LittleEndian);
-    request << cmd;
-    request << index;
-    request << subindex;
-    request << error;
+    char payload[8] = {};
+    payload[0] = static_cast<char>(cmd);
+    qToLittleEndian(index, payload + 1);
+    payload[3] = static_cast<char>(subindex);
+    qToLittleEndian(error, payload + 4);
 
     QCanBusFrame frame;
-    frame.setFrameId(_cobIdClientToServer + _nodeId);
-    frame.setPayload(sdoWriteReqPayload);
+    frame.setFrameId(_cobIdClientToServer);
+    frame.setPayload(payload, 8);
 
-    _timeoutTimer->start(_timeoutMs);
+    startTimeout(false);
     return bus()->writeFrame(frame);
 }
 
@@ -1632,6 +2175,107 @@ void SDO::arrangeDataDownload(QDataStream &request, const QVariant &data)
     }
 }
 
+/**
+ * @brief Decodes in place a value of at most 4 bytes received by an expedited transfer
+ * @param data 4 bytes, little endian
+ * @param type of data
+ * @return QVariant arranged value, invalid if the type needs arrangeDataUpload
+ */
+QVariant SDO::arrangeExpeditedUpload(const char *data, QMetaType::Type type)
+{
+    switch (type)
+    {
+        case QMetaType::Int:
+            return QVariant(static_cast<int>(qFromLittleEndian<qint32>(data)));
+
+        case QMetaType::UInt:
+            return QVariant(static_cast<unsigned int>(qFromLittleEndian<quint32>(data)));
+
+        case QMetaType::Short:
+            return QVariant(static_cast<short>(qFromLittleEndian<qint16>(data)));
+
+        case QMetaType::UShort:
+            return QVariant::fromValue(static_cast<unsigned short>(qFromLittleEndian<quint16>(data)));
+
+        case QMetaType::UChar:
+            return QVariant::fromValue(static_cast<unsigned char>(data[0]));
+
+        case QMetaType::SChar:
+            return QVariant::fromValue(static_cast<signed char>(data[0]));
+
+        case QMetaType::Float:
+        {
+            quint32 bits = qFromLittleEndian<quint32>(data);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return QVariant(f);
+        }
+
+        default:
+            break;
+    }
+
+    return QVariant();
+}
+
+/**
+ * @brief Encodes a value of at most 4 bytes for an expedited transfer, without QDataStream
+ * @param data 4 bytes buffer, little endian
+ * @param value
+ * @return number of bytes used, 0 if the type needs arrangeDataDownload
+ */
+int SDO::arrangeExpeditedDownload(char *data, const QVariant &value)
+{
+    switch (QMetaType::Type(value.type()))
+    {
+        case QMetaType::Int:
+            qToLittleEndian(static_cast<qint32>(value.value<int>()), data);
+            return 4;
+
+        case QMetaType::UInt:
+            qToLittleEndian(static_cast<quint32>(value.value<unsigned int>()), data);
+            return 4;
+
+        case QMetaType::Short:
+            qToLittleEndian(static_cast<qint16>(value.value<short>()), data);
+            return 2;
+
+        case QMetaType::UShort:
+            qToLittleEndian(static_cast<quint16>(value.value<unsigned short>()), data);
+            return 2;
+
+        case QMetaType::Char:
+            data[0] = value.value<char>();
+            return 1;
+
+        case QMetaType::UChar:
+            data[0] = static_cast<char>(value.value<unsigned char>());
+            return 1;
+
+        case QMetaType::SChar:
+            data[0] = static_cast<char>(value.value<signed char>());
+            return 1;
+
+        case QMetaType::Float:
+        {
+            float f = value.toFloat();
+            quint32 bits;
+            memcpy(&bits, &f, sizeof(bits));
+            qToLittleEndian(bits, data);
+            return 4;
+        }
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Response timeout used before the first RTT sample of the channel, and minimum response
+ * timeout of downloads
+ */
 int SDO::timeoutMs() const
 {
     return _timeoutMs;
@@ -1647,6 +2291,79 @@ int SDO::blockDownloadIntervalMs() const
     return _blockDownloadIntervalMs;
 }
 
+/**
+ * @brief Minimum response timeout once derived from the measured RTT
+ */
+int SDO::minTimeoutMs() const
+{
+    return _minTimeoutMs;
+}
+
+void SDO::setMinTimeoutMs(int minTimeoutMs)
+{
+    _minTimeoutMs = minTimeoutMs;
+}
+
+/**
+ * @brief Smoothed round trip time of the channel, in microseconds
+ */
+qint64 SDO::smoothedRttUs() const
+{
+    return _srttUs;
+}
+
+qint64 SDO::rttVariationUs() const
+{
+    return _rttVarUs;
+}
+
+int SDO::rttSampleCount() const
+{
+    return _rttSampleCount;
+}
+
+/**
+ * @brief Upload initiate response timeout in use: timeoutMs() until the first RTT sample, then
+ * SRTT + 4 * RTTVAR, doubled after each timeout. Downloads and segments never wait less than timeoutMs()
+ */
+int SDO::currentTimeoutMs() const
+{
+    qint64 timeoutMs = _timeoutMs;
+    if (_rttSampleCount > 0)
+    {
+        timeoutMs = (_srttUs + qMax<qint64>(RTT_GRANULARITY_US, 4 * _rttVarUs) + 999) / 1000;
+        timeoutMs = qMax<qint64>(timeoutMs, _minTimeoutMs);
+    }
+    timeoutMs <<= _backoffShift;
+    return static_cast<int>(qMin<qint64>(timeoutMs, MAX_TIMEOUT_MS));
+}
+
+/**
+ * @brief Transactions counters and latency histograms of this channel
+ */
+SdoStatistics SDO::statistics() const
+{
+    QMutexLocker locker(&_statisticsMutex);
+    return _statistics;
+}
+
+void SDO::resetStatistics()
+{
+    QMutexLocker locker(&_statisticsMutex);
+    _statistics.reset();
+}
+
+void SDO::resetRttStatistics()
+{
+    _srttUs = 0;
+    _rttVarUs = 0;
+    _rttSampleCount = 0;
+    _backoffShift = 0;
+}
+
+/**
+ * @brief Delay between two bursts of a sub block, used only once the device has lost segments
+ */
 void SDO::setBlockDownloadIntervalMs(int blockDownloadIntervalMs)
 {
     _blockDownloadIntervalMs = blockDownloadIntervalMs;
@@ -23,16 +23,25 @@
 
 #include "service.h"
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
 #include <QQueue>
+#include <QSharedPointer>
 #include <QTimer>
 
 #include "nodeindex.h"
+#include "sdobatch.h"
+#include "sdostatistics.h"
+
+class SdoScheduler;
 
 class CANOPEN_EXPORT SDO : public Service
 {
     Q_OBJECT
 public:
     SDO(Node *node);
+    SDO(Node *node, quint32 cobIdClientToServer, quint32 cobIdServerToClient);
     ~SDO() override;
 
     // Settings
@@ -45,15 +54,52 @@ public:
     int timeoutMs() const;
     void setTimeoutMs(int timeoutMs);
 
+    int minTimeoutMs() const;
+    void setMinTimeoutMs(int minTimeoutMs);
+
     quint32 cobIdClientToServer() const;
     quint32 cobIdServerToClient() const;
 
     // Status
     bool hasRequestPending() const;
+    bool hasRequestOn(quint16 index, quint8 subindex) const;
+    bool hasDownloadPending() const;
+    int load() const;
     qint32 currentRequestStay() const;
 
-    bool uploadData(quint16 index, quint8 subindex, QMetaType::Type dataType);
-    bool downloadData(quint16 index, quint8 subindex, const QVariant &data);
+    // Round trip statistics
+    qint64 smoothedRttUs() const;
+    qint64 rttVariationUs() const;
+    int rttSampleCount() const;
+    int currentTimeoutMs() const;
+    void resetRttStatistics();
+
+    // Transactions statistics
+    SdoStatistics statistics() const;
+    void resetStatistics();
+
+    // Requests scheduling, classes by decreasing priority
+    enum Priority
+    {
+        PriorityInteractive,  // user actions, control word writes
+        PriorityControl,      // periodic reads of control loops
+        PriorityBackground,   // logging and polling
+        PriorityCount
+    };
+    bool uploadData(quint16 index,
+                    quint8 subindex,
+                    QMetaType::Type dataType,
+                    Priority priority = PriorityInteractive,
+                    const QSharedPointer<SdoBatch> &batch = QSharedPointer<SdoBatch>(),
+                    int slot = 0);
+    bool downloadData(quint16 index,
+                      quint8 subindex,
+                      const QVariant &data,
+                      Priority priority = PriorityInteractive,
+                      const QSharedPointer<SdoBatch> &batch = QSharedPointer<SdoBatch>(),
+                      int slot = 0);
+    int queueDepth() const;
+    int queueDepth(Priority priority) const;
 
     enum Status
     {
@@ -115,6 +161,8 @@ public:
     };
     QString sdoAbort(SDOAbortCodes error) const;
 
+    static quint16 crc16(const char *data, int size, quint16 crc = 0);
+
 private:
     quint32 _cobIdClientToServer;
     quint32 _cobIdServerToClient;
@@ -146,6 +194,8 @@ private:
         QByteArray dataByte;
         QMetaType::Type dataType;
         QVariant data;
+        char inlineData[4];  // expedited value, little endian, no heap storage needed
+        quint8 inlineSize;   // bytes used in inlineData, 0 if the value is in dataByte
         quint32 stay;
         quint32 size;
         quint8 toggle;
@@ -156,13 +206,51 @@ private:
         quint8 moreBlockSegments;  // indicates whether there are still more segments to be downloaded
         quint8 seqno;              // sequence number of segment
         quint8 ackseq;             // sequence number of segment
+        int burstSize;             // segments sent at once, reduced when the server loses some
+        bool crc;                  // CRC negotiated with the server
         bool error;
         quint8 attemptCount;
+        quint8 retryCount;
+        bool download;
+        qint64 queuedUs;
+        qint64 startedUs;
+
+        Priority priority;
+
+        // batches waiting for the end of the request
+        struct Waiter
+        {
+            QSharedPointer<SdoBatch> batch;
+            int slot;
+        };
+        QVector<Waiter> waiters;
+        bool standalone;  // also requested without batch
     };
 
     RequestSdo *_currentRequest;
-    QQueue<RequestSdo *> _requestQueue;
+    QQueue<RequestSdo *> _requestQueues[PriorityCount];
+    QHash<quint32, RequestSdo *> _pendingUploads;         // queued requests by index << 8 | subIndex
+    QMultiHash<quint32, RequestSdo *> _pendingDownloads;  // idem, several writes of an object are queued in order
+    QVector<RequestSdo *> _requestPool;                   // finished requests kept for reuse
+    RequestSdo *allocRequest();
+    void releaseRequest(RequestSdo *request);
     Status _status;
+    void enqueueRequest(RequestSdo *request, Priority priority);
+    void enqueueDownload(RequestSdo *request, Priority priority);
+    bool hasCoalescedWrites(quint16 index, quint8 subindex) const;
+    Priority nextPriority() const;
+    RequestSdo *takeNextRequest();
+    void addWaiter(RequestSdo *request, const QSharedPointer<SdoBatch> &batch, int slot);
+    bool isRequestAborted(const RequestSdo *request) const;
+    void completeRequest(RequestSdo *request, NodeObjectResult::Status status, const QVariant &value = QVariant(), quint32 error = 0);
+    void cancelRequest(RequestSdo *request);
+
+    // bus scheduler slot, held while a request runs
+    friend class SdoScheduler;
+    SdoScheduler *_scheduler;
+    void resume(SdoScheduler *scheduler);
+    void releaseSlot();
+    void startNextRequest();
 
     bool uploadDispatcher();
     bool downloadDispatcher();
@@ -175,6 +263,39 @@ private:
     QTimer *_timeoutTimer;
     void timeout();
 
+    // round trip time estimation, timeouts and retries
+    enum
+    {
+        MAX_TIMEOUT_MS = 60000,
+        MAX_BACKOFF_SHIFT = 6,
+        RTT_GRANULARITY_US = 1000
+    };
+    QElapsedTimer _rttTimer;
+    bool _rttSampleValid;
+    bool _initiatePending;  // no response received yet for the current request
+    bool _retransmission;
+    qint64 _srttUs;
+    qint64 _rttVarUs;
+    int _rttSampleCount;
+    int _backoffShift;
+    void startTimeout(bool rttSample = true);
+    void addRttSample(qint64 rttUs);
+
+    // statistics, written in the SDO thread, read from any thread
+    enum StatisticsEvent
+    {
+        StatQueueWait,
+        StatUpload,
+        StatDownload,
+        StatAbort,
+        StatTimeout,
+        StatRetry
+    };
+    SdoStatistics _statistics;
+    mutable QMutex _statisticsMutex;
+    QElapsedTimer _statisticsClock;
+    void recordStatistics(StatisticsEvent event, qint64 value = 0);
+
     QTimer *_subBlockDownloadTimer;
 
     quint16 indexFromFrame(const QCanBusFrame &frame);
@@ -191,7 +312,7 @@ private:
 
     bool sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex);  // SDO upload initiate
     bool sendSdoRequest(quint8 cmd);                                  // SDO upload segment, SDO block upload initiate, SDO block upload ends
-    bool sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, const QByteArray &data);      // SDO download initiate, SDO block download initiate
+    bool sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, const char *data, int size);  // SDO download initiate, SDO block download initiate
     bool sendSdoRequest(quint8 cmd, const QByteArray &data);                                      // SDO download segment
     bool sendSdoRequest(quint8 cmd, quint16 index, quint8 subindex, quint8 blksize, quint8 pst);  // SDO block upload initiate
     bool sendSdoRequest(quint8 cmd, quint8 ackseq, quint8 blksize);                               // SDO block upload sub-block
@@ -202,11 +323,14 @@ private:
 
     QVariant arrangeDataUpload(QByteArray, QMetaType::Type type);
     void arrangeDataDownload(QDataStream &request, const QVariant &data);
+    QVariant arrangeExpeditedUpload(const char *data, QMetaType::Type type);
+    int arrangeExpeditedDownload(char *data, const QVariant &value);
 
     // SDO settings
     int _maxErrorAttempt;
     int _blockDownloadIntervalMs;
     int _timeoutMs;
+    int _minTimeoutMs;
 
     // Service interface
 public:
@@ -0,0 +1,108 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "sdobatch.h"
+
+SdoBatch::SdoBatch(Mode mode)
+    : _mode(mode)
+{
+    _remaining = 0;
+    _aborted = false;
+    _futureInterface.reportStarted();
+}
+
+SdoBatch::~SdoBatch()
+{
+    // items never dispatched are reported cancelled, the future must not wait forever
+    if (!_futureInterface.isFinished())
+    {
+        _futureInterface.reportResults(_results);
+        _futureInterface.reportFinished();
+    }
+}
+
+SdoBatch::Mode SdoBatch::mode() const
+{
+    return _mode;
+}
+
+void SdoBatch::addRead(const NodeObjectId &objectId)
+{
+    _items.append(Item{objectId, QVariant(), false});
+    _results.append(NodeObjectResult(objectId, NodeObjectResult::Cancelled));
+    _remaining++;
+}
+
+void SdoBatch::addWrite(const NodeObjectId &objectId, const QVariant &value)
+{
+    _items.append(Item{objectId, value, true});
+    _results.append(NodeObjectResult(objectId, NodeObjectResult::Cancelled));
+    _remaining++;
+}
+
+int SdoBatch::count() const
+{
+    return _items.count();
+}
+
+const SdoBatch::Item &SdoBatch::item(int slot) const
+{
+    return _items.at(slot);
+}
+
+QFuture<NodeObjectResult> SdoBatch::future()
+{
+    return _futureInterface.future();
+}
+
+/**
+ * @brief Stores the result of an item and finishes the future after the last one
+ */
+void SdoBatch::complete(int slot, const NodeObjectResult &result)
+{
+    if (slot < 0 || slot >= _results.count() || _remaining == 0)
+    {
+        return;
+    }
+
+    _results[slot] = result;
+    if (result.status() != NodeObjectResult::Done && _mode == AllOrNothing)
+    {
+        _aborted = true;
+    }
+
+    _remaining--;
+    if (_remaining == 0)
+    {
+        _futureInterface.reportResults(_results);
+        _futureInterface.reportFinished();
+    }
+}
+
+void SdoBatch::cancel(int slot)
+{
+    complete(slot, NodeObjectResult(_items.at(slot).objectId, NodeObjectResult::Cancelled));
+}
+
+/**
+ * @brief True when an item of an AllOrNothing batch failed, remaining items are not sent
+ */
+bool SdoBatch::isAborted() const
+{
+    return _aborted;
+}
@@ -0,0 +1,78 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SDOBATCH_H
+#define SDOBATCH_H
+
+#include "canopen_global.h"
+
+#include <QFuture>
+#include <QFutureInterface>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "nodeobjectresult.h"
+
+/**
+ * @brief Set of object reads and writes completed through one QFuture
+ *
+ * Results are reported together, in the order of the items, once every item has ended. In
+ * AllOrNothing mode, the items not yet sent when one fails are cancelled.
+ */
+class CANOPEN_EXPORT SdoBatch
+{
+public:
+    enum Mode
+    {
+        Independent,
+        AllOrNothing
+    };
+
+    SdoBatch(Mode mode = Independent);
+    ~SdoBatch();
+
+    Mode mode() const;
+
+    struct Item
+    {
+        NodeObjectId objectId;
+        QVariant value;
+        bool write;
+    };
+    void addRead(const NodeObjectId &objectId);
+    void addWrite(const NodeObjectId &objectId, const QVariant &value);
+    int count() const;
+    const Item &item(int slot) const;
+
+    QFuture<NodeObjectResult> future();
+    void complete(int slot, const NodeObjectResult &result);
+    void cancel(int slot);
+    bool isAborted() const;
+
+private:
+    Mode _mode;
+    QVector<Item> _items;
+    QVector<NodeObjectResult> _results;
+    int _remaining;
+    bool _aborted;
+    QFutureInterface<NodeObjectResult> _futureInterface;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<SdoBatch>)
+
+#endif  // SDOBATCH_H
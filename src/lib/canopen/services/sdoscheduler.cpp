@@ -0,0 +1,176 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "sdoscheduler.h"
+
+#include "canopenbus.h"
+
+SdoScheduler::SdoScheduler(CanOpenBus *bus)
+    : _bus(bus)
+{
+    _maxActiveCount = DEFAULT_MAX_ACTIVE_COUNT;
+    _activeCount = 0;
+}
+
+int SdoScheduler::maxActiveCount() const
+{
+    return _maxActiveCount;
+}
+
+/**
+ * @brief Sets the maximum number of SDO transfers running at the same time on the bus, 0 for no limit
+ */
+void SdoScheduler::setMaxActiveCount(int maxActiveCount)
+{
+    _maxActiveCount = qMax(0, maxActiveCount);
+    grant();
+}
+
+/**
+ * @brief Requests a slot for the next request of sdo
+ * @return true if granted, otherwise sdo is queued and resumed by nextRequest() when a slot frees
+ */
+bool SdoScheduler::acquire(SDO *sdo, SDO::Priority priority)
+{
+    if (!_waitingPriority.contains(sdo) && hasFreeSlot())
+    {
+        _activeCount++;
+        return true;
+    }
+    wait(sdo, priority);
+    return false;
+}
+
+/**
+ * @brief Keeps the slot of sdo for its next request unless a client with a request of the same or
+ * a higher priority is waiting, in which case the slot is given to it and sdo is queued
+ */
+bool SdoScheduler::renew(SDO *sdo, SDO::Priority priority)
+{
+    for (int p = 0; p <= priority; p++)
+    {
+        if (!_waiting[p].isEmpty())
+        {
+            wait(sdo, priority);
+            release(sdo);
+            return false;
+        }
+    }
+    return true;
+}
+
+void SdoScheduler::release(SDO *sdo)
+{
+    Q_UNUSED(sdo)
+    if (_activeCount > 0)
+    {
+        _activeCount--;
+    }
+    grant();
+}
+
+/**
+ * @brief Forgets sdo, called when its node is removed from the bus
+ */
+void SdoScheduler::removeSdo(SDO *sdo)
+{
+    QHash<SDO *, int>::iterator it = _waitingPriority.find(sdo);
+    if (it != _waitingPriority.end())
+    {
+        _waiting[it.value()].removeOne(sdo);
+        _waitingPriority.erase(it);
+    }
+}
+
+int SdoScheduler::activeCount() const
+{
+    return _activeCount;
+}
+
+int SdoScheduler::waitingCount(SDO::Priority priority) const
+{
+    return _waiting[priority].count();
+}
+
+/**
+ * @brief Number of queued SDO requests of a priority class over all the nodes of the bus
+ */
+int SdoScheduler::pendingRequestCount(SDO::Priority priority) const
+{
+    int count = 0;
+    for (Node *node : _bus->nodes())
+    {
+        for (SDO *sdo : node->sdoClients())
+        {
+            count += sdo->queueDepth(priority);
+        }
+    }
+    return count;
+}
+
+int SdoScheduler::pendingRequestCount() const
+{
+    int count = 0;
+    for (int p = 0; p < SDO::PriorityCount; p++)
+    {
+        count += pendingRequestCount(static_cast<SDO::Priority>(p));
+    }
+    return count;
+}
+
+bool SdoScheduler::hasFreeSlot() const
+{
+    return (_maxActiveCount == 0 || _activeCount < _maxActiveCount);
+}
+
+void SdoScheduler::wait(SDO *sdo, SDO::Priority priority)
+{
+    QHash<SDO *, int>::iterator it = _waitingPriority.find(sdo);
+    if (it != _waitingPriority.end())
+    {
+        if (it.value() <= priority)
+        {
+            return;
+        }
+        // raised by a more urgent request
+        _waiting[it.value()].removeOne(sdo);
+        it.value() = priority;
+    }
+    else
+    {
+        _waitingPriority.insert(sdo, priority);
+    }
+    _waiting[priority].enqueue(sdo);
+}
+
+void SdoScheduler::grant()
+{
+    int p = 0;
+    while (hasFreeSlot() && p < SDO::PriorityCount)
+    {
+        if (_waiting[p].isEmpty())
+        {
+            p++;
+            continue;
+        }
+        SDO *sdo = _waiting[p].dequeue();
+        _waitingPriority.remove(sdo);
+        _activeCount++;
+        sdo->resume(this);
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SDOSCHEDULER_H
+#define SDOSCHEDULER_H
+
+#include "canopen_global.h"
+
+#include <QHash>
+#include <QQueue>
+
+#include "sdo.h"
+
+class CanOpenBus;
+
+/**
+ * @brief Bus wide budget of concurrent SDO transfers
+ *
+ * An SDO client takes a slot to run a request. When the budget is exhausted, clients wait by
+ * priority class of their next request, round robin inside a class, so that one node with a long
+ * queue cannot starve the others. The default budget is DEFAULT_MAX_ACTIVE_COUNT transfers, a
+ * budget of 0 means no limit.
+ *
+ * The scheduler and its metrics belong to the bus thread, they are not safe to call from another
+ * thread.
+ */
+class CANOPEN_EXPORT SdoScheduler
+{
+public:
+    SdoScheduler(CanOpenBus *bus);
+
+    enum
+    {
+        DEFAULT_MAX_ACTIVE_COUNT = 8
+    };
+
+    int maxActiveCount() const;
+    void setMaxActiveCount(int maxActiveCount);
+
+    bool acquire(SDO *sdo, SDO::Priority priority);
+    bool renew(SDO *sdo, SDO::Priority priority);
+    void release(SDO *sdo);
+    void removeSdo(SDO *sdo);
+
+    // metrics
+    int activeCount() const;
+    int waitingCount(SDO::Priority priority) const;
+    int pendingRequestCount(SDO::Priority priority) const;
+    int pendingRequestCount() const;
+
+private:
+    CanOpenBus *_bus;
+    int _maxActiveCount;
+    int _activeCount;
+    QQueue<SDO *> _waiting[SDO::PriorityCount];
+    QHash<SDO *, int> _waitingPriority;
+
+    bool hasFreeSlot() const;
+    void wait(SDO *sdo, SDO::Priority priority);
+    void grant();
+};
+
+#endif  // SDOSCHEDULER_H
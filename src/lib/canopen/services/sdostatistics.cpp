@@ -0,0 +1,374 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "sdostatistics.h"
+
+#include <QJsonArray>
+#include <QStringList>
+#include <QtAlgorithms>
+
+SdoLatencyHistogram::SdoLatencyHistogram()
+{
+    _counts.fill(0, BUCKET_COUNT);
+    reset();
+}
+
+void SdoLatencyHistogram::record(qint64 valueUs)
+{
+    valueUs = qBound<qint64>(0, valueUs, (Q_INT64_C(1) << MAX_VALUE_BITS) - 1);
+    _counts[bucketIndex(valueUs)]++;
+    if (_count == 0 || valueUs < _min)
+    {
+        _min = valueUs;
+    }
+    if (valueUs > _max)
+    {
+        _max = valueUs;
+    }
+    _count++;
+    _sum += valueUs;
+}
+
+void SdoLatencyHistogram::merge(const SdoLatencyHistogram &other)
+{
+    if (other._count == 0)
+    {
+        return;
+    }
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        _counts[i] += other._counts[i];
+    }
+    if (_count == 0 || other._min < _min)
+    {
+        _min = other._min;
+    }
+    _max = qMax(_max, other._max);
+    _count += other._count;
+    _sum += other._sum;
+}
+
+void SdoLatencyHistogram::reset()
+{
+    _counts.fill(0);
+    _count = 0;
+    _min = 0;
+    _max = 0;
+    _sum = 0;
+}
+
+qint64 SdoLatencyHistogram::count() const
+{
+    return _count;
+}
+
+qint64 SdoLatencyHistogram::min() const
+{
+    return _min;
+}
+
+qint64 SdoLatencyHistogram::max() const
+{
+    return _max;
+}
+
+qint64 SdoLatencyHistogram::mean() const
+{
+    if (_count == 0)
+    {
+        return 0;
+    }
+    return _sum / _count;
+}
+
+/**
+ * @brief Value under which percent % of the recorded values are, within the bucket resolution
+ */
+qint64 SdoLatencyHistogram::percentile(double percent) const
+{
+    if (_count == 0)
+    {
+        return 0;
+    }
+
+    qint64 rank = static_cast<qint64>(qBound(0.0, percent, 100.0) / 100.0 * static_cast<double>(_count) + 0.5);
+    rank = qBound<qint64>(1, rank, _count);
+    qint64 cumulated = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        cumulated += _counts[i];
+        if (cumulated >= rank)
+        {
+            return qBound(_min, bucketUpperValue(i), _max);
+        }
+    }
+    return _max;
+}
+
+QJsonObject SdoLatencyHistogram::toJson() const
+{
+    QJsonObject json;
+    json.insert(QStringLiteral("count"), _count);
+    json.insert(QStringLiteral("min"), _min);
+    json.insert(QStringLiteral("mean"), mean());
+    json.insert(QStringLiteral("p50"), percentile(50.0));
+    json.insert(QStringLiteral("p90"), percentile(90.0));
+    json.insert(QStringLiteral("p99"), percentile(99.0));
+    json.insert(QStringLiteral("p999"), percentile(99.9));
+    json.insert(QStringLiteral("max"), _max);
+
+    // non empty buckets only, as [upper value, count]
+    QJsonArray buckets;
+    for (int i = 0; i < BUCKET_COUNT; i++)
+    {
+        if (_counts[i] != 0)
+        {
+            buckets.append(QJsonArray{bucketUpperValue(i), static_cast<qint64>(_counts[i])});
+        }
+    }
+    json.insert(QStringLiteral("buckets"), buckets);
+    return json;
+}
+
+int SdoLatencyHistogram::bucketIndex(qint64 valueUs)
+{
+    if (valueUs < SUB_BUCKET_COUNT)
+    {
+        return static_cast<int>(valueUs);
+    }
+    int msb = 63 - static_cast<int>(qCountLeadingZeroBits(static_cast<quint64>(valueUs)));
+    int shift = msb - SUB_BUCKET_BITS + 1;
+    int subBucket = static_cast<int>(valueUs >> shift);
+    return SUB_BUCKET_COUNT + (shift - 1) * HALF_BUCKET_COUNT + (subBucket - HALF_BUCKET_COUNT);
+}
+
+qint64 SdoLatencyHistogram::bucketUpperValue(int index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+    int k = index - SUB_BUCKET_COUNT;
+    int shift = k / HALF_BUCKET_COUNT + 1;
+    qint64 subBucket = k % HALF_BUCKET_COUNT + HALF_BUCKET_COUNT;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+SdoStatistics::SdoStatistics()
+{
+    reset();
+}
+
+/**
+ * @brief Time spent by a request in the queue before being sent
+ */
+void SdoStatistics::recordQueueWait(qint64 waitUs)
+{
+    _queueWait.record(waitUs);
+}
+
+void SdoStatistics::recordRequest(bool download, quint32 bytes, qint64 latencyUs)
+{
+    if (download)
+    {
+        _downloadCount++;
+        _downloadedBytes += bytes;
+    }
+    else
+    {
+        _uploadCount++;
+        _uploadedBytes += bytes;
+    }
+    if (bytes > 4)
+    {
+        _transferBytes += bytes;
+        _transferTimeUs += latencyUs;
+    }
+    _latency.record(latencyUs);
+}
+
+void SdoStatistics::recordAbort(quint32 abortCode, qint64 latencyUs)
+{
+    _abortCount++;
+    _abortCodes[abortCode]++;
+    _latency.record(latencyUs);
+}
+
+void SdoStatistics::recordTimeout()
+{
+    _timeoutCount++;
+}
+
+void SdoStatistics::recordRetry()
+{
+    _retryCount++;
+}
+
+void SdoStatistics::merge(const SdoStatistics &other)
+{
+    _uploadCount += other._uploadCount;
+    _downloadCount += other._downloadCount;
+    _abortCount += other._abortCount;
+    _timeoutCount += other._timeoutCount;
+    _retryCount += other._retryCount;
+    for (QMap<quint32, qint64>::const_iterator it = other._abortCodes.cbegin(); it != other._abortCodes.cend(); ++it)
+    {
+        _abortCodes[it.key()] += it.value();
+    }
+    _uploadedBytes += other._uploadedBytes;
+    _downloadedBytes += other._downloadedBytes;
+    _transferBytes += other._transferBytes;
+    _transferTimeUs += other._transferTimeUs;
+    _latency.merge(other._latency);
+    _queueWait.merge(other._queueWait);
+}
+
+void SdoStatistics::reset()
+{
+    _uploadCount = 0;
+    _downloadCount = 0;
+    _abortCount = 0;
+    _timeoutCount = 0;
+    _retryCount = 0;
+    _abortCodes.clear();
+    _uploadedBytes = 0;
+    _downloadedBytes = 0;
+    _transferBytes = 0;
+    _transferTimeUs = 0;
+    _latency.reset();
+    _queueWait.reset();
+}
+
+/**
+ * @brief Ended requests, succeeded or aborted
+ */
+qint64 SdoStatistics::requestCount() const
+{
+    return _uploadCount + _downloadCount + _abortCount;
+}
+
+qint64 SdoStatistics::uploadCount() const
+{
+    return _uploadCount;
+}
+
+qint64 SdoStatistics::downloadCount() const
+{
+    return _downloadCount;
+}
+
+qint64 SdoStatistics::abortCount() const
+{
+    return _abortCount;
+}
+
+qint64 SdoStatistics::timeoutCount() const
+{
+    return _timeoutCount;
+}
+
+qint64 SdoStatistics::retryCount() const
+{
+    return _retryCount;
+}
+
+/**
+ * @brief Number of aborts by SDO abort code
+ */
+const QMap<quint32, qint64> &SdoStatistics::abortCodes() const
+{
+    return _abortCodes;
+}
+
+qint64 SdoStatistics::uploadedBytes() const
+{
+    return _uploadedBytes;
+}
+
+qint64 SdoStatistics::downloadedBytes() const
+{
+    return _downloadedBytes;
+}
+
+/**
+ * @brief Mean throughput of segmented and block transfers
+ */
+double SdoStatistics::transferBytesPerSecond() const
+{
+    if (_transferTimeUs == 0)
+    {
+        return 0.0;
+    }
+    return static_cast<double>(_transferBytes) * 1000000.0 / static_cast<double>(_transferTimeUs);
+}
+
+const SdoLatencyHistogram &SdoStatistics::latency() const
+{
+    return _latency;
+}
+
+const SdoLatencyHistogram &SdoStatistics::queueWait() const
+{
+    return _queueWait;
+}
+
+QJsonObject SdoStatistics::toJson() const
+{
+    QJsonObject json;
+    json.insert(QStringLiteral("requests"), requestCount());
+    json.insert(QStringLiteral("uploads"), _uploadCount);
+    json.insert(QStringLiteral("downloads"), _downloadCount);
+    json.insert(QStringLiteral("aborts"), _abortCount);
+    json.insert(QStringLiteral("timeouts"), _timeoutCount);
+    json.insert(QStringLiteral("retries"), _retryCount);
+    json.insert(QStringLiteral("uploadedBytes"), _uploadedBytes);
+    json.insert(QStringLiteral("downloadedBytes"), _downloadedBytes);
+    json.insert(QStringLiteral("transferBytesPerSecond"), transferBytesPerSecond());
+
+    QJsonObject abortCodes;
+    for (QMap<quint32, qint64>::const_iterator it = _abortCodes.cbegin(); it != _abortCodes.cend(); ++it)
+    {
+        abortCodes.insert(QStringLiteral("0x") + QString::number(it.key(), 16).rightJustified(8, QLatin1Char('0')).toUpper(), it.value());
+    }
+    json.insert(QStringLiteral("abortCodes"), abortCodes);
+
+    json.insert(QStringLiteral("latencyUs"), _latency.toJson());
+    json.insert(QStringLiteral("queueWaitUs"), _queueWait.toJson());
+    return json;
+}
+
+QString SdoStatistics::csvHeader()
+{
+    return QStringLiteral(
+        "name;requests;uploads;downloads;aborts;timeouts;retries;uploadedBytes;downloadedBytes;transferBytesPerSecond;"
+        "latencyMeanUs;latencyP50Us;latencyP99Us;latencyMaxUs;queueWaitMeanUs;queueWaitP99Us");
+}
+
+/**
+ * @brief One CSV row matching csvHeader(), abort codes are only in the JSON export
+ */
+QString SdoStatistics::toCsv(const QString &name) const
+{
+    QStringList fields;
+    fields << name << QString::number(requestCount()) << QString::number(_uploadCount) << QString::number(_downloadCount)
+           << QString::number(_abortCount) << QString::number(_timeoutCount) << QString::number(_retryCount) << QString::number(_uploadedBytes)
+           << QString::number(_downloadedBytes) << QString::number(transferBytesPerSecond(), 'f', 1) << QString::number(_latency.mean())
+           << QString::number(_latency.percentile(50.0)) << QString::number(_latency.percentile(99.0)) << QString::number(_latency.max())
+           << QString::number(_queueWait.mean()) << QString::number(_queueWait.percentile(99.0));
+    return fields.join(QLatin1Char(';'));
+}
@@ -0,0 +1,131 @@
+/**
+ ** This file is part of the UDTStudio project.
+ ** Copyright 2019-2024 UniSwarm
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SDOSTATISTICS_H
+#define SDOSTATISTICS_H
+
+#include "canopen_global.h"
+
+#include <QJsonObject>
+#include <QMap>
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Latency histogram with a bounded relative error, HDR histogram style
+ *
+ * Values (us) below 32 have their own bucket, then each power of two is split into 16 buckets,
+ * so a bucket covers at most 1/16 of its values. Values are clamped to 2^31 us.
+ */
+class CANOPEN_EXPORT SdoLatencyHistogram
+{
+public:
+    SdoLatencyHistogram();
+
+    void record(qint64 valueUs);
+    void merge(const SdoLatencyHistogram &other);
+    void reset();
+
+    qint64 count() const;
+    qint64 min() const;
+    qint64 max() const;
+    qint64 mean() const;
+    qint64 percentile(double percent) const;
+
+    QJsonObject toJson() const;
+
+private:
+    enum
+    {
+        SUB_BUCKET_BITS = 5,
+        SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS,
+        HALF_BUCKET_COUNT = SUB_BUCKET_COUNT / 2,
+        MAX_VALUE_BITS = 31,
+        BUCKET_COUNT = SUB_BUCKET_COUNT + (MAX_VALUE_BITS - SUB_BUCKET_BITS) * HALF_BUCKET_COUNT
+    };
+    static int bucketIndex(qint64 valueUs);
+    static qint64 bucketUpperValue(int index);
+
+    QVector<quint32> _counts;
+    qint64 _count;
+    qint64 _min;
+    qint64 _max;
+    qint64 _sum;
+};
+
+/**
+ * @brief Counters and latency histograms of SDO transactions, per client channel, merged per
+ * node or per bus
+ */
+class CANOPEN_EXPORT SdoStatistics
+{
+public:
+    SdoStatistics();
+
+    void recordQueueWait(qint64 waitUs);
+    void recordRequest(bool download, quint32 bytes, qint64 latencyUs);
+    void recordAbort(quint32 abortCode, qint64 latencyUs);
+    void recordTimeout();
+    void recordRetry();
+
+    void merge(const SdoStatistics &other);
+    void reset();
+
+    qint64 requestCount() const;
+    qint64 uploadCount() const;
+    qint64 downloadCount() const;
+    qint64 abortCount() const;
+    qint64 timeoutCount() const;
+    qint64 retryCount() const;
+    const QMap<quint32, qint64> &abortCodes() const;
+
+    qint64 uploadedBytes() const;
+    qint64 downloadedBytes() const;
+    double transferBytesPerSecond() const;
+
+    const SdoLatencyHistogram &latency() const;
+    const SdoLatencyHistogram &queueWait() const;
+
+    // export
+    QJsonObject toJson() const;
+    static QString csvHeader();
+    QString toCsv(const QString &name) const;
+
+private:
+    qint64 _uploadCount;
+    qint64 _downloadCount;
+    qint64 _abortCount;
+    qint64 _timeoutCount;
+    qint64 _retryCount;
+    QMap<quint32, qint64> _abortCodes;
+
+    qint64 _uploadedBytes;
+    qint64 _downloadedBytes;
+
+    // segmented and block transfers only, expedited ones are latency bound
+    qint64 _transferBytes;
+    qint64 _transferTimeUs;
+
+    SdoLatencyHistogram _latency;
+    SdoLatencyHistogram _queueWait;
+};
+
+Q_DECLARE_METATYPE(SdoStatistics)
+
+#endif  // SDOSTATISTICS_H
@@ -22,9 +22,12 @@
 #include "node.h"
 #include <QDebug>
 
+#include <algorithm>
+
 ServiceDispatcher::ServiceDispatcher(CanOpenBus *bus)
     : Service(bus)
 {
+    _dispatchDepth = 0;
 }
 
 ServiceDispatcher::~ServiceDispatcher()
@@ -38,27 +41,157 @@ QString ServiceDispatcher::type() const
 
 void ServiceDispatcher::addService(Service *service)
 {
-    for (quint32 cobId : service->cobIds())
+    if (_dispatchDepth > 0)
+    {
+        _pendingOperations.append(PendingOperation{service, true});
+    }
+    else
     {
-        _servicesMap.insert(cobId, service);
+        insertService(service);
     }
+    emit registeredCobIdsChanged();
 }
 
 void ServiceDispatcher::removeService(Service *service)
+{
+    if (_dispatchDepth > 0)
+    {
+        _pendingOperations.append(PendingOperation{service, false});
+    }
+    else
+    {
+        eraseService(service);
+    }
+    emit registeredCobIdsChanged();
+}
+
+/**
+ * @brief List of all the COB-IDs with at least one service registered
+ */
+QList<quint32> ServiceDispatcher::registeredCobIds() const
+{
+    QList<quint32> cobIds;
+    for (quint32 cobId = 0; cobId < 0x800; cobId++)
+    {
+        if (!_standardServices[cobId].isEmpty())
+        {
+            cobIds.append(cobId);
+        }
+    }
+    QList<quint32> extendedCobIds = _extendedServices.keys();
+    std::sort(extendedCobIds.begin(), extendedCobIds.end());
+    cobIds.append(extendedCobIds);
+
+    // pending registrations
+    for (const PendingOperation &operation : _pendingOperations)
+    {
+        if (operation.add)
+        {
+            for (quint32 cobId : operation.service->cobIds())
+            {
+                if (!cobIds.contains(cobId))
+                {
+                    cobIds.append(cobId);
+                }
+            }
+        }
+    }
+    return cobIds;
+}
+
+const ServiceDispatcher::ServiceList *ServiceDispatcher::servicesForCobId(quint32 cobId) const
+{
+    if (cobId < 0x800)
+    {
+        return &_standardServices[cobId];
+    }
+
+    QHash<quint32, ServiceList>::const_iterator it = _extendedServices.constFind(cobId);
+    if (it == _extendedServices.constEnd())
+    {
+        return nullptr;
+    }
+    return &it.value();
+}
+
+void ServiceDispatcher::insertService(Service *service)
 {
     for (quint32 cobId : service->cobIds())
     {
-        _servicesMap.remove(cobId, service);
+        // last registered service is called first
+        if (cobId < 0x800)
+        {
+            _standardServices[cobId].prepend(service);
+        }
+        else
+        {
+            _extendedServices[cobId].prepend(service);
+        }
+    }
+}
+
+void ServiceDispatcher::eraseService(Service *service)
+{
+    for (quint32 cobId : service->cobIds())
+    {
+        ServiceList *services;
+        if (cobId < 0x800)
+        {
+            services = &_standardServices[cobId];
+        }
+        else
+        {
+            QHash<quint32, ServiceList>::iterator it = _extendedServices.find(cobId);
+            if (it == _extendedServices.end())
+            {
+                continue;
+            }
+            services = &it.value();
+        }
+
+        for (int i = services->count() - 1; i >= 0; i--)
+        {
+            if (services->at(i) == service)
+            {
+                services->remove(i);
+            }
+        }
+
+        if (cobId >= 0x800 && services->isEmpty())
+        {
+            _extendedServices.remove(cobId);
+        }
     }
 }
 
 void ServiceDispatcher::parseFrame(const QCanBusFrame &frame)
 {
-    QList<Service *> interrestedServices = _servicesMap.values(frame.frameId());
-    QList<Service *>::const_iterator service = interrestedServices.cbegin();
-    while (service != interrestedServices.cend())
+    const ServiceList *services = servicesForCobId(frame.frameId());
+    if (services == nullptr || services->isEmpty())
+    {
+        return;
+    }
+
+    _dispatchDepth++;
+    for (Service *service : *services)
+    {
+        service->parseFrame(frame);
+    }
+    _dispatchDepth--;
+
+    if (_dispatchDepth == 0 && !_pendingOperations.isEmpty())
     {
-        (*service)->parseFrame(frame);
-        ++service;
+        for (const PendingOperation &operation : qAsConst(_pendingOperations))
+        {
+            if (operation.add)
+            {
+                insertService(operation.service);
+            }
+            else
+            {
+                eraseService(operation.service);
+            }
+        }
+        _pendingOperations.clear();
     }
 }
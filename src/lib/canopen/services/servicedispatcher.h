@@ -23,7 +23,9 @@
 
 #include "service.h"
 
-#include <QMultiMap>
+#include <QHash>
+#include <QVarLengthArray>
+#include <QVector>
 
 class CANOPEN_EXPORT ServiceDispatcher : public Service
 {
@@ -35,8 +37,28 @@ public:
     void addService(Service *service);
     void removeService(Service *service);
 
+    QList<quint32> registeredCobIds() const;
+
+signals:
+    void registeredCobIdsChanged();
+
 protected:
-    QMultiMap<quint32, Service *> _servicesMap;
+    typedef QVarLengthArray<Service *, 2> ServiceList;
+    ServiceList _standardServices[0x800];           // 11 bits COB-IDs, direct indexed
+    QHash<quint32, ServiceList> _extendedServices;  // 29 bits COB-IDs
+    const ServiceList *servicesForCobId(quint32 cobId) const;
+
+    void insertService(Service *service);
+    void eraseService(Service *service);
+
+    // registrations changed during a dispatch are applied after it
+    struct PendingOperation
+    {
+        Service *service;
+        bool add;
+    };
+    QVector<PendingOperation> _pendingOperations;
+    int _dispatchDepth;
 
     // Service interface
 public:
@@ -20,6 +20,18 @@
 
 #include "canopenbus.h"
 
+#include <QDebug>
+#include <QThread>
+
+#include <cmath>
+
+#ifdef Q_OS_LINUX
+#    include <pthread.h>
+#    include <sched.h>
+#    include <string.h>
+#    include <time.h>
+#endif
+
 const quint8 ONE_SHOT_TIMER = 20;
 
 Sync::Sync(CanOpenBus *bus)
@@ -28,20 +40,17 @@ Sync::Sync(CanOpenBus *bus)
     _syncCobId = 0x80;
     _cobIds.append(_syncCobId);
     _status = STOPPED;
-
-    _syncTimer = new QTimer();
-    _syncTimer->setTimerType(Qt::PreciseTimer);
-    connect(_syncTimer, &QTimer::timeout, this, &Sync::sendSync);
-
-    _signalBeforeSync = new QTimer();
-    _signalBeforeSync->setTimerType(Qt::PreciseTimer);
-    connect(_signalBeforeSync, &QTimer::timeout, this, &Sync::signalBeforeSync);
+    _periodMs = 0;
+    _counterOverflow = 0;
+    _counter = 0;
+    _realTimePriority = 0;
+    _timerThread = nullptr;
+    resetStatistics();
 }
 
 Sync::~Sync()
 {
-    delete _syncTimer;
-    delete _signalBeforeSync;
+    delete _timerThread;
 }
 
 QString Sync::type() const
@@ -49,25 +58,181 @@ QString Sync::type() const
     return QStringLiteral("Sync");
 }
 
+/**
+ * @brief Starts the SYNC producer thread, restarts it with the new period if already started
+ */
 void Sync::startSync(int ms)
 {
-    _syncTimer->start(ms);
-    _signalBeforeSync->start((ms * 3) / 4);
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "startSync", Qt::QueuedConnection, Q_ARG(int, ms));
+        return;
+    }
+    delete _timerThread;
+    _timerThread = nullptr;
+    if (ms <= 0)
+    {
+        _status = STOPPED;
+        return;
+    }
+
+    _periodMs = ms;
+    _counterMutex.lock();
+    _counter = 0;
+    _counterMutex.unlock();
+    _statisticsMutex.lock();
+    _statistics.periodUs = static_cast<qint64>(ms) * 1000;
+    _lastSyncNs = -1;
+    _statisticsMutex.unlock();
+
+    CanBusDriver *driver = bus()->canBusDriver();
+    if ((driver != nullptr) && !driver->canWriteFromAnyThread())
+    {
+        driver = nullptr;
+    }
+    _timerThread = new SyncTimerThread(this, ms * 1000, _realTimePriority, driver);
+    connect(_timerThread, &SyncTimerThread::beforeSync, this, &Sync::signalBeforeSync);
+    connect(_timerThread, &SyncTimerThread::syncTriggered, this, &Sync::syncTriggered);
+    _timerThread->start(QThread::TimeCriticalPriority);
     _status = STARTED;
 }
 
 void Sync::stopSync()
 {
-    _syncTimer->stop();
-    _signalBeforeSync->stop();
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "stopSync", Qt::QueuedConnection);
+        return;
+    }
+    delete _timerThread;
+    _timerThread = nullptr;
+    _periodMs = 0;
     _status = STOPPED;
 }
 
+int Sync::periodMs() const
+{
+    return _periodMs;
+}
+
 Sync::Status Sync::status()
 {
     return _status;
 }
 
+int Sync::realTimePriority() const
+{
+    return _realTimePriority;
+}
+
+/**
+ * @brief SCHED_FIFO needs CAP_SYS_NICE or a rtprio limit, the default scheduling is kept otherwise
+ */
+void Sync::setRealTimePriority(int priority)
+{
+    _realTimePriority = qBound(0, priority, 99);
+    if (_timerThread != nullptr)
+    {
+        startSync(_periodMs);
+    }
+}
+
+quint8 Sync::counterOverflow() const
+{
+    return _counterOverflow;
+}
+
+/**
+ * @brief Counter overflow value, 0 or 1 disables the counter, else the counter goes from 1 to
+ * counterOverflow (max 240). A running producer is restarted, which resets the counter.
+ */
+void Sync::setCounterOverflow(quint8 counterOverflow)
+{
+    if (counterOverflow < 2)
+    {
+        counterOverflow = 0;
+    }
+    _counterMutex.lock();
+    _counterOverflow = qMin(counterOverflow, static_cast<quint8>(240));
+    _counterMutex.unlock();
+    if (_timerThread != nullptr)
+    {
+        startSync(_periodMs);
+    }
+}
+
+Sync::Statistics Sync::statistics() const
+{
+    QMutexLocker locker(&_statisticsMutex);
+    Statistics statistics = _statistics;
+    statistics.jitterUs = (_periodCount > 1) ? std::sqrt(_periodM2 / static_cast<double>(_periodCount - 1)) : 0.0;
+    return statistics;
+}
+
+void Sync::resetStatistics()
+{
+    QMutexLocker locker(&_statisticsMutex);
+    _statistics.count = 0;
+    _statistics.skippedCount = 0;
+    _statistics.periodUs = static_cast<qint64>(_periodMs) * 1000;
+    _statistics.minPeriodUs = 0;
+    _statistics.maxPeriodUs = 0;
+    _statistics.meanPeriodUs = 0.0;
+    _statistics.jitterUs = 0.0;
+    _statistics.maxLatenessUs = 0;
+    _periodCount = 0;
+    _periodM2 = 0.0;
+    _lastSyncNs = -1;
+}
+
+/**
+ * @brief Called by the producer thread after each SYNC
+ */
+void Sync::recordSync(qint64 syncNs, qint64 latenessNs, int skipped)
+{
+    QMutexLocker locker(&_statisticsMutex);
+    _statistics.count++;
+    _statistics.skippedCount += static_cast<quint64>(skipped);
+    _statistics.maxLatenessUs = qMax(_statistics.maxLatenessUs, latenessNs / 1000);
+
+    // no period before the first SYNC of the producer
+    if (_lastSyncNs >= 0)
+    {
+        qint64 periodUs = (syncNs - _lastSyncNs) / 1000;
+        _periodCount++;
+        if (_periodCount == 1)
+        {
+            _statistics.minPeriodUs = periodUs;
+            _statistics.maxPeriodUs = periodUs;
+        }
+        _statistics.minPeriodUs = qMin(_statistics.minPeriodUs, periodUs);
+        _statistics.maxPeriodUs = qMax(_statistics.maxPeriodUs, periodUs);
+
+        // running mean and variance
+        double delta = static_cast<double>(periodUs) - _statistics.meanPeriodUs;
+        _statistics.meanPeriodUs += delta / static_cast<double>(_periodCount);
+        _periodM2 += delta * (static_cast<double>(periodUs) - _statistics.meanPeriodUs);
+    }
+    _lastSyncNs = syncNs;
+}
+
+/**
+ * @brief Builds the next SYNC frame, called by the producer thread and by the Sync one
+ */
+QCanBusFrame Sync::nextSyncFrame()
+{
+    QCanBusFrame frameSync;
+    frameSync.setFrameId(_syncCobId);
+    QMutexLocker locker(&_counterMutex);
+    if (_counterOverflow != 0)
+    {
+        _counter = (_counter >= _counterOverflow) ? 1 : _counter + 1;
+        char counter = static_cast<char>(_counter);
+        frameSync.setPayload(&counter, 1);
+    }
+    return frameSync;
+}
+
 void Sync::sendSync()
 {
     if (!bus()->canWrite())
@@ -75,9 +240,27 @@ void Sync::sendSync()
         return;
     }
 
-    QCanBusFrame frameSync;
-    frameSync.setFrameId(_syncCobId);
-    bus()->writeFrame(frameSync);
+    bus()->writeFrame(nextSyncFrame());
+    emit syncEmitted();
+}
+
+/**
+ * @brief SYNC deadline of the producer thread, the frame is already written if sent is true
+ */
+void Sync::syncTriggered(const QCanBusFrame &frame, bool sent)
+{
+    if (sent)
+    {
+        bus()->logFrame(frame);
+    }
+    else
+    {
+        if (_status != STARTED || !bus()->canWrite())
+        {
+            return;
+        }
+        bus()->writeFrame(frame);
+    }
     emit syncEmitted();
 }
 
@@ -89,6 +272,11 @@ void Sync::sendSyncOneTimeout()
 
 void Sync::sendSyncOne()
 {
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, "sendSyncOne", Qt::QueuedConnection);
+        return;
+    }
     if (_status == STARTED)
     {
         return;
@@ -100,8 +288,120 @@ void Sync::sendSyncOne()
 
 void Sync::parseFrame(const QCanBusFrame &frame)
 {
-    if (frame.frameId() == _syncCobId && frame.payload().isEmpty())
+    // SYNC of another producer, with or without counter
+    if (frame.frameId() == _syncCobId && frame.payloadSize() <= 1)
     {
         emit syncEmitted();
     }
 }
+
+SyncTimerThread::SyncTimerThread(Sync *sync, int periodUs, int realTimePriority, CanBusDriver *driver)
+{
+    _sync = sync;
+    _periodNs = static_cast<qint64>(periodUs) * 1000;
+    _realTimePriority = realTimePriority;
+    _driver = driver;
+    _clock.start();
+}
+
+SyncTimerThread::~SyncTimerThread()
+{
+    requestInterruption();
+    wait();
+}
+
+void SyncTimerThread::run()
+{
+#ifdef Q_OS_LINUX
+    if (_realTimePriority > 0)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = _realTimePriority;
+        int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (ret != 0)
+        {
+            qWarning() << "Sync: cannot set SCHED_FIFO priority" << _realTimePriority << strerror(ret);
+        }
+    }
+#endif
+
+    qint64 deadlineNs = clockNs() + _periodNs;
+    while (!isInterruptionRequested())
+    {
+        // RPDOs are prepared by the bus thread a quarter of period before the SYNC
+        if (!sleepUntil(deadlineNs - _periodNs / 4))
+        {
+            break;
+        }
+        emit beforeSync();
+
+        if (!sleepUntil(deadlineNs))
+        {
+            break;
+        }
+        qint64 syncNs = clockNs();
+
+        QCanBusFrame frame = _sync->nextSyncFrame();
+        bool sent = false;
+        // the driver write fails if it is not connected, spy mode is an atomic flag of the bus
+        if ((_driver != nullptr) && !_sync->bus()->isSpyMode())
+        {
+            sent = _driver->writeFrame(frame);
+            if (sent)
+            {
+                frame.setTimeStamp(CanBusDriver::currentTimeStamp());
+                frame.setLocalEcho(true);
+            }
+        }
+        emit syncTriggered(frame, sent);
+
+        // a late producer skips the missed SYNC instead of sending them in a burst
+        qint64 latenessNs = syncNs - deadlineNs;
+        int skipped = 0;
+        deadlineNs += _periodNs;
+        if (syncNs >= deadlineNs)
+        {
+            skipped = static_cast<int>((syncNs - deadlineNs) / _periodNs) + 1;
+            deadlineNs += skipped * _periodNs;
+        }
+        _sync->recordSync(syncNs, latenessNs, skipped);
+    }
+}
+
+qint64 SyncTimerThread::clockNs() const
+{
+#ifdef Q_OS_LINUX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return _clock.nsecsElapsed();
+#endif
+}
+
+/**
+ * @brief Sleeps until an absolute deadline of clockNs()
+ * @return false if the thread has to stop
+ */
+bool SyncTimerThread::sleepUntil(qint64 deadlineNs)
+{
+    while (!isInterruptionRequested())
+    {
+        qint64 nowNs = clockNs();
+        if (nowNs >= deadlineNs)
+        {
+            return true;
+        }
+        qint64 wakeNs = qMin(deadlineNs, nowNs + static_cast<qint64>(MAX_SLEEP_US) * 1000);
+#ifdef Q_OS_LINUX
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(wakeNs / 1000000000);
+        ts.tv_nsec = static_cast<long>(wakeNs % 1000000000);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);  // EINTR only loops
+#else
+        QThread::usleep(static_cast<unsigned long>((wakeNs - nowNs + 999) / 1000));
+#endif
+    }
+    return false;
+}
@@ -23,8 +23,14 @@
 
 #include "service.h"
 
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
 #include <QTimer>
 
+class CanBusDriver;
+class SyncTimerThread;
+
 class CANOPEN_EXPORT Sync : public Service
 {
     Q_OBJECT
@@ -32,8 +38,9 @@ public:
     Sync(CanOpenBus *bus);
     ~Sync() override;
 
-    void startSync(int ms);
-    void stopSync();
+    Q_INVOKABLE void startSync(int ms);
+    Q_INVOKABLE void stopSync();
+    int periodMs() const;
 
     enum Status
     {
@@ -42,12 +49,36 @@ public:
     };
     Status status();
 
+    // SCHED_FIFO priority of the producer thread (1 to 99), 0 for the default scheduling
+    int realTimePriority() const;
+    void setRealTimePriority(int priority);
+
+    // CiA 301 synchronous counter overflow value (0x1019), 0 sends SYNC without counter
+    quint8 counterOverflow() const;
+    void setCounterOverflow(quint8 counterOverflow);
+
+    // SYNC period measured by the producer thread
+    struct Statistics
+    {
+        quint64 count;
+        quint64 skippedCount;  // SYNC not sent because the producer was late by more than a period
+        qint64 periodUs;       // nominal period
+        qint64 minPeriodUs;
+        qint64 maxPeriodUs;
+        double meanPeriodUs;
+        double jitterUs;       // standard deviation of the period
+        qint64 maxLatenessUs;  // worst wake up delay after a deadline
+    };
+    Statistics statistics() const;
+    void resetStatistics();
+
 public slots:
     void sendSyncOne();
 
 private slots:
     void sendSync();
     void sendSyncOneTimeout();
+    void syncTriggered(const QCanBusFrame &frame, bool sent);
 
 signals:
     void syncEmitted();
@@ -56,9 +87,23 @@ signals:
 
 private:
     Status _status;
-    QTimer *_syncTimer;
-    QTimer *_signalBeforeSync;
+    int _periodMs;
     uint32_t _syncCobId;
+    quint8 _counterOverflow;
+    quint8 _counter;
+    QMutex _counterMutex;  // counter and overflow, used by the producer thread and the Sync one
+    int _realTimePriority;
+    SyncTimerThread *_timerThread;
+
+    friend class SyncTimerThread;
+    QCanBusFrame nextSyncFrame();
+
+    Statistics _statistics;
+    quint64 _periodCount;
+    double _periodM2;  // sum of squared deviations of the period (Welford)
+    qint64 _lastSyncNs;
+    mutable QMutex _statisticsMutex;
+    void recordSync(qint64 syncNs, qint64 latenessNs, int skipped);
 
     // Service interface
 public:
@@ -66,4 +111,39 @@ public:
     void parseFrame(const QCanBusFrame &frame) override;
 };
 
+/**
+ * @brief SYNC producer, sleeps until absolute deadlines of a monotonic clock
+ *
+ * signalBeforeSync is emitted a quarter of period before each SYNC. The SYNC is written
+ * directly to the driver when it allows it, else it is sent by the Sync event loop.
+ */
+class SyncTimerThread : public QThread
+{
+    Q_OBJECT
+public:
+    SyncTimerThread(Sync *sync, int periodUs, int realTimePriority, CanBusDriver *driver);
+    ~SyncTimerThread() override;
+
+    enum
+    {
+        MAX_SLEEP_US = 50000  // interruption requests are checked at least at this rate
+    };
+
+signals:
+    void beforeSync();
+    void syncTriggered(const QCanBusFrame &frame, bool sent);
+
+    // QThread interface
+protected:
+    void run() override;
+    Sync *_sync;
+    qint64 _periodNs;
+    int _realTimePriority;
+    CanBusDriver *_driver;  // nullptr if the driver cannot be written from this thread
+    QElapsedTimer _clock;
+
+    qint64 clockNs() const;
+    bool sleepUntil(qint64 deadlineNs);
+};
+
 #endif  // SYNC_H
@@ -19,11 +19,11 @@
 #include "tpdo.h"
 
 #include <QDebug>
-#include <QIODevice>
+#include <QtEndian>
 
 #include "canopenbus.h"
 
-#include <QDataStream>
+#include <cstring>
 
 TPDO::TPDO(Node *node, quint8 number)
     : PDO(node, number)
@@ -52,7 +52,7 @@ QString TPDO::type() const
 
 void TPDO::parseFrame(const QCanBusFrame &frame)
 {
-    if (_currentMappedObjectsId.isEmpty())
+    if (_mappingPlan.isEmpty())
     {
         return;
     }
@@ -60,14 +60,30 @@ void TPDO::parseFrame(const QCanBusFrame &frame)
     QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(frame.timeStamp().seconds() * 1000 + frame.timeStamp().microSeconds() / 1000);
     _lastFrameDateTime = dateTime;
 
-    quint8 offset = 0;
-    for (const NodeObjectId &mappedObjectId : _currentMappedObjectsId)
+    // the whole payload as a little endian bit field
+    char payload[8] = {};
+    int payloadSize = qMin(frame.payloadSize(), 8);
+    memcpy(payload, frame.payloadData(), static_cast<size_t>(payloadSize));
+    quint64 bits = qFromLittleEndian<quint64>(payload);
+
+    NodeOd *nodeOd = _node->nodeOd();
+    for (const MappingSlot &slot : qAsConst(_mappingPlan))
     {
-        QByteArray data = frame.payload().mid(offset, QMetaType::sizeOf(mappedObjectId.dataType()));
-        QVariant vata = convertQByteArrayToQVariant(data, mappedObjectId.dataType());
+        if (slot.bitOffset + slot.bitSize > payloadSize * 8)
+        {
+            break;  // frame shorter than the mapping
+        }
+        if (slot.nodeSubIndex == nullptr)
+        {
+            continue;
+        }
 
-        _node->nodeOd()->updateObjectFromDevice(mappedObjectId.index(), mappedObjectId.subIndex(), vata, NodeOd::FlagsRequest::Pdo, dateTime);
-        offset += QMetaType::sizeOf(mappedObjectId.dataType());
+        quint64 raw = bits >> slot.bitOffset;
+        if (slot.bitSize < 64)
+        {
+            raw &= (Q_UINT64_C(1) << slot.bitSize) - 1;
+        }
+        nodeOd->updateObjectFromDevice(slot.nodeSubIndex, slotValue(slot, raw), NodeOd::FlagsRequest::Pdo, dateTime);
     }
 
     emit tpdoReceived(_pdoNumber);
@@ -131,116 +147,60 @@ void TPDO::receiveSync()
 {
 }
 
-QVariant TPDO::convertQByteArrayToQVariant(QByteArray data, QMetaType::Type type)
+/**
+ * @brief Converts the raw bits of a mapped object to the QVariant stored in the od
+ * @param slot mapping of the object
+ * @param raw bits of the object, aligned on bit 0
+ * @return value
+ */
+QVariant TPDO::slotValue(const MappingSlot &slot, quint64 raw)
 {
-    QDataStream dataStream(&data, QIODevice::ReadOnly);
-    dataStream.setByteOrder(QDataStream::LittleEndian);
-
-    switch (type)
+    if (slot.isSigned && slot.bitSize < 64 && ((raw >> (slot.bitSize - 1)) & 1) != 0)
     {
-        case QMetaType::Int:
-        {
-            int a;
-            dataStream >> a;
-            return QVariant(a);
-        }
-
-        case QMetaType::UInt:
-        {
-            unsigned int b;
-            dataStream >> b;
-            return QVariant(b);
-        }
-
-        case QMetaType::LongLong:
-        {
-            qint64 c;
-            dataStream >> c;
-            return QVariant(c);
-        }
+        raw |= ~Q_UINT64_C(0) << slot.bitSize;  // sign extension
+    }
 
-        case QMetaType::ULongLong:
-        {
-            quint64 d;
-            dataStream >> d;
-            return QVariant(d);
-        }
+    switch (slot.type)
+    {
+        case QMetaType::UChar:
+            return QVariant::fromValue(static_cast<unsigned char>(raw));
 
-        case QMetaType::Double:
-        {
-            double e;
-            dataStream >> e;
-            return QVariant(e);
-        }
+        case QMetaType::SChar:
+            return QVariant::fromValue(static_cast<signed char>(raw));
 
-        case QMetaType::Long:
-        {
-            long f;
-            memcpy(&f, data.constData(), sizeof(long));
-            QVariant w;
-            w.setValue(f);
-            return w;
-        }
+        case QMetaType::UShort:
+            return QVariant::fromValue(static_cast<unsigned short>(raw));
 
         case QMetaType::Short:
-        {
-            short g;
-            dataStream >> g;
-            return QVariant(g);
-        }
+            return QVariant(static_cast<short>(raw));
 
-        case QMetaType::Char:
-            return QVariant(data);
+        case QMetaType::UInt:
+            return QVariant(static_cast<unsigned int>(raw));
 
-        case QMetaType::ULong:
-        {
-            unsigned long i;
-            memcpy(&i, data.constData(), sizeof(unsigned long));
-            QVariant y;
-            y.setValue(i);
-            return y;
-        }
+        case QMetaType::Int:
+            return QVariant(static_cast<int>(raw));
 
-        case QMetaType::UShort:
-        {
-            unsigned short j;
-            memcpy(&j, data.constData(), sizeof(unsigned short));
-            QVariant z;
-            z.setValue(j);
-            return z;
-        }
+        case QMetaType::ULongLong:
+            return QVariant(static_cast<quint64>(raw));
 
-        case QMetaType::UChar:
-        {
-            unsigned char k;
-            memcpy(&k, data.constData(), sizeof(unsigned char));
-            QVariant n;
-            n.setValue(k);
-            return n;
-        }
+        case QMetaType::LongLong:
+            return QVariant(static_cast<qint64>(raw));
 
         case QMetaType::Float:
         {
-            float l;
-            dataStream >> l;
-            return QVariant(l);
+            quint32 value = static_cast<quint32>(raw);
+            float f;
+            memcpy(&f, &value, sizeof(f));
+            return QVariant(f);
         }
 
-        case QMetaType::SChar:
+        case QMetaType::Double:
         {
-            signed char m;
-            memcpy(&m, data.constData(), sizeof(signed char));
-            QVariant x;
-            x.setValue(m);
-            return x;
+            double d;
+            memcpy(&d, &raw, sizeof(d));
+            return QVariant(d);
         }
 
-        case QMetaType::QString:
-            return QVariant(QString(data));
-
-        case QMetaType::QByteArray:
-            return QVariant(data);
-
         default:
             break;
     }
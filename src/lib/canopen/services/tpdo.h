@@ -59,7 +59,7 @@ protected slots:
     void receiveSync();
 
 private:
-    QVariant convertQByteArrayToQVariant(QByteArray data, QMetaType::Type type);
+    static QVariant slotValue(const MappingSlot &slot, quint64 raw);
 
     // Service interface
 public:
@@ -28,6 +28,7 @@ CanFrameModel::CanFrameModel(QObject *parent)
     : QAbstractItemModel(parent)
 {
     _bus = nullptr;
+    _firstFrameId = 0;
     _frameId = 0;
 }
 
@@ -66,16 +67,35 @@ void CanFrameModel::setBus(CanOpenBus *bus)
         disconnect(_bus, &CanOpenBus::frameAvailable, this, &CanFrameModel::updateFrames);
     }
     _bus = bus;
-    _frameId = _bus->canFramesLog().count();
+    _firstFrameId = _bus->canFramesLog()->firstIndex();
+    _frameId = _bus->canFramesLog()->endIndex();
     connect(bus, &CanOpenBus::frameAvailable, this, &CanFrameModel::updateFrames);
     emit layoutChanged();
 }
 
-void CanFrameModel::updateFrames(int id)
+void CanFrameModel::updateFrames(qint64 id)
 {
-    beginInsertRows(QModelIndex(), _frameId, id - 1);
-    _frameId = id;
-    endInsertRows();
+    // frames removed from the log by retention
+    qint64 firstFrameId = _bus->canFramesLog()->firstIndex();
+    if (firstFrameId > _firstFrameId)
+    {
+        qint64 removedEnd = qMin(firstFrameId, _frameId);
+        if (removedEnd > _firstFrameId)
+        {
+            beginRemoveRows(QModelIndex(), 0, static_cast<int>(removedEnd - _firstFrameId - 1));
+            _firstFrameId = removedEnd;
+            endRemoveRows();
+        }
+        _firstFrameId = firstFrameId;
+        _frameId = qMax(_frameId, firstFrameId);
+    }
+
+    if (id > _frameId)
+    {
+        beginInsertRows(QModelIndex(), static_cast<int>(_frameId - _firstFrameId), static_cast<int>(id - _firstFrameId - 1));
+        _frameId = id;
+        endInsertRows();
+    }
 }
 
 int CanFrameModel::columnCount(const QModelIndex &parent) const
@@ -127,12 +147,16 @@ QVariant CanFrameModel::data(const QModelIndex &index, int role) const
     else
     {
         // bus data mode
-        if (index.row() >= _frameId)
+        if (index.row() >= _frameId - _firstFrameId)
         {
             return QVariant();
         }
     }
-    const QCanBusFrame &canFrame = (_bus == nullptr) ? _frames.at(index.row()) : _bus->canFramesLog().at(index.row());
+    const QCanBusFrame canFrame = (_bus == nullptr) ? _frames.at(index.row()) : _bus->canFramesLog()->frame(_firstFrameId + index.row());
+    if (_bus != nullptr && !canFrame.isValid())
+    {
+        return QVariant();
+    }
 
     switch (role)
     {
@@ -153,7 +177,7 @@ QVariant CanFrameModel::data(const QModelIndex &index, int role) const
                         case QCanBusFrame::UnknownFrame:
                             return QVariant(tr("unk"));
                         case QCanBusFrame::DataFrame:
-                            return QVariant(tr("Dat(%1)").arg(canFrame.payload().size()));
+                            return QVariant(tr("Dat(%1)").arg(canFrame.payloadSize()));
                         case QCanBusFrame::ErrorFrame:
                             return QVariant(tr("Err"));
                         case QCanBusFrame::RemoteRequestFrame:
@@ -223,7 +247,7 @@ QModelIndex CanFrameModel::index(int row, int column, const QModelIndex &parent)
     else
     {
         // bus data mode
-        if (row >= _frameId)
+        if (row >= _frameId - _firstFrameId)
         {
             return QModelIndex();
         }
@@ -245,7 +269,7 @@ int CanFrameModel::rowCount(const QModelIndex &parent) const
         {
             return _frames.count();
         }
-        return _frameId;
+        return static_cast<int>(_frameId - _firstFrameId);
     }
     return 0;
 }
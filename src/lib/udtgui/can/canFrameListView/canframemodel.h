@@ -50,7 +50,7 @@ public:
     };
 
 protected slots:
-    void updateFrames(int id);
+    void updateFrames(qint64 id);
 
     // QAbstractItemModel interface
 public:
@@ -67,7 +67,9 @@ private:
 
     QList<QCanBusFrame> _frames;
 
-    int _frameId;
+    // bus data mode, rows map to the absolute log indexes [_firstFrameId, _frameId[
+    qint64 _firstFrameId;
+    qint64 _frameId;
     CanOpenBus *_bus;
 };
 
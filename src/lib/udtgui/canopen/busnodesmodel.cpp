@@ -410,9 +410,10 @@ QModelIndex BusNodesModel::index(int row, int column, const QModelIndex &parent)
     CanOpenBus *bus = qobject_cast<CanOpenBus *>(static_cast<QObject *>(parent.internalPointer()));
     if (bus != nullptr)
     {
-        if (row < bus->nodes().count())
+        const QList<Node *> nodes = bus->nodes();
+        if (row < nodes.count())
         {
-            return createIndex(row, column, bus->nodes().at(row));
+            return createIndex(row, column, nodes.at(row));
         }
         return QModelIndex();
     }
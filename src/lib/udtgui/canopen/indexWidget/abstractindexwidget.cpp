@@ -45,6 +45,8 @@ AbstractIndexWidget::AbstractIndexWidget(const NodeObjectId &objId)
     _requestRead = false;
 
     _widget = nullptr;
+
+    setNotifyMode(NotifyCoalesced, 33);  // repainted at screen rate, no need of each PDO update
 }
 
 Node *AbstractIndexWidget::node() const
@@ -28,6 +28,7 @@ NodeOdItemModel::NodeOdItemModel(QObject *parent)
     _root = nullptr;
     _node = nullptr;
 
+    setNotifyMode(NotifyCoalesced, 33);  // one update per object and per frame is enough for the tree view
     registerFullOd();
 }
 
@@ -0,0 +1,20 @@
+QT       += core
+
+TARGET = benchCanOpen
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+DESTDIR = "$$PWD/../../bin"
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG(release, debug|release) {
+    CONFIG += optimize_full
+}
+
+SOURCES += \
+    $$PWD/main.cpp
+
+INCLUDEPATH += $$PWD/../../src/lib/canopen/
+
+LIBS += -L"$$PWD/../../bin" -lcanopen
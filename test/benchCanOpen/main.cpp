@@ -0,0 +1,202 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVector>
+
+#include "canopenbus.h"
+#include "node.h"
+#include "services/tpdo.h"
+
+// Micro-benchmarks of the frame reception paths, run on a synthetic 127 nodes bus without driver,
+// and of the object dictionary accesses.
+// Usage: benchCanOpen [iterations]
+
+static volatile qint64 sink;  // keeps the measured results alive
+
+static void report(const QString &name, qint64 count, qint64 elapsedNs)
+{
+    QTextStream out(stdout);
+    double seconds = static_cast<double>(qMax(Q_INT64_C(1), elapsedNs)) / 1e9;
+    out << name.leftJustified(20) << QString::number(static_cast<double>(count) / seconds, 'f', 0).rightJustified(12) << " /s"
+        << QString::number(static_cast<double>(elapsedNs) / static_cast<double>(count), 'f', 1).rightJustified(10) << " ns\n";
+}
+
+static void benchDispatch(CanOpenBus *bus, int iterations)
+{
+    // heartbeats and TPDOs of all the nodes, with some unregistered identifiers
+    QVector<QCanBusFrame> frames;
+    for (Node *node : bus->nodes())
+    {
+        quint8 nodeId = node->nodeId();
+        frames.append(QCanBusFrame(0x700U + nodeId, QByteArray(1, static_cast<char>(0x05))));
+        for (quint32 pdo = 0; pdo < 4; pdo++)
+        {
+            frames.append(QCanBusFrame(0x180U + 0x100U * pdo + nodeId, QByteArray(8, 0)));
+        }
+        frames.append(QCanBusFrame(0x7E0U + (nodeId & 0x0FU), QByteArray(2, 0)));
+    }
+
+    ServiceDispatcher *dispatcher = bus->dispatcher();
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (const QCanBusFrame &frame : qAsConst(frames))
+        {
+            dispatcher->parseFrame(frame);
+        }
+    }
+    report(QStringLiteral("dispatch"), static_cast<qint64>(iterations) * frames.count(), timer.nsecsElapsed());
+}
+
+static void addSubIndex(NodeIndex *nodeIndex, quint8 subIndex, NodeSubIndex::DataType dataType, const QVariant &value)
+{
+    NodeSubIndex *nodeSubIndex = new NodeSubIndex(subIndex);
+    nodeSubIndex->setDataType(dataType);
+    nodeSubIndex->setAccessType(static_cast<NodeSubIndex::AccessType>(NodeSubIndex::READ | NodeSubIndex::WRITE | NodeSubIndex::TPDO));
+    nodeSubIndex->setValue(value);
+    nodeIndex->addSubIndex(nodeSubIndex);
+}
+
+static void addVar(NodeOd *nodeOd, quint16 index, NodeSubIndex::DataType dataType)
+{
+    NodeIndex *nodeIndex = new NodeIndex(index);
+    addSubIndex(nodeIndex, 0, dataType, QVariant());
+    nodeOd->addIndex(nodeIndex);
+}
+
+// TPDO1 mapped with a CiA 402 like status: statusword, position actual value and torque actual value, 64 bits
+static void setupTpdoMapping(Node *node)
+{
+    NodeOd *nodeOd = node->nodeOd();
+    addVar(nodeOd, 0x6041, NodeSubIndex::UNSIGNED16);
+    addVar(nodeOd, 0x6064, NodeSubIndex::INTEGER32);
+    addVar(nodeOd, 0x6077, NodeSubIndex::INTEGER16);
+
+    NodeIndex *comm = new NodeIndex(0x1800);
+    comm->setObjectType(NodeIndex::RECORD);
+    addSubIndex(comm, 0, NodeSubIndex::UNSIGNED8, QVariant(static_cast<uchar>(6)));
+    addSubIndex(comm, 1, NodeSubIndex::UNSIGNED32, QVariant(0x180U + node->nodeId()));
+    addSubIndex(comm, 2, NodeSubIndex::UNSIGNED8, QVariant(static_cast<uchar>(0xFF)));
+    addSubIndex(comm, 3, NodeSubIndex::UNSIGNED16, QVariant(static_cast<ushort>(0)));
+    addSubIndex(comm, 5, NodeSubIndex::UNSIGNED16, QVariant(static_cast<ushort>(0)));
+    addSubIndex(comm, 6, NodeSubIndex::UNSIGNED8, QVariant(static_cast<uchar>(0)));
+    nodeOd->addIndex(comm);
+
+    NodeIndex *mapping = new NodeIndex(0x1A00);
+    mapping->setObjectType(NodeIndex::RECORD);
+    addSubIndex(mapping, 0, NodeSubIndex::UNSIGNED8, QVariant(static_cast<uchar>(3)));
+    addSubIndex(mapping, 1, NodeSubIndex::UNSIGNED32, QVariant(0x60410010U));
+    addSubIndex(mapping, 2, NodeSubIndex::UNSIGNED32, QVariant(0x60640020U));
+    addSubIndex(mapping, 3, NodeSubIndex::UNSIGNED32, QVariant(0x60770010U));
+    nodeOd->addIndex(mapping);
+
+    node->tpdos().first()->reset();  // compiles the mapping plan
+}
+
+static void benchTpdoDecode(CanOpenBus *bus, int iterations)
+{
+    QList<TPDO *> tpdos;
+    for (Node *node : bus->nodes())
+    {
+        setupTpdoMapping(node);
+        tpdos.append(node->tpdos().first());
+    }
+
+    QCanBusFrame frame(0x180, QByteArray(8, 0));
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+    {
+        QByteArray payload(8, static_cast<char>(i));
+        frame.setPayload(payload);
+        for (TPDO *tpdo : qAsConst(tpdos))
+        {
+            tpdo->parseFrame(frame);
+        }
+    }
+    report(QStringLiteral("tpdo decode"), static_cast<qint64>(iterations) * tpdos.count(), timer.nsecsElapsed());
+}
+
+// 600 objects drive like dictionary: 50 manufacturer records of 11 INTEGER32 values
+static void benchOd(int iterations)
+{
+    Node node(1);
+    NodeOd *nodeOd = node.nodeOd();
+    QVector<NodeObjectId> objects;
+    for (quint16 index = 0x2000; index < 0x2032; index++)
+    {
+        NodeIndex *nodeIndex = new NodeIndex(index);
+        nodeIndex->setObjectType(NodeIndex::RECORD);
+        addSubIndex(nodeIndex, 0, NodeSubIndex::UNSIGNED8, QVariant(static_cast<uchar>(11)));
+        for (quint8 subIndex = 1; subIndex <= 11; subIndex++)
+        {
+            addSubIndex(nodeIndex, subIndex, NodeSubIndex::INTEGER32, QVariant(0));
+        }
+        nodeOd->addIndex(nodeIndex);
+        for (quint8 subIndex = 0; subIndex <= 11; subIndex++)
+        {
+            objects.append(NodeObjectId(index, subIndex));
+        }
+    }
+    qint64 count = static_cast<qint64>(iterations) * objects.count();
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 found = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        for (const NodeObjectId &objId : qAsConst(objects))
+        {
+            found += (nodeOd->subIndex(objId.index(), objId.subIndex()) != nullptr) ? 1 : 0;
+        }
+    }
+    report(QStringLiteral("od lookup"), count, timer.nsecsElapsed());
+    sink = found;
+
+    timer.start();
+    qint64 sum = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+        for (const NodeObjectId &objId : qAsConst(objects))
+        {
+            sum += nodeOd->value(objId.index(), objId.subIndex()).toInt();
+        }
+    }
+    report(QStringLiteral("od value"), count, timer.nsecsElapsed());
+    sink = sum;
+
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+    {
+        QVariant value(i);
+        for (const NodeObjectId &objId : qAsConst(objects))
+        {
+            nodeOd->updateObjectFromDevice(objId.index(), objId.subIndex(), value, NodeOd::Read);
+        }
+    }
+    report(QStringLiteral("od update"), count, timer.nsecsElapsed());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int iterations = 2000;
+    if (app.arguments().count() > 1)
+    {
+        iterations = qMax(1, app.arguments().at(1).toInt());
+    }
+
+    CanOpenBus bus;
+    for (quint8 nodeId = 1; nodeId <= 127; nodeId++)
+    {
+        bus.addNode(new Node(nodeId));
+    }
+
+    benchDispatch(&bus, iterations);
+    benchTpdoDecode(&bus, iterations);
+    benchOd(iterations);
+
+    return 0;
+}